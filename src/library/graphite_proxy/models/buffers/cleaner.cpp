@@ -19,30 +19,29 @@ void Cleaner::iteration()
   LOG_DEBUG( "Cleaner iteration", utils::logging::LOG_HEADER_CLEANER );
 
   // Iterate over global buffer's buffers
-  std::map<std::string, unsigned long> buffer_sizes = m_global_buffer->getBufferSizes();
+  std::map<series_id, unsigned long> buffer_sizes = m_global_buffer->getBufferSizes();
   for( auto it = buffer_sizes.begin(); it != buffer_sizes.end(); ++it )
     this->clean( it->first, it->second, true );
 
   // Iterate over math buffers
 //  if( m_math )
 //  {
-//    const std::map<std::string, std::vector<maths::MathOperation*>>& buffers = m_math->getBuffers();
+//    const std::unordered_map<series_id, std::vector<maths::MathOperation*>>& buffers = m_math->getBuffers();
 //    for( auto it = buffers.begin(); it != buffers.end(); ++it )
 //    {
+//      unsigned long series_size = 0;
 //      const std::vector<maths::MathOperation*>& operations = it->second;
 //      for( size_t i = 0, size = operations.size(); i < size; i++ )
-//      {
-//        const MessageBuffer& buffer = operations[i]->buffer;
-//        this->clean( buffer.getName(), buffer.size(), false );
-//      }
+//        series_size += operations[i]->buffer.size();
+//      this->clean( it->first, series_size, false );
 //    }
 //  }
 }
 
-void Cleaner::clean( const std::string& buffer_name, unsigned long buffer_size, bool global_buffer )
+void Cleaner::clean( series_id series, unsigned long buffer_size, bool global_buffer )
 {
-  const std::string name = ((global_buffer) ? "gb_" : "math_") + buffer_name;
-  auto buffer_state      = m_buffer_states.find(name);
+  const std::pair<bool, series_id> name( global_buffer, series );
+  auto buffer_state = m_buffer_states.find(name);
 
   // Buffer empty, let's see if we can delete it
   if( buffer_size == 0 )
@@ -60,13 +59,13 @@ void Cleaner::clean( const std::string& buffer_name, unsigned long buffer_size,
         // Delete the buffer
         if( global_buffer )
         {
-          LOG_DEBUG( std::string("Removing '") + name + "' buffer from Global Buffer", utils::logging::LOG_HEADER_CLEANER );
-          m_global_buffer->remove( buffer_name );
+          LOG_DEBUG( std::string("Removing '") + SeriesTable::instance().name( series ) + "' buffer from Global Buffer", utils::logging::LOG_HEADER_CLEANER );
+          m_global_buffer->remove( series );
         }
         else if( m_math )
         {
-          m_math->remove( buffer_name );
-          LOG_DEBUG( std::string("Removing '") + name + "' buffer from Math Pipeline", utils::logging::LOG_HEADER_CLEANER );
+          m_math->remove( series );
+          LOG_DEBUG( std::string("Removing '") + SeriesTable::instance().name( series ) + "' buffers from Math Pipeline", utils::logging::LOG_HEADER_CLEANER );
         }
       }
       else buffer_number++;
@@ -7,6 +7,7 @@
 
 #include <map>
 #include <string>
+#include <utility>
 
 namespace graphite_proxy {
 
@@ -36,11 +37,11 @@ class Cleaner : public Iterations
     void iteration();
 
     /*! Remove a buffer if it matches the remove conditions
-     *  \param buffer_name   is the name of the buffer to check
+     *  \param series        is the series ID of the buffer to check
      *  \param buffer_size   is the current size of the buffer
      *  \param global_buffer set to true means we are checking a buffer from the global buffer. Otherwise it's a math buffer
      */
-    void clean( const std::string& buffer_name, unsigned long buffer_size, bool global_buffer );
+    void clean( series_id series, unsigned long buffer_size, bool global_buffer );
 
   private:
 
@@ -53,8 +54,8 @@ class Cleaner : public Iterations
     /*! Max number of continuous time that a buffer is allow to be empty before destroy it */
     unsigned int                        m_max_empty_time;
 
-    /*! Association between buffer name and number of continuous time this buffer was empty */
-    std::map<std::string, unsigned int> m_buffer_states;
+    /*! Association between buffer series and number of continuous time this buffer was empty (global buffer and math buffers) */
+    std::map<std::pair<bool, series_id>, unsigned int> m_buffer_states;
 };
 
 } // namespace graphite_proxy
@@ -0,0 +1,116 @@
+#include "flush_queue.hpp"
+
+#include <graphite_proxy/utils/logging/logger.hpp>
+#include <graphite_proxy/utils/logging/log_headers.hpp>
+
+#include <boost/bind.hpp>
+
+namespace graphite_proxy {
+
+FlushQueue::FlushQueue( networking::client_ptr client, size_t max_batches, failure_handler on_failure )
+  : m_client( client )
+  , m_max_batches( max_batches > 0 ? max_batches : 1 )
+  , m_on_failure( on_failure )
+  , m_stopped( false )
+{
+  // Nothing
+}
+
+FlushQueue::~FlushQueue()
+{
+  this->stop();
+}
+
+void FlushQueue::start( unsigned int nbr_threads )
+{
+  if( m_threads.size() > 0 )
+  {
+    LOG_WARNING( "Flush queue is already started, ignoring call to start()", utils::logging::LOG_HEADER_GLOBALBUFFER );
+    return;
+  }
+
+  if( nbr_threads == 0 )
+    nbr_threads = 1;
+
+  for( unsigned int i = 0; i < nbr_threads; i++ )
+    m_threads.create_thread( boost::bind( &FlushQueue::run, this ) );
+
+  LOG_DEBUG( "Flush queue started with " + std::to_string( nbr_threads ) + " sender threads", utils::logging::LOG_HEADER_GLOBALBUFFER );
+}
+
+void FlushQueue::stop()
+{
+  {
+    boost::mutex::scoped_lock lock( m_mutex );
+    if( m_stopped )
+      return;
+    m_stopped = true;
+  }
+
+  m_condition.notify_all();
+  m_threads.join_all();
+
+  // Give back the batches which will never be sent
+  std::deque<Batch> batches;
+  {
+    boost::mutex::scoped_lock lock( m_mutex );
+    batches.swap( m_batches );
+  }
+
+  for( Batch &batch : batches )
+    m_on_failure( batch.series, batch.messages );
+}
+
+bool FlushQueue::push( series_id series, std::vector<Message> &messages )
+{
+  {
+    boost::mutex::scoped_lock lock( m_mutex );
+    if( m_stopped || m_batches.size() >= m_max_batches )
+      return false;
+
+    m_batches.push_back( Batch() );
+    m_batches.back().series = series;
+    m_batches.back().messages.swap( messages );
+  }
+
+  m_condition.notify_one();
+  return true;
+}
+
+size_t FlushQueue::size() const
+{
+  boost::mutex::scoped_lock lock( m_mutex );
+  return m_batches.size();
+}
+
+void FlushQueue::run()
+{
+  Batch batch;
+
+  for(;;)
+  {
+    // Wait for a batch to send
+    {
+      boost::mutex::scoped_lock lock( m_mutex );
+      while( !m_stopped && m_batches.empty() )
+        m_condition.wait( lock );
+
+      if( m_stopped )
+        return;
+
+      batch.series = m_batches.front().series;
+      batch.messages.swap( m_batches.front().messages );
+      m_batches.pop_front();
+    }
+
+    // Serialize it without holding the lock, so other batches can be pushed meanwhile, and hand it to the client
+    const series_id       series     = batch.series;
+    const failure_handler on_failure = m_on_failure;
+    if( !m_client->sendAsync( batch.messages, [on_failure, series]( bool sent, std::vector<Message> &messages ) { if( !sent ) on_failure( series, messages ); } ) )
+      m_on_failure( batch.series, batch.messages );
+
+    batch.messages.clear();
+  }
+}
+
+} // namespace graphite_proxy
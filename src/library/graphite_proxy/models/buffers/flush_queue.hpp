@@ -0,0 +1,118 @@
+#ifndef GRAPHITE_PROXY_FLUSH_QUEUE_HPP
+#define GRAPHITE_PROXY_FLUSH_QUEUE_HPP
+
+#include <graphite_proxy/models/message.hpp>
+#include <graphite_proxy/models/series_table.hpp>
+
+#include <graphite_proxy/networking/client.hpp>
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <deque>
+#include <vector>
+
+namespace graphite_proxy {
+
+/*! Default maximum number of batches waiting into the flush queue */
+static const size_t FLUSH_QUEUE_DEFAULT_MAX_BATCHES = 1024;
+
+/*! The Flush Queue holds batches of messages waiting to be sent to Graphite
+ *  Batches are pushed by the threads filling the buffers, then serialized and queued into the client by a pool of sender threads,
+ *  so that a slow or unreachable Graphite server never blocks the reception of messages.
+ *  \note a batch which can't be sent is given back to the failure handler, possibly by the client thread
+ */
+class FlushQueue
+{
+  public:
+
+    /*! Function called with the messages of a batch which has not been sent */
+    typedef boost::function<void ( series_id, std::vector<Message>& )> failure_handler;
+
+    /*! Constructor
+     *  \param client      to send messages
+     *  \param max_batches is the maximum number of batches waiting to be sent
+     *  \param on_failure  is called with the messages of each batch which can't be sent
+     */
+    FlushQueue( networking::client_ptr client, size_t max_batches, failure_handler on_failure );
+
+    /*! Destructor, stop the sender threads */
+    ~FlushQueue();
+
+    /*! Start the sender threads
+     *  \param nbr_threads is the number of threads sending batches
+     */
+    void start( unsigned int nbr_threads );
+
+    /*! Stop the sender threads
+     *  \note batches still waiting into the queue are given back to the failure handler
+     */
+    void stop();
+
+    /*! Push a batch of messages at the end of the queue
+     *  \param series   is the series ID of the messages
+     *  \param messages are the messages to send, they are moved into the queue on success
+     *  \return false if the queue is full (the messages are left untouched)
+     */
+    bool push( series_id series, std::vector<Message> &messages );
+
+    /*! Get the number of batches waiting to be sent (usefull for statistics)
+     *  \return the queue depth
+     */
+    size_t size() const;
+
+    /*! Getter for the maximum number of batches waiting to be sent
+     *  \return the queue capacity
+     */
+    size_t getMaxBatches() const { return m_max_batches; }
+
+    /*! Getter for the number of sender threads
+     *  \return the number of sender threads
+     */
+    size_t getNbrThreads() const { return m_threads.size(); }
+
+  private:
+
+    /*! Messages of a series waiting to be sent */
+    struct Batch
+    {
+      series_id            series;
+      std::vector<Message> messages;
+    };
+
+    /*! Sender thread loop, wait for batches and send them */
+    void run();
+
+    /*! An instance of the Client */
+    networking::client_ptr      m_client;
+
+    /*! Maximum number of batches waiting to be sent */
+    const size_t                m_max_batches;
+
+    /*! Called with the messages which can't be sent */
+    failure_handler             m_on_failure;
+
+    /*! Batches waiting to be sent */
+    std::deque<Batch>           m_batches;
+
+    /*! Is the queue stopped */
+    bool                        m_stopped;
+
+    /*! Sender threads */
+    boost::thread_group         m_threads;
+
+    /*! Mutex for thread safety */
+    mutable boost::mutex        m_mutex;
+
+    /*! Wake up the sender threads when a batch is pushed or when the queue is stopped */
+    boost::condition_variable   m_condition;
+};
+
+typedef boost::shared_ptr<FlushQueue> flush_queue_ptr;
+
+} // namespace graphite_proxy
+
+#endif // GRAPHITE_PROXY_FLUSH_QUEUE_HPP
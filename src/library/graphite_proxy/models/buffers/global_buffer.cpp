@@ -1,135 +1,310 @@
 #include "global_buffer.hpp"
 
+#include <graphite_proxy/models/statistics/statistics_metrics.hpp>
+#include <graphite_proxy/models/statistics/statistics.hpp>
+
 #include <graphite_proxy/utils/logging/log_headers.hpp>
 #include <graphite_proxy/utils/cast.hpp>
 
+#include <boost/bind.hpp>
 #include <boost/make_shared.hpp>
-#include <boost/algorithm/string.hpp>
 
+#include <algorithm>
 #include <vector>
 
 namespace graphite_proxy {
 
-GlobalBuffer::GlobalBuffer( unsigned long buffer_max_size, bool drop_oldest, networking::client_ptr client )
+GlobalBuffer::GlobalBuffer( unsigned long buffer_max_size, bool drop_oldest, networking::client_ptr client, unsigned int nbr_shards )
   : m_buffer_max_size( buffer_max_size )
   , m_drop_oldest( drop_oldest )
   , m_client( client )
+  , m_buffered_bytes( 0 )
+  , m_flush_bytes( 0 )
 {
+  if( nbr_shards == 0 )
+    nbr_shards = 1;
+
+  m_shards.reserve( nbr_shards );
+  for( unsigned int i = 0; i < nbr_shards; i++ )
+    m_shards.push_back( boost::make_shared<Shard>() );
+
   LOG_DEBUG( "Max buffer size: " + std::to_string(m_buffer_max_size), utils::logging::LOG_HEADER_GLOBALBUFFER );
   LOG_DEBUG( "Dropping oldest: " + utils::cast::toString(m_drop_oldest, true), utils::logging::LOG_HEADER_GLOBALBUFFER );
+  LOG_DEBUG( "Number of shards: " + std::to_string(nbr_shards), utils::logging::LOG_HEADER_GLOBALBUFFER );
+}
+
+GlobalBuffer::~GlobalBuffer()
+{
+  // Stop the sender threads while the buffers can still take back the unsent messages
+  this->stopFlushQueue();
 }
 
-bool GlobalBuffer::add( message_ptr message )
+void GlobalBuffer::stopFlushQueue()
 {
-  if(!message || !message->isValid())
+  if( m_flush_queue )
+    m_flush_queue->stop();
+}
+
+void GlobalBuffer::startFlushQueue( unsigned int nbr_threads, size_t max_batches )
+{
+  if( m_flush_queue )
   {
-    LOG_WARNING( "Invalid message: " + message->serialize(), utils::logging::LOG_HEADER_GLOBALBUFFER );
-    return false;
+    LOG_WARNING( "Flush queue is already started", utils::logging::LOG_HEADER_GLOBALBUFFER );
+    return;
   }
 
-  message_buffer_ptr message_buffer;
-  std::string message_type = message->getType();
+  m_flush_queue = boost::make_shared<FlushQueue>( m_client, max_batches, boost::bind( &GlobalBuffer::restore, this, _1, _2 ) );
+  m_flush_queue->start( nbr_threads );
 
-  boost::mutex::scoped_lock lock( m_buffers_mutex );
+  LOG_DEBUG( "Flush queue size: " + std::to_string(m_flush_queue->getMaxBatches()), utils::logging::LOG_HEADER_GLOBALBUFFER );
+}
+
+void GlobalBuffer::setFlushTrigger( size_t max_bytes, boost::function<void ()> trigger )
+{
+  m_flush_bytes   = trigger ? max_bytes : 0;
+  m_flush_trigger = trigger;
+}
+
+bool GlobalBuffer::addBytes( Shard &shard, size_t bytes )
+{
+  shard.bytes += bytes;
+
+  // Only the message crossing the size calls the trigger, not all the following ones
+  const size_t previous = m_buffered_bytes.fetch_add( bytes );
+  return m_flush_bytes > 0 && previous < m_flush_bytes && previous + bytes >= m_flush_bytes;
+}
 
-  // Is the buffer already created ? If not create it
-  if (m_buffers.count( message_type ) <= 0)
-    message_buffer = m_buffers[message_type] = boost::make_shared<MessageBuffer>( message_type, m_buffer_max_size, m_drop_oldest );
-  else message_buffer = m_buffers[message_type];
+void GlobalBuffer::addOldest( Shard &shard, ulong received )
+{
+  if( received > 0 && ( shard.oldest == 0 || received < shard.oldest ) )
+    shard.oldest = received;
+}
 
-  // Try to add the message content to the buffer
-  if( message_buffer->add( message ) )
+void GlobalBuffer::updateOldest( Shard &shard )
+{
+  shard.oldest = 0;
+  shard.buffers.forEach( [&shard]( series_id, const message_buffer_ptr& buffer ) { GlobalBuffer::addOldest( shard, buffer->getOldestReceivedTimestamp() ); } );
+}
+
+void GlobalBuffer::removeBytes( Shard &shard, size_t bytes )
+{
+  // The sizes are estimated, so they are kept from going below 0
+  bytes = std::min( bytes, shard.bytes );
+  shard.bytes -= bytes;
+  m_buffered_bytes -= bytes;
+}
+
+bool GlobalBuffer::add( const Message &message )
+{
+  if( !message.isValid() )
   {
-    LOG_DEBUG( "Message added: " + message->serialize(), utils::logging::LOG_HEADER_GLOBALBUFFER );
+    LOG_WARNING( "Invalid message", utils::logging::LOG_HEADER_GLOBALBUFFER );
+    return false;
+  }
+
+  const series_id series = message.getSeries();
+  Shard& shard           = this->shard( series );
+  std::vector<Message> messages_to_send;
+  bool is_flush_size = false;
 
-    // Check if the buffer is now full
+  {
+    boost::mutex::scoped_lock lock( shard.mutex );
+
+    // Is the buffer already created ? If not create it
+    message_buffer_ptr& message_buffer = shard.buffers[series];
+    if( !message_buffer )
+      message_buffer = boost::make_shared<MessageBuffer>( message.getType(), m_buffer_max_size, m_drop_oldest );
+
+    // Try to add the message content to the buffer
+    if( !message_buffer->add( message ) )
+    {
+      LOG_DEBUG( "Message dropped: " + message.serialize(), utils::logging::LOG_HEADER_GLOBALBUFFER );
+      return false;
+    }
+
+    LOG_DEBUG( "Message added: " + message.serialize(), utils::logging::LOG_HEADER_GLOBALBUFFER );
+    is_flush_size = this->addBytes( shard, GlobalBuffer::cost( message_buffer->getName(), 1 ) );
+    GlobalBuffer::addOldest( shard, message.getReceivedTimestamp() );
+
+    // Check if the buffer is now full, if so retrieve messages to send
     if( message_buffer->size() >= m_buffer_max_size )
     {
-      // The buffer is full, send messages
       LOG_DEBUG( "Buffer '" +  message_buffer->getName() + "' is full, sending messages", utils::logging::LOG_HEADER_GLOBALBUFFER );
-
-      // Retrieve messages to send
-      std::vector<message_ptr> messages_to_send;
       message_buffer->get( messages_to_send );
+      this->removeBytes( shard, GlobalBuffer::cost( message_buffer->getName(), messages_to_send.size() ) );
 
-      if( !m_client->send( messages_to_send ) )
-      {
-        // Messages can't be send, back them back into the buffer
-        for( message_ptr message : messages_to_send )
-          message_buffer->add(message);
-      }
+      // The shard is only searched again when the buffer held its oldest message
+      if( messages_to_send.front().getReceivedTimestamp() <= shard.oldest )
+        GlobalBuffer::updateOldest( shard );
     }
+  }
 
-    return true;
+  if( is_flush_size )
+    m_flush_trigger();
+
+  // The messages are sent once the shard is unlocked, so other messages of the shard can be added meanwhile
+  if( !messages_to_send.empty() )
+    this->flush( series, messages_to_send );
+
+  return true;
+}
+
+void GlobalBuffer::restore( series_id series, const std::vector<Message> &messages )
+{
+  this->restore( series, messages.begin(), messages.end() );
+}
+
+void GlobalBuffer::restore( const std::vector<Message> &messages )
+{
+  auto begin = messages.begin();
+  while( begin != messages.end() )
+  {
+    const series_id series = begin->getSeries();
+    auto end = begin + 1;
+    while( end != messages.end() && end->getSeries() == series )
+      ++end;
+
+    this->restore( series, begin, end );
+    begin = end;
+  }
+}
+
+void GlobalBuffer::restore( series_id series, std::vector<Message>::const_iterator begin, std::vector<Message>::const_iterator end )
+{
+  if( begin == end )
+    return;
+
+  Shard& shard = this->shard( series );
+  boost::mutex::scoped_lock lock( shard.mutex );
+
+  message_buffer_ptr& message_buffer = shard.buffers[series];
+  if( !message_buffer )
+    message_buffer = boost::make_shared<MessageBuffer>( begin->getType(), m_buffer_max_size, m_drop_oldest );
+
+  // The messages are older than the ones received meanwhile, they go back in front of them
+  const unsigned long restored = message_buffer->requeue( begin, end );
+  this->addBytes( shard, GlobalBuffer::cost( message_buffer->getName(), restored ) );
+  GlobalBuffer::addOldest( shard, message_buffer->getOldestReceivedTimestamp() );
+}
+
+void GlobalBuffer::flush( series_id series, std::vector<Message> &messages )
+{
+  if( m_flush_queue )
+  {
+    if( m_flush_queue->push( series, messages ) )
+      return;
+
+    STATS_INCREMENT( stats::STATS_FLUSH_QUEUE_FULL );
+    LOG_WARNING( "Flush queue is full, messages are kept into their buffer", utils::logging::LOG_HEADER_GLOBALBUFFER );
   }
   else
   {
-    LOG_DEBUG( "Message dropped: " + message->serialize(), utils::logging::LOG_HEADER_GLOBALBUFFER );
-    return false;
+    // Each destination completes its own part, so only the messages of a failed part go back into the buffer
+    if( m_client->sendAsync( messages, [this, series]( bool sent, std::vector<Message> &failed ) { if( !sent ) this->restore( series, failed ); } ) )
+      return;
   }
+
+  // Messages can't be send, back them back into the buffer
+  this->restore( series, messages );
 }
 
-void GlobalBuffer::get( std::vector<message_ptr> &result_messages )
+void GlobalBuffer::get( std::vector<Message> &result_messages )
 {
-  boost::mutex::scoped_lock lock( m_buffers_mutex );
+  for( size_t i = 0, nbr_shards = m_shards.size(); i < nbr_shards; i++ )
+  {
+    Shard& shard = *m_shards[i];
+    boost::mutex::scoped_lock lock( shard.mutex );
 
-  for (std::map<std::string, message_buffer_ptr>::iterator it = m_buffers.begin(); it != m_buffers.end(); ++it)
-    it->second->get( result_messages );
+    shard.buffers.forEach( [&result_messages]( series_id, const message_buffer_ptr& buffer ) { buffer->get( result_messages ); } );
+    this->removeBytes( shard, shard.bytes );
+    shard.oldest = 0;
+  }
 }
 
-void GlobalBuffer::get( const std::string &type, std::vector<message_ptr> &result_messages )
+void GlobalBuffer::get( series_id series, std::vector<Message> &result_messages )
 {
   // Find the buffer corresponding to the given type
-  message_buffer_ptr message_buffer;
+  Shard& shard = this->shard( series );
+  boost::mutex::scoped_lock lock( shard.mutex );
+
+  message_buffer_ptr* found_buffer = shard.buffers.find( series );
+  if( !found_buffer )
+    return;
+
+  const size_t first = result_messages.size();
+  (*found_buffer)->get( result_messages );
+  this->removeBytes( shard, GlobalBuffer::cost( (*found_buffer)->getName(), result_messages.size() - first ) );
+  if( result_messages.size() > first )
+    GlobalBuffer::updateOldest( shard );
+}
+
+std::chrono::milliseconds GlobalBuffer::getOldestAge() const
+{
+  const ulong now = utils::time::nowMilliseconds();
+  ulong oldest    = now;
+
+  for( size_t i = 0, nbr_shards = m_shards.size(); i < nbr_shards; i++ )
   {
-    boost::mutex::scoped_lock lock( m_buffers_mutex );
+    const Shard& shard = *m_shards[i];
+    boost::mutex::scoped_lock lock( shard.mutex );
 
-    if (m_buffers.count( type ) > 0)
-    {
-      message_buffer = m_buffers[type];
-    }
-    else return;
+    if( shard.oldest > 0 && shard.oldest < oldest )
+      oldest = shard.oldest;
   }
 
-  message_buffer->get( result_messages );
+  return std::chrono::milliseconds( now - oldest );
 }
 
 unsigned long GlobalBuffer::getBuffersMaxMessages() const
 {
-  unsigned long size, max = 0;
+  unsigned long max = 0;
 
+  for( size_t i = 0, nbr_shards = m_shards.size(); i < nbr_shards; i++ )
   {
-    boost::mutex::scoped_lock lock( m_buffers_mutex );
+    const Shard& shard = *m_shards[i];
+    boost::mutex::scoped_lock lock( shard.mutex );
 
-    for( std::map<std::string, message_buffer_ptr>::const_iterator it = m_buffers.begin(); it != m_buffers.end(); ++it )
+    shard.buffers.forEach( [&max]( series_id, const message_buffer_ptr& buffer )
     {
-      size = it->second->getMaxMessages();
+      const unsigned long size = buffer->getMaxMessages();
       if( size > max )
         max = size;
-    }
+    } );
   }
 
   return max;
 }
 
-std::map<std::string, unsigned long> GlobalBuffer::getBufferSizes() const
+std::map<series_id, unsigned long> GlobalBuffer::getBufferSizes() const
 {
-  std::map<std::string, unsigned long> result;
+  std::map<series_id, unsigned long> result;
 
-  boost::mutex::scoped_lock lock( m_buffers_mutex );
-
-  for( std::map<std::string, message_buffer_ptr>::const_iterator it = m_buffers.begin(); it != m_buffers.end(); ++it )
+  for( size_t i = 0, nbr_shards = m_shards.size(); i < nbr_shards; i++ )
   {
-    result[it->first] = it->second->size();
+    const Shard& shard = *m_shards[i];
+    boost::mutex::scoped_lock lock( shard.mutex );
+
+    shard.buffers.forEach( [&result]( series_id series, const message_buffer_ptr& buffer ) { result[series] = buffer->size(); } );
   }
 
   return result;
 }
 
-void GlobalBuffer::remove( const std::string& buffer_name )
+void GlobalBuffer::remove( series_id series )
 {
-  boost::mutex::scoped_lock lock( m_buffers_mutex );
-  m_buffers.erase(buffer_name);
+  Shard& shard = this->shard( series );
+  boost::mutex::scoped_lock lock( shard.mutex );
+
+  message_buffer_ptr* found_buffer = shard.buffers.find( series );
+  if( !found_buffer )
+    return;
+
+  // The cleaner removes empty buffers, they don't change the oldest message
+  const bool is_empty = (*found_buffer)->empty();
+  this->removeBytes( shard, GlobalBuffer::cost( (*found_buffer)->getName(), (*found_buffer)->size() ) );
+  shard.buffers.erase( series );
+  if( !is_empty )
+    GlobalBuffer::updateOldest( shard );
 }
 
 } // namespace graphite_proxy
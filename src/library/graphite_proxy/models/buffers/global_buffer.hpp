@@ -2,21 +2,39 @@
 #define GRAPHITE_PROXY_GLOBAL_BUFFER_HPP
 
 #include <graphite_proxy/models/message.hpp>
+#include <graphite_proxy/models/buffers/flush_queue.hpp>
 #include <graphite_proxy/models/buffers/message_buffer.hpp>
+#include <graphite_proxy/models/buffers/series_hash_map.hpp>
 
 #include <graphite_proxy/networking/client.hpp>
 
 #include <graphite_proxy/utils/logging/logger.hpp>
 
+#include <boost/function.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <map>
+#include <vector>
 
 namespace graphite_proxy {
 
+/*! Default number of shards of the Global Buffer */
+static const unsigned int GLOBAL_BUFFER_DEFAULT_NBR_SHARDS = 16;
+
+/*! Estimated length of a message besides its name: the value, the timestamp and their separators */
+static const size_t GLOBAL_BUFFER_MESSAGE_OVERHEAD = 24;
+
 /*! The Global Buffer is a wrapper around messages buffers
  *  It stores incoming messages into seperated messages buffers according to the message type
+ *  \note the buffers are partitioned into shards according to their series ID. Each shard has its own lock,
+ *        so messages of different shards are added concurrently and iterations over all buffers only lock one shard at a time.
+ *  \note when a buffer is full, its messages are queued to the client outside of the shard lock. If the flush queue is started,
+ *        they are handed to the sender threads instead. Either way, the thread adding the message never waits for the network.
+ *  \note the buffer keeps track of the size the buffered messages take once serialized and of the received time of the
+ *        oldest one, so they can be flushed once a batch is big enough or a point has waited for too long.
  */
 class GlobalBuffer
 {
@@ -26,27 +44,72 @@ class GlobalBuffer
      *  \param buffer_max_size is the maximum number of messages that can be stored into one messages buffer
      *  \param drop_oldest     means that incoming messages will override old ones if there is no more free space into the messages buffer
      *  \param client          to send messages
+     *  \param nbr_shards      is the number of independent partitions of the buffers
+     */
+    GlobalBuffer( unsigned long buffer_max_size, bool drop_oldest, networking::client_ptr client, unsigned int nbr_shards = GLOBAL_BUFFER_DEFAULT_NBR_SHARDS );
+
+    /*! Destructor, stop the flush queue */
+    ~GlobalBuffer();
+
+    /*! Send full buffers asynchronously through a flush queue
+     *  \param nbr_threads is the number of threads sending the full buffers
+     *  \param max_batches is the maximum number of full buffers waiting to be sent
+     *  \note must be called before adding messages
      */
-    GlobalBuffer( unsigned long buffer_max_size, bool drop_oldest, networking::client_ptr client );
+    void startFlushQueue( unsigned int nbr_threads, size_t max_batches = FLUSH_QUEUE_DEFAULT_MAX_BATCHES );
+
+    /*! Call a function each time the buffered messages reach a size
+     *  \param max_bytes is the estimated size of the buffered messages once serialized, 0 disables the trigger
+     *  \param trigger   is called by the thread adding the message which reaches the size, it must not block
+     *  \note must be called before adding messages
+     */
+    void setFlushTrigger( size_t max_bytes, boost::function<void ()> trigger );
+
+    /*! Stop the sender threads, full buffers still waiting into the flush queue are put back into their buffer */
+    void stopFlushQueue();
 
     /*! Add a message into the Global Buffer
      *  \param message is the message to store
      *  \return true if the message has been added to a messages buffer.
      */
-    bool add( message_ptr message );
+    bool add( const Message &message );
+
+    /*! Put back messages which have not been sent into their buffer, before the messages received meanwhile
+     *  \param series   is the series ID of the messages
+     *  \param messages are the messages to put back
+     *  \note the buffer is created again if it has been removed meanwhile
+     */
+    void restore( series_id series, const std::vector<Message> &messages );
+
+    /*! Put back messages of any series which have not been sent into their buffers, before the messages received meanwhile
+     *  \param messages are the messages to put back, consecutive messages of the same series are put back at once
+     */
+    void restore( const std::vector<Message> &messages );
 
     /*! Get all messages from the Global Buffer
      *  \param result_messages is a container to stored returned messages
      *  \note this function remove the returned messages from the Global Buffer (and also the messages buffer)
      */
-    void get( std::vector<message_ptr> &result_messages );
+    void get( std::vector<Message> &result_messages );
 
     /*! Get all messages of a specific type
-     *  \param type if the specific type of messages to search for
+     *  \param series is the ID of the specific type of messages to search for
      *  \param result_messages is a container for the returned results
      *  \note this function remove the returned messages from the buffers
      */
-    void get( const std::string &type, std::vector<message_ptr> &result_messages );
+    void get( series_id series, std::vector<Message> &result_messages );
+
+    /*! Get the estimated size of the buffered messages once serialized
+     *  \return the number of bytes waiting into the buffers
+     */
+    size_t getBufferedBytes() const { return m_buffered_bytes; }
+
+    /*! Get the time the oldest buffered message has been waiting for
+     *  \return the age of the oldest message, 0 if the buffers are empty
+     *  \note the age is taken from the received timestamps of the messages, so messages put back keep their age
+     *  \note each shard keeps its oldest timestamp, a dropped message may make the age overestimated until the next get()
+     */
+    std::chrono::milliseconds getOldestAge() const;
 
     /*! Get the maximum number of messages contained at the same time among all subbuffers (usefull for statistics) */
     unsigned long getBuffersMaxMessages() const;
@@ -57,9 +120,9 @@ class GlobalBuffer
     bool isDropOldest() const { return m_drop_oldest; }
 
     /*! Retrieve size of all sub buffers
-     *  \return a map where a buffer name is associated to it's current size
+     *  \return a map where a buffer series ID is associated to it's current size
      */
-    std::map<std::string, unsigned long> getBufferSizes() const;
+    std::map<series_id, unsigned long> getBufferSizes() const;
 
     /*! Getter for the buffers max size
      *  \return the buffers max size
@@ -67,26 +130,111 @@ class GlobalBuffer
     unsigned long getBuffersMaxSize() const { return m_buffer_max_size; }
 
     /*! Remove a buffer
-     *  \param buffer_name is the name of the buffer to remove
+     *  \param series is the series ID of the buffer to remove
      */
-    void remove( const std::string& buffer_name );
+    void remove( series_id series );
+
+    /*! Getter for the number of shards
+     *  \return the number of shards
+     */
+    size_t getNbrShards() const { return m_shards.size(); }
+
+    /*! Get the number of full buffers waiting to be sent (usefull for statistics)
+     *  \return the flush queue depth, 0 if there is no flush queue
+     */
+    size_t getFlushQueueDepth() const { return m_flush_queue ? m_flush_queue->size() : 0; }
 
   private:
 
+    /*! A partition of the message buffers */
+    struct Shard
+    {
+      /*! Message buffers associated to a series ID */
+      SeriesHashMap<message_buffer_ptr> buffers;
+
+      /*! Estimated size of the buffered messages once serialized */
+      size_t                            bytes = 0;
+
+      /*! Received timestamp of the oldest message (in milliseconds), 0 if the shard is empty */
+      ulong                             oldest = 0;
+
+      /*! Mutex for thread safety */
+      mutable boost::mutex              mutex;
+    };
+
+    /*! Get the shard holding the buffer of a series
+     *  \param series is the series ID
+     *  \return the shard of the series
+     */
+    Shard& shard( series_id series ) const { return *m_shards[series % m_shards.size()]; }
+
+    /*! Estimate the size of messages of a series once serialized
+     *  \param name         is the series name
+     *  \param nbr_messages is the number of messages
+     *  \return the estimated number of bytes
+     */
+    static size_t cost( const std::string &name, size_t nbr_messages ) { return ( name.size() + GLOBAL_BUFFER_MESSAGE_OVERHEAD ) * nbr_messages; }
+
+    /*! Count messages added to a shard
+     *  \param shard is the shard, it must be locked
+     *  \param bytes is the estimated size of the messages
+     *  \return true if the buffered messages have just reached the flush trigger size
+     */
+    bool addBytes( Shard &shard, size_t bytes );
+
+    /*! Count messages taken from a shard
+     *  \param shard is the shard, it must be locked
+     *  \param bytes is the estimated size of the messages
+     */
+    void removeBytes( Shard &shard, size_t bytes );
+
+    /*! Count the received timestamp of messages added to a shard
+     *  \param shard    is the shard, it must be locked
+     *  \param received is the received timestamp of the oldest added message (in milliseconds)
+     */
+    static void addOldest( Shard &shard, ulong received );
+
+    /*! Find the oldest message of a shard again, once messages have been taken from it
+     *  \param shard is the shard, it must be locked
+     */
+    static void updateOldest( Shard &shard );
+
+    /*! Send the messages of a full buffer, or put them back into their buffer if they can't be sent
+     *  \param series   is the series ID of the messages
+     *  \param messages are the messages to send
+     */
+    void flush( series_id series, std::vector<Message> &messages );
+
+    /*! Put back a range of messages of the same series into their buffer
+     *  \param series is the series ID of the messages
+     *  \param begin  is the first message to put back
+     *  \param end    is the end of the range
+     */
+    void restore( series_id series, std::vector<Message>::const_iterator begin, std::vector<Message>::const_iterator end );
+
     /*! Maximum number of messages that can be stored into one messages buffer */
     const unsigned long                       m_buffer_max_size;
 
     /*! When a buffer reaches its maximum size, tells if we drop oldest messages to get free space */
     bool                                      m_drop_oldest;
 
-    /*! Message buffers associated to a unique name */
-    std::map<std::string, message_buffer_ptr> m_buffers;
+    /*! Message buffers partitioned by series ID */
+    std::vector<boost::shared_ptr<Shard>>     m_shards;
 
     /*! An instance of the Client */
     networking::client_ptr                    m_client;
 
-    /*! Mutex for thread safety */
-    mutable boost::mutex                      m_buffers_mutex;
+    /*! Full buffers waiting to be sent (null if they are queued to the client by the thread adding the message) */
+    flush_queue_ptr                           m_flush_queue;
+
+    /*! Estimated size of all buffered messages once serialized */
+    std::atomic<size_t>                       m_buffered_bytes;
+
+    /*! Size of the buffered messages calling the flush trigger (0 if there is no trigger) */
+    size_t                                    m_flush_bytes;
+
+    /*! Function called when the buffered messages reach m_flush_bytes */
+    boost::function<void ()>                  m_flush_trigger;
 };
 
 typedef boost::shared_ptr<GlobalBuffer> global_buffer_ptr;
@@ -2,92 +2,154 @@
 
 #include <graphite_proxy/utils/logging/log_headers.hpp>
 
+#include <algorithm>
+
 namespace graphite_proxy {
 
+/*! Initial capacity of a message buffer storage */
+static const size_t MESSAGE_BUFFER_MIN_CAPACITY = 16;
+
 MessageBuffer::MessageBuffer( const std::string &name, unsigned long max_size, bool drop_oldest )
   : m_name( name )
   , m_max_size( max_size )
   , m_override( drop_oldest )
   , m_max_messages_at_same_time(0)
+  , m_head( 0 )
+  , m_size( 0 )
 {
-  if ( m_max_size > m_message_list.max_size() )
+  if ( m_max_size > m_messages.max_size() )
   {
-    LOG_WARNING( "The buffer max size is greater than the possible operating system list size possibilities, shrink it", utils::logging::LOG_HEADER_BUFFER );
-    m_max_size = m_message_list.max_size();
+    LOG_WARNING( "The buffer max size is greater than the possible operating system vector size possibilities, shrink it", utils::logging::LOG_HEADER_BUFFER );
+    m_max_size = m_messages.max_size();
   }
 }
 
-bool MessageBuffer::add( const message_ptr message )
+bool MessageBuffer::add( const Message &message )
 {
   boost::mutex::scoped_lock lock( m_mutex );
 
-  if ( m_message_list.size() >= m_max_size )
+  if ( m_size >= m_max_size )
   {
-    if ( m_override )
+    if ( m_override && m_max_size > 0 )
     {
       LOG_WARNING( "Buffer '" + m_name + "'" + " has reach its max size. Older messages will be override by new ones", utils::logging::LOG_HEADER_BUFFER );
-      m_message_list.pop_front(); // Remove the first message of the list to make free space
+
+      // The storage is at its maximum capacity: the newest message takes the place of the oldest one
+      m_messages[m_head] = message;
+      m_head = this->index( 1 );
+      return true;
     }
-    else // Ignore messages if the message list is full and we don't want to drop/override oldest messages
+    else // Ignore messages if the buffer is full and we don't want to drop/override oldest messages
     {
-      LOG_WARNING( "Buffer '" + m_name + "'" + " is full, droping incoming message: " + message->serialize(), utils::logging::LOG_HEADER_BUFFER );
+      LOG_WARNING( "Buffer '" + m_name + "'" + " is full, droping incoming message: " + message.serialize(), utils::logging::LOG_HEADER_BUFFER );
       return false;
     }
   }
 
-  // Store the message into the message list
-  m_message_list.push_back( message );
+  if ( m_size == m_messages.size() )
+    this->grow( m_size + 1 );
+
+  // Store the message after the newest one
+  m_messages[this->index( m_size )] = message;
+  m_size++;
 
   // Update maximum number of messages that has been contained at the same time
-  const unsigned long current_nbr_messages = m_message_list.size();
-  if( current_nbr_messages > m_max_messages_at_same_time )
-    m_max_messages_at_same_time = current_nbr_messages;
+  if( m_size > m_max_messages_at_same_time )
+    m_max_messages_at_same_time = m_size;
 
   return true;
 }
 
-void MessageBuffer::get( std::vector<message_ptr> &target_buffer, unsigned long nbr )
+unsigned long MessageBuffer::requeue( std::vector<Message>::const_iterator begin, std::vector<Message>::const_iterator end )
+{
+  boost::mutex::scoped_lock lock( m_mutex );
+
+  size_t count = end - begin;
+  const size_t free_space = ( m_size < m_max_size ) ? m_max_size - m_size : 0;
+  if ( count > free_space )
+  {
+    LOG_WARNING( "Buffer '" + m_name + "'" + " is full, droping " + std::to_string( count - free_space ) + " messages put back", utils::logging::LOG_HEADER_BUFFER );
+
+    if ( m_override )
+      begin += count - free_space;
+    count = free_space;
+  }
+
+  if ( count == 0 )
+    return 0;
+
+  if ( m_size + count > m_messages.size() )
+    this->grow( m_size + count );
+
+  // The messages take the places before the oldest one
+  m_head = ( m_head >= count ) ? m_head - count : m_head + m_messages.size() - count;
+  for ( size_t i = 0; i < count; i++ )
+    m_messages[this->index( i )] = *( begin + i );
+  m_size += count;
+
+  // Update maximum number of messages that has been contained at the same time
+  if( m_size > m_max_messages_at_same_time )
+    m_max_messages_at_same_time = m_size;
+
+  return count;
+}
+
+void MessageBuffer::get( std::vector<Message> &target_buffer, unsigned long nbr )
 {
   boost::mutex::scoped_lock lock( m_mutex );
 
-  if ( m_message_list.empty() )
+  if ( m_size == 0 )
     return;
 
   // Get maximum number of existing item or all if nbr == 0
-  unsigned long list_size = m_message_list.size();
-  if ( nbr == 0 || nbr > list_size )
-    nbr = list_size;
+  if ( nbr == 0 || nbr > m_size )
+    nbr = m_size;
 
-  // Reserve the currently used space to prevent further memory reallocations
-  target_buffer.reserve( nbr );
+  // The messages are copied in at most two blocks: from the oldest one to the end of the storage, then from its beginning
+  const size_t first_block = std::min<size_t>( nbr, m_messages.size() - m_head );
+  target_buffer.insert( target_buffer.end(), m_messages.begin() + m_head, m_messages.begin() + m_head + first_block );
+  target_buffer.insert( target_buffer.end(), m_messages.begin(), m_messages.begin() + ( nbr - first_block ) );
 
-  // Fill the target buffer
-  for ( unsigned long i = 0; i < nbr; i++ )
-  {
-    target_buffer.push_back( m_message_list.front() );
-    m_message_list.pop_front();
-  }
+  m_size -= nbr;
+  m_head  = ( m_size == 0 ) ? 0 : this->index( nbr );
 }
 
-void MessageBuffer::getOlderThan( std::vector<message_ptr> &target_buffer, unsigned long max_timestamp )
+void MessageBuffer::getOlderThan( std::vector<Message> &target_buffer, unsigned long max_timestamp )
 {
   boost::mutex::scoped_lock lock( m_mutex );
 
-  if ( m_message_list.empty() )
+  if ( m_size == 0 )
     return;
 
-  //m_message_list.retrieveByTimestamp( target_buffer, max_timestamp );
-  unsigned long size = m_message_list.size();
-  for ( unsigned long i = 0; i < size; i++ )
+  // Keep the newer messages in place, packed after the oldest position and in the same order
+  unsigned long kept = 0;
+  for ( unsigned long i = 0; i < m_size; i++ )
   {
-    message_ptr message = m_message_list.front();
-    m_message_list.pop_front();
-    if ( message->getTimestamp() <= max_timestamp )
+    const Message &message = m_messages[this->index( i )];
+    if ( message.getTimestamp() <= max_timestamp )
       target_buffer.push_back( message );
-    else m_message_list.push_back( message );
+    else m_messages[this->index( kept++ )] = message;
   }
-}
 
-} // namespace graphite_proxy
+  m_size = kept;
+  if ( m_size == 0 )
+    m_head = 0;
+}
 
+void MessageBuffer::grow( size_t min_capacity )
+{
+  const size_t capacity = std::min<size_t>( std::max<size_t>( { m_messages.size() * 2, MESSAGE_BUFFER_MIN_CAPACITY, min_capacity } ), m_max_size );
+
+  // Copy the stored messages, starting from the oldest one
+  const size_t first_block = std::min<size_t>( m_size, m_messages.size() - m_head );
+  std::vector<Message> messages;
+  messages.reserve( capacity );
+  messages.insert( messages.end(), m_messages.begin() + m_head, m_messages.begin() + m_head + first_block );
+  messages.insert( messages.end(), m_messages.begin(), m_messages.begin() + ( m_size - first_block ) );
+  messages.resize( capacity );
+
+  m_messages.swap( messages );
+  m_head = 0;
+}
 
+} // namespace graphite_proxy
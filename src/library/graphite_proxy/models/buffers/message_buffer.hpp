@@ -9,11 +9,14 @@
 
 #include <vector>
 #include <string>
-#include <list>
 
 namespace graphite_proxy {
 
-/*! Buffer to store messages */
+/*! Buffer to store messages
+ *  Messages are stored into a circular buffer: adding a message, dropping the oldest one and retrieving them
+ *  never allocate memory once the buffer has reached its maximum size.
+ *  \note the storage grows by doubling up to the maximum size, so idle series don't hold the whole capacity
+ */
 class MessageBuffer
 {
   public:
@@ -30,7 +33,16 @@ class MessageBuffer
      *  \return true if the message has been added
      *  \note a false return means the buffer is currently full and has m_override member set to false
      */
-    bool add( const message_ptr message );
+    bool add( const Message &message );
+
+    /*! Put back messages before the oldest one, in the same order (usually messages which could not be sent)
+     *  \param begin is the first message to put back
+     *  \param end   is the end of the messages to put back
+     *  \return the number of messages put back
+     *  \note if there is not enough free space, the oldest of these messages are dropped when m_override is set,
+     *        the newest ones otherwise. The messages already into the buffer are never dropped.
+     */
+    unsigned long requeue( std::vector<Message>::const_iterator begin, std::vector<Message>::const_iterator end );
 
     /*! Get a specific amount of messages
      *  \param target_buffer is a target vector to store found messages
@@ -38,24 +50,30 @@ class MessageBuffer
      *  \note a nbr equal to 0 means get all messages into the buffer.
      *  \note this function remove the found messages from the buffer
      */
-    void get( std::vector<message_ptr> &target_buffer, unsigned long nbr = 0 );
+    void get( std::vector<Message> &target_buffer, unsigned long nbr = 0 );
 
     /*! Get all messages older or equal than a specific timestamp
      *  \param target_buffer is a target container to store found messages
      *  \param max_timestamp is the limit timestamp to accept messages
      *  \note this function remove the found messages from the buffer
      */
-    void getOlderThan( std::vector<message_ptr> &target_buffer, unsigned long max_timestamp );
+    void getOlderThan( std::vector<Message> &target_buffer, unsigned long max_timestamp );
 
     /*! Get the current size used into the buffer
      *  \return the current size used into the buffer
      */
-    unsigned long size() const { return m_message_list.size(); }
+    unsigned long size() const { return m_size; }
 
     /*! Does the buffer currently empty ?
      *  \return true if the buffer is empty
      */
-    bool empty() const { return m_message_list.empty(); }
+    bool empty() const { return m_size == 0; }
+
+    /*! Get the time the oldest message has been received
+     *  \return the received timestamp of the first message (in milliseconds), 0 if the buffer is empty
+     *  \note messages put back are older than the ones added meanwhile, so the first message is the oldest one
+     */
+    ulong getOldestReceivedTimestamp() const { return m_size == 0 ? 0 : m_messages[m_head].getReceivedTimestamp(); }
 
     /*! Get the name of the buffer
      *  \return the name of the buffer
@@ -74,6 +92,21 @@ class MessageBuffer
 
   private:
 
+    /*! Get the storage index of a message
+     *  \param position is the position of the message, 0 being the oldest one
+     *  \return the index of the message into m_messages
+     */
+    size_t index( size_t position ) const
+    {
+      const size_t index = m_head + position;
+      return ( index < m_messages.size() ) ? index : index - m_messages.size();
+    }
+
+    /*! Increase the storage capacity (up to m_max_size), the oldest message is moved at the beginning
+     *  \param min_capacity is the minimum capacity required
+     */
+    void grow( size_t min_capacity );
+
     /*! Name associtated to the buffer instance */
     const std::string                    m_name;
 
@@ -86,8 +119,14 @@ class MessageBuffer
     /*! maximum number of messages that has been contained at the same time */
     unsigned long                        m_max_messages_at_same_time;
 
-    /*! Forward list containing the messages */
-    std::list<message_ptr>               m_message_list;
+    /*! Circular storage of the messages, its size is the current capacity */
+    std::vector<Message>                 m_messages;
+
+    /*! Index of the oldest message into m_messages */
+    size_t                               m_head;
+
+    /*! Number of messages currently stored */
+    unsigned long                        m_size;
 
     /*! Mutex for thread safety */
     boost::mutex                         m_mutex;
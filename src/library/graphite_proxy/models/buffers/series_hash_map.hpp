@@ -0,0 +1,180 @@
+#ifndef GRAPHITE_PROXY_SERIES_HASH_MAP_HPP
+#define GRAPHITE_PROXY_SERIES_HASH_MAP_HPP
+
+#include <graphite_proxy/models/series_table.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace graphite_proxy {
+
+/*! Open addressing hash table (linear probing) associating a value to a series ID
+ *  Keys and values are stored into contiguous arrays, there is no allocation per entry.
+ *  INVALID_SERIES_ID marks a free slot, so it can't be used as a key.
+ *  \note this class is not thread safe
+ */
+template <class T>
+class SeriesHashMap
+{
+  public:
+
+    /*! Constructor */
+    SeriesHashMap()
+      : m_size( 0 )
+      , m_bits( 0 )
+    {
+      this->rehash( MIN_CAPACITY_BITS );
+    }
+
+    /*! Find the value associated to a series
+     *  \param series is the series ID to search for
+     *  \return a pointer to the value or null if the series is unknown
+     */
+    T* find( series_id series )
+    {
+      const size_t slot = this->findSlot( series );
+      return ( m_keys[slot] == series ) ? &m_values[slot] : nullptr;
+    }
+
+    /*! Get the value associated to a series, a default value is inserted if the series is unknown
+     *  \param series is the series ID (must not be INVALID_SERIES_ID)
+     *  \return a reference to the value (valid until the next insertion or removal)
+     */
+    T& operator[]( series_id series )
+    {
+      size_t slot = this->findSlot( series );
+      if( m_keys[slot] == series )
+        return m_values[slot];
+
+      // Keep the load factor under 1/2 so the probe sequences stay short
+      if( ( m_size + 1 ) * 2 > m_keys.size() )
+      {
+        this->rehash( m_bits + 1 );
+        slot = this->findSlot( series );
+      }
+
+      m_keys[slot] = series;
+      m_size++;
+      return m_values[slot];
+    }
+
+    /*! Remove a series
+     *  \param series is the series ID to remove
+     *  \return true if the series has been removed
+     *  \note the following entries of the probe sequence are shifted back, so there is no tombstone
+     */
+    bool erase( series_id series )
+    {
+      size_t hole = this->findSlot( series );
+      if( m_keys[hole] != series )
+        return false;
+
+      const size_t mask = m_keys.size() - 1;
+      for( size_t next = ( hole + 1 ) & mask; m_keys[next] != INVALID_SERIES_ID; next = ( next + 1 ) & mask )
+      {
+        // An entry can fill the hole only if the hole is between its ideal slot and its current slot
+        const size_t ideal = this->idealSlot( m_keys[next] );
+        if( ( ( next - ideal ) & mask ) >= ( ( next - hole ) & mask ) )
+        {
+          m_keys[hole]   = m_keys[next];
+          m_values[hole] = m_values[next];
+          hole           = next;
+        }
+      }
+
+      m_keys[hole]   = INVALID_SERIES_ID;
+      m_values[hole] = T();
+      m_size--;
+      return true;
+    }
+
+    /*! Call a function on each entry
+     *  \param function is called with the series ID and a reference on its value
+     */
+    template <class F>
+    void forEach( F function ) const
+    {
+      for( size_t slot = 0, capacity = m_keys.size(); slot < capacity; slot++ )
+      {
+        if( m_keys[slot] != INVALID_SERIES_ID )
+          function( m_keys[slot], m_values[slot] );
+      }
+    }
+
+    /*! Get the number of entries
+     *  \return the number of entries
+     */
+    size_t size() const { return m_size; }
+
+    /*! Is the map empty ?
+     *  \return true if there is no entry
+     */
+    bool empty() const { return m_size == 0; }
+
+  private:
+
+    /*! Minimum capacity of the table (as a power of 2) */
+    static const unsigned int MIN_CAPACITY_BITS = 4;
+
+    /*! Get the first slot of the probe sequence of a series (Fibonacci hashing, consecutive IDs are spread over the table)
+     *  \param series is the series ID
+     *  \return the ideal slot of the series
+     */
+    size_t idealSlot( series_id series ) const
+    {
+      return static_cast<uint32_t>( series * 2654435769u ) >> ( 32 - m_bits );
+    }
+
+    /*! Find the slot of a series or the free slot where it would be inserted
+     *  \param series is the series ID
+     *  \return a slot index
+     */
+    size_t findSlot( series_id series ) const
+    {
+      const size_t mask = m_keys.size() - 1;
+      size_t slot = this->idealSlot( series );
+      while( m_keys[slot] != series && m_keys[slot] != INVALID_SERIES_ID )
+        slot = ( slot + 1 ) & mask;
+
+      return slot;
+    }
+
+    /*! Change the capacity of the table and insert again all entries
+     *  \param bits is the new capacity (as a power of 2)
+     */
+    void rehash( unsigned int bits )
+    {
+      std::vector<series_id> keys( size_t(1) << bits, INVALID_SERIES_ID );
+      std::vector<T>         values( size_t(1) << bits );
+      keys.swap( m_keys );
+      values.swap( m_values );
+      m_bits = bits;
+
+      for( size_t slot = 0, capacity = keys.size(); slot < capacity; slot++ )
+      {
+        if( keys[slot] != INVALID_SERIES_ID )
+        {
+          const size_t new_slot = this->findSlot( keys[slot] );
+          m_keys[new_slot]   = keys[slot];
+          m_values[new_slot] = values[slot];
+        }
+      }
+    }
+
+    /*! Series ID of each slot (INVALID_SERIES_ID for a free slot) */
+    std::vector<series_id> m_keys;
+
+    /*! Value of each slot */
+    std::vector<T>         m_values;
+
+    /*! Number of entries */
+    size_t                 m_size;
+
+    /*! Capacity of the table as a power of 2 */
+    unsigned int           m_bits;
+};
+
+} // namespace graphite_proxy
+
+#endif // GRAPHITE_PROXY_SERIES_HASH_MAP_HPP
@@ -0,0 +1,76 @@
+#include "aggregator.hpp"
+
+#include <algorithm>
+#include <math.h>
+
+namespace graphite_proxy {
+namespace maths {
+
+Aggregator::Aggregator()
+  : m_count( 0 )
+  , m_sum( 0 )
+  , m_mean( 0 )
+  , m_m2( 0 )
+  , m_min( 0 )
+  , m_max( 0 )
+  , m_timestamp( 0 )
+{
+  // Nothing
+}
+
+void Aggregator::add( double value, ulong timestamp )
+{
+  if( m_count == 0 )
+  {
+    m_min = value;
+    m_max = value;
+  }
+  else
+  {
+    m_min = std::min( m_min, value );
+    m_max = std::max( m_max, value );
+  }
+
+  m_count++;
+  m_sum += value;
+  m_timestamp = std::max( m_timestamp, timestamp );
+
+  // Welford update: the new mean, then the squared difference with both means
+  const double delta = value - m_mean;
+  m_mean += delta / m_count;
+  m_m2   += delta * ( value - m_mean );
+}
+
+void Aggregator::getValues( std::vector<double> &values ) const
+{
+  if( m_count == 0 )
+    return;
+
+  values.push_back( m_min );
+  if( m_count == 1 )
+    return;
+
+  values.push_back( m_max );
+  const size_t others = m_count - 2;
+  if( others == 0 )
+    return;
+
+  // Mean and squared differences left for the other values, which are spread evenly on both sides of their mean
+  const double mean  = std::min( std::max( ( m_sum - m_min - m_max ) / others, m_min ), m_max );
+  const double delta = mean - m_mean;
+  const double m2    = m_m2 - ( m_min - m_mean ) * ( m_min - m_mean ) - ( m_max - m_mean ) * ( m_max - m_mean ) - others * delta * delta;
+
+  const size_t pairs  = others / 2;
+  const double spread = ( pairs > 0 && m2 > 0 ) ? sqrt( m2 / ( 2 * pairs ) ) : 0;
+  for( size_t i = 0; i < pairs; i++ )
+  {
+    values.push_back( std::max( mean - spread, m_min ) );
+    values.push_back( std::min( mean + spread, m_max ) );
+  }
+
+  if( others % 2 != 0 )
+    values.push_back( mean );
+}
+
+} // namespace maths
+} // namespace graphite_proxy
@@ -0,0 +1,106 @@
+#ifndef GRAPHITE_PROXY_AGGREGATOR_HPP
+#define GRAPHITE_PROXY_AGGREGATOR_HPP
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace graphite_proxy {
+namespace maths {
+
+/*! Running statistics of the values of a window (count, sum, min, max, mean and variance)
+ *  Each value updates the statistics in constant time and memory, the values themselves are not kept.
+ *  The mean and the variance use the Welford algorithm, which stays accurate when the values are large and close.
+ */
+class Aggregator
+{
+  public:
+
+    /*! Constructor of an empty aggregator */
+    Aggregator();
+
+    /*! Add a value
+     *  \param value     is the value to add
+     *  \param timestamp is the timestamp of the value (in seconds)
+     */
+    void add( double value, ulong timestamp );
+
+    /*! Get values having the same statistics than the added values (one value per added value)
+     *  \param values receives the smallest value, the largest one, then values spread around the mean of the others
+     *  \note the count, the sum, the mean, the smallest and the largest values are exact, the variance too unless the values
+     *        are very skewed (the spread values are bounded by the smallest and the largest ones)
+     */
+    void getValues( std::vector<double> &values ) const;
+
+    /*! Forget all values */
+    void reset() { *this = Aggregator(); }
+
+    /*! Has no value been added
+     *  \return true if the aggregator is empty
+     */
+    bool empty() const { return m_count == 0; }
+
+    /*! Getter for the number of values
+     *  \return the number of values
+     */
+    size_t getCount() const { return m_count; }
+
+    /*! Getter for the sum of the values
+     *  \return the sum, 0 if there is no value
+     */
+    double getSum() const { return m_sum; }
+
+    /*! Getter for the mean of the values
+     *  \return the mean, 0 if there is no value
+     */
+    double getMean() const { return m_mean; }
+
+    /*! Get the population variance of the values
+     *  \return the variance, 0 if there is no value
+     */
+    double getVariance() const { return ( m_count > 0 ) ? m_m2 / m_count : 0; }
+
+    /*! Getter for the smallest value
+     *  \return the smallest value, 0 if there is no value
+     */
+    double getMin() const { return m_min; }
+
+    /*! Getter for the largest value
+     *  \return the largest value, 0 if there is no value
+     */
+    double getMax() const { return m_max; }
+
+    /*! Getter for the most recent timestamp of the values
+     *  \return the timestamp (in seconds), 0 if there is no value
+     */
+    ulong getTimestamp() const { return m_timestamp; }
+
+  private:
+
+    /*! Number of values */
+    size_t m_count;
+
+    /*! Sum of the values */
+    double m_sum;
+
+    /*! Running mean of the values */
+    double m_mean;
+
+    /*! Sum of the squared differences to the mean */
+    double m_m2;
+
+    /*! Smallest value */
+    double m_min;
+
+    /*! Largest value */
+    double m_max;
+
+    /*! Most recent timestamp of the values */
+    ulong  m_timestamp;
+};
+
+} // namespace maths
+} // namespace graphite_proxy
+
+#endif // GRAPHITE_PROXY_AGGREGATOR_HPP
@@ -0,0 +1,80 @@
+#include "category_matcher.hpp"
+
+#include <graphite_proxy/utils/logging/logger.hpp>
+#include <graphite_proxy/utils/logging/log_headers.hpp>
+
+namespace graphite_proxy {
+namespace maths {
+
+CategoryMatcher::CategoryMatcher( const std::list<MathsCategory*> &categories )
+  : m_categories( categories )
+  , m_is_sequential( false )
+{
+  // Back references count the groups of the filter, they would be wrong once the filters are combined
+  const boost::regex back_reference( "\\\\([1-9]|g|k)|\\(\\?P=|\\(\\?\\(" );
+
+  std::string pattern;
+  size_t group = 1;
+  for( MathsCategory* category : m_categories )
+  {
+    const boost::regex &filter = category->getFilter();
+    if( boost::regex_search( filter.str(), back_reference ) )
+      m_is_sequential = true;
+
+    pattern += ( pattern.empty() ? "(" : "|(" ) + filter.str() + ")";
+    m_groups.push_back( std::make_pair( group, category ) );
+    group += filter.mark_count() + 1;
+  }
+
+  if( m_is_sequential || m_categories.empty() )
+    return;
+
+  try
+  {
+    m_filter.assign( pattern );
+  }
+  catch( const boost::regex_error &e )
+  {
+    LOG_WARNING( std::string( "Can't combine the category filters, matching them one by one: " ) + e.what(), utils::logging::LOG_HEADER_MATHS );
+    m_is_sequential = true;
+  }
+}
+
+CategoryMatcher::~CategoryMatcher()
+{
+  for( MathsCategory* category : m_categories )
+    delete category;
+}
+
+MathsCategory* CategoryMatcher::find( const std::string &message_type ) const
+{
+  if( m_categories.empty() )
+    return nullptr;
+
+  if( m_is_sequential )
+  {
+    for( MathsCategory* category : m_categories )
+    {
+      if( boost::regex_match( message_type, category->getFilter() ) )
+        return category;
+    }
+
+    return nullptr;
+  }
+
+  // Alternatives are tried in order, so the group of the first category matching the whole type is set
+  boost::smatch groups;
+  if( !boost::regex_match( message_type, groups, m_filter ) )
+    return nullptr;
+
+  for( const std::pair<size_t, MathsCategory*> &group : m_groups )
+  {
+    if( groups[group.first].matched )
+      return group.second;
+  }
+
+  return nullptr;
+}
+
+} // namespace maths
+} // namespace graphite_proxy
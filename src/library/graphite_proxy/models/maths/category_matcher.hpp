@@ -0,0 +1,67 @@
+#ifndef GRAPHITE_PROXY_CATEGORY_MATCHER_HPP
+#define GRAPHITE_PROXY_CATEGORY_MATCHER_HPP
+
+#include <graphite_proxy/models/maths/math_category.hpp>
+
+#include <boost/noncopyable.hpp>
+#include <boost/regex.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace graphite_proxy {
+namespace maths {
+
+/*! Find the category of a message type with all the category filters at once
+ *  The filters are compiled into a single alternation, each one in its own group, so a message type is matched in one call
+ *  instead of one call per category. The first category (in the configuration order) matching the whole type wins.
+ *  A matcher is immutable once built: it can be shared between threads without lock.
+ *  \note the matcher owns the categories, they are deleted with it
+ */
+class CategoryMatcher : public boost::noncopyable
+{
+  public:
+
+    /*! Constructor
+     *  \param categories are the categories, in priority order (the matcher takes their ownership)
+     */
+    CategoryMatcher( const std::list<MathsCategory*> &categories );
+
+    /*! Destructor, delete the categories */
+    ~CategoryMatcher();
+
+    /*! Find the category wanting a message type
+     *  \param message_type is the type of the message
+     *  \return the first category whose filter matches the type, null if no category wants it
+     */
+    MathsCategory* find( const std::string &message_type ) const;
+
+    /*! Getter for the categories
+     *  \return the categories, in priority order
+     */
+    const std::list<MathsCategory*>& getCategories() const { return m_categories; }
+
+  private:
+
+    /*! Categories, in priority order */
+    std::list<MathsCategory*>                      m_categories;
+
+    /*! Group of each category in the combined filter */
+    std::vector<std::pair<size_t, MathsCategory*>> m_groups;
+
+    /*! Alternation of all the filters */
+    boost::regex                                   m_filter;
+
+    /*! Are the filters matched one by one (when they can't be combined) */
+    bool                                           m_is_sequential;
+};
+
+typedef boost::shared_ptr<const CategoryMatcher> category_matcher_ptr;
+
+} // namespace maths
+} // namespace graphite_proxy
+
+#endif // GRAPHITE_PROXY_CATEGORY_MATCHER_HPP
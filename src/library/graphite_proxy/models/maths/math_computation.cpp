@@ -3,7 +3,9 @@
 #include <graphite_proxy/models/maths/properties.hpp>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 
+#include <algorithm>
 #include <sstream>
 
 namespace graphite_proxy {
@@ -27,6 +29,50 @@ std::string MathComputation::getOption( const std::string &option_name ) const
     return m_options.at(option_name);
 }
 
+bool MathComputation::setPercentiles( const std::string &values )
+{
+  std::vector<std::string> items;
+  boost::split( items, values, boost::is_any_of( ", \t" ), boost::token_compress_on );
+
+  std::vector<double> percentiles;
+  for( const std::string &item : items )
+  {
+    if( item.empty() )
+      continue;
+
+    try
+    {
+      percentiles.push_back( boost::lexical_cast<double>( item ) );
+    }
+    catch ( const boost::bad_lexical_cast & )
+    {
+      LOG_ERROR( "Bad percentile: " + item, utils::logging::LOG_HEADER_MATHS_COMPUTATION );
+      return false;
+    }
+
+    if( percentiles.back() < 0 || percentiles.back() > 100 )
+    {
+      LOG_ERROR( "Percentile out of [0, 100]: " + item, utils::logging::LOG_HEADER_MATHS_COMPUTATION );
+      return false;
+    }
+  }
+
+  if( percentiles.empty() )
+    return false;
+
+  m_percentiles = percentiles;
+  return true;
+}
+
+std::string MathComputation::percentileSuffix( double percentile )
+{
+  std::stringstream suffix;
+  suffix << ".p" << percentile;
+  std::string result = suffix.str();
+  std::replace( result.begin() + 1, result.end(), '.', '_' );
+  return result;
+}
+
 bool MathComputation::isOnCount() const
 {
   return !m_iteration_time;
@@ -37,6 +83,11 @@ bool MathComputation::isOnTimeIteration() const
   return m_iteration_time;
 }
 
+bool MathComputation::isStreamable() const
+{
+  return m_type == SUM || m_type == AVERAGE || m_type == MIN || m_type == MAX || m_type == VARIANCE || m_type == DEVIATION || m_type == PERCENTILE;
+}
+
 ComputationType MathComputation::getType() const
 {
   return m_type;
@@ -104,6 +155,8 @@ ComputationType MathComputation::stringToComputationType( const std::string &str
     return VARIANCE;
   else if (lower_type == NODE_DEVIATION)
     return DEVIATION;
+  else if (lower_type == NODE_PERCENTILE)
+    return PERCENTILE;
   else
   {
     LOG_WARNING( "Unknown mathematical operation: " + lower_type, utils::logging::LOG_HEADER_MATHS_COMPUTATION );
@@ -115,15 +168,16 @@ std::string MathComputation::computationTypeToString( ComputationType computatio
 {
   switch( computation_type )
   {
-    case SUM:       return NODE_SUM;
-    case MAX:       return NODE_MAX;
-    case MIN:       return NODE_MIN;
-    case AVERAGE:   return NODE_AVERAGE;
-    case MEDIAN:    return NODE_MEDIAN;
-    case TILES:     return NODE_TILES;
-    case VARIANCE:  return NODE_VARIANCE;
-    case DEVIATION: return NODE_DEVIATION;
-    default:        return XML_UNKNOWN;
+    case SUM:        return NODE_SUM;
+    case MAX:        return NODE_MAX;
+    case MIN:        return NODE_MIN;
+    case AVERAGE:    return NODE_AVERAGE;
+    case MEDIAN:     return NODE_MEDIAN;
+    case TILES:      return NODE_TILES;
+    case VARIANCE:   return NODE_VARIANCE;
+    case DEVIATION:  return NODE_DEVIATION;
+    case PERCENTILE: return NODE_PERCENTILE;
+    default:         return XML_UNKNOWN;
   }
 }
 
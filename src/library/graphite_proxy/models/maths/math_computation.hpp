@@ -6,12 +6,13 @@
 
 #include <sys/types.h>
 #include <map>
+#include <vector>
 
 namespace graphite_proxy {
 namespace maths {
 
 /*! Possible math operations */
-enum ComputationType { SUM = 0, AVERAGE = 1, MIN = 2, MAX = 3, MEDIAN = 4, TILES = 5, VARIANCE = 6, DEVIATION = 7, UNKNOWN = 8 };
+enum ComputationType { SUM = 0, AVERAGE = 1, MIN = 2, MAX = 3, MEDIAN = 4, TILES = 5, VARIANCE = 6, DEVIATION = 7, PERCENTILE = 8, UNKNOWN = 9 };
 
 /*! A MathComputation represents a node from the maths.xml file
  *  It's a mathematical operation to do when a specific amount of messages or time has been reach
@@ -40,6 +41,23 @@ class MathComputation
      */
     std::string getOption( const std::string &option_name ) const;
 
+    /*! Set the percentiles to compute (percentile computations only)
+     *  \param values is a list of percentiles between 0 and 100 separated by commas (like "50,90,99.9")
+     *  \return false if a percentile is not valid, the percentiles are left untouched
+     */
+    bool setPercentiles( const std::string &values );
+
+    /*! Getter for the percentiles to compute
+     *  \return the percentiles, between 0 and 100
+     */
+    const std::vector<double>& getPercentiles() const { return m_percentiles; }
+
+    /*! Get the suffix of the series of a percentile (the series of 99.9 is the computed series followed by ".p99_9")
+     *  \param percentile is the percentile
+     *  \return the suffix to add to the series name
+     */
+    static std::string percentileSuffix( double percentile );
+
     /*! Is this computation waiting for a specific amount of messages to compute
      *  \return true if this computation is waiting for a specific amount of messages to compute
      */
@@ -50,6 +68,17 @@ class MathComputation
      */
     bool isOnTimeIteration() const;
 
+    /*! Can this computation be updated value by value, without keeping the values (sum, average, min, max, variance, deviation, percentile)
+     *  \return true if the computation only needs running statistics
+     */
+    bool isStreamable() const;
+
+    /*! Does another computation have the same window (so both can be computed on the same values)
+     *  \param other is the computation to compare with
+     *  \return true if both are on count (or both on time) with the same value
+     */
+    bool isSameWindow( const MathComputation &other ) const { return m_iteration_time == other.m_iteration_time && m_value == other.m_value; }
+
     /*! Get the mathematical type of the computation
      *  \return the mathematical type of the computation
      */
@@ -123,6 +152,9 @@ class MathComputation
 
     /*! Options for the Math Computation (like 'below' or 'multiplicator') */
     std::map<std::string, std::string> m_options;
+
+    /*! Percentiles to compute, between 0 and 100 (percentile computations only) */
+    std::vector<double>                m_percentiles;
 };
 
 } // namespace maths
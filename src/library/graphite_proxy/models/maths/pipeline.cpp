@@ -3,6 +3,7 @@
 #include <graphite_proxy/utils/time.hpp>
 #include <graphite_proxy/utils/logging/log_headers.hpp>
 
+#include <graphite_proxy/models/series_table.hpp>
 #include <graphite_proxy/models/statistics/statistics_metrics.hpp>
 #include <graphite_proxy/models/statistics/statistics.hpp>
 
@@ -20,6 +21,8 @@ namespace maths {
 MathsPipeline::MathsPipeline( const std::string &conf_filepath, global_buffer_ptr global_buffer, unsigned long sleep_time, unsigned long buffer_max_size )
   : Iterations( sleep_time, utils::logging::LOG_HEADER_MATHS )
   , m_buffer( global_buffer )
+  , m_matcher( boost::make_shared<const CategoryMatcher>( std::list<MathsCategory*>() ) )
+  , m_generation( 0 )
   , m_buffer_max_size( buffer_max_size )
 {
   m_valid = this->loadConfigurations( conf_filepath );
@@ -30,10 +33,7 @@ MathsPipeline::MathsPipeline( const std::string &conf_filepath, global_buffer_pt
 
 MathsPipeline::~MathsPipeline()
 {
-  // Delete categories
-  this->clearCategories();
-
-  // Delete buffers
+  // Delete buffers (the categories are deleted with the matcher)
   for( auto it = m_buffers.begin(); it != m_buffers.end(); ++it )
   {
     std::vector<MathOperation*>& operations = it->second;
@@ -44,12 +44,21 @@ MathsPipeline::~MathsPipeline()
 
 void MathsPipeline::clearCategories()
 {
-  // Delete each category pointer
-  std::list<MathsCategory*>::iterator it;
-  for( it = m_categories.begin(); it != m_categories.end(); ++it )
-    delete *it;
+  // The previous categories are deleted once no reader uses them anymore
+  this->setCategories( std::list<MathsCategory*>() );
+}
+
+void MathsPipeline::setCategories( const std::list<MathsCategory*> &categories )
+{
+  boost::atomic_store( &m_matcher, boost::make_shared<const CategoryMatcher>( categories ) );
 
-  m_categories.clear();
+  // Increased once the new matcher is visible, so a decision taken with the previous one can't get the new generation
+  m_generation.fetch_add( 1, std::memory_order_release );
+}
+
+std::list<MathsCategory*> MathsPipeline::getCategories() const
+{
+  return boost::atomic_load( &m_matcher )->getCategories();
 }
 
 bool MathsPipeline::reloadConfigurations( const std::string &conf_filepath )
@@ -58,11 +67,13 @@ bool MathsPipeline::reloadConfigurations( const std::string &conf_filepath )
 
   boost::mutex::scoped_lock lock( m_mutex );
 
+  // The previous categories are used until the new ones replace them, so the maths messages are never sent as they are
+  if( this->loadConfigurations( conf_filepath ) )
+    return true;
+
   // Reset previous configurations
   this->clearCategories();
-
-  // Load configurations
-  return this->loadConfigurations( conf_filepath );
+  return false;
 }
 
 bool MathsPipeline::loadConfigurations( const std::string &conf_filepath )
@@ -117,6 +128,7 @@ bool MathsPipeline::loadConfigurations( const std::string &conf_filepath )
   const boost::regex regex_time( REGEX_TIME );
 
   // Go throw each "category" node
+  std::list<MathsCategory*> categories;
   for( boost::property_tree::ptree::iterator it = root.begin(); it != root.end(); ++it )
   {
     // Is it a "category" node?
@@ -196,6 +208,14 @@ bool MathsPipeline::loadConfigurations( const std::string &conf_filepath )
           }
           else LOG_ERROR( computation_string + " need a '" + ATTRIBUTE_VALUE + "' attribute in category: " + category_filter_name, m_name );
         }
+        else if ( computation_type == PERCENTILE )
+        {
+          if ( !computation.setPercentiles( operation_node.get( value_property, "" ) ) )
+          {
+            LOG_ERROR( computation_string + " need a '" + ATTRIBUTE_VALUE + "' attribute with percentiles in category: " + category_filter_name, m_name );
+            continue;
+          }
+        }
 
         LOG_DEBUG( std::string("Adding computation: ") + computation_string, m_name );
         category->addComputation( computation );
@@ -211,11 +231,14 @@ bool MathsPipeline::loadConfigurations( const std::string &conf_filepath )
     else
     {
       LOG_DEBUG( std::string("Creating category: ") + category_filter_name, m_name );
-      m_categories.push_back( category );
+      categories.push_back( category );
     }
   }
 
-  if ( m_categories.empty() )
+  // All the categories are published at once
+  this->setCategories( categories );
+
+  if ( categories.empty() )
   {
     LOG_WARNING( "No categories to load, disable Maths module", m_name );
     return false;
@@ -235,26 +258,30 @@ void MathsPipeline::iteration()
   // Inspect each buffer
   for( auto it = m_buffers.begin(); it != m_buffers.end(); ++it )
   {
-    // Retrieve Maths Computations of this buffer
-    const std::string&          message_type = it->first;
+    // Retrieve Maths Operations of this buffer
     std::vector<MathOperation*>& operations  = it->second;
 
     // Inspect each operations to do with this buffer
     for( size_t i = 0, operations_size = operations.size(); i < operations_size; i++ )
     {
-      MathComputation& computation  = operations[i]->computation;
-      MessageBuffer& message_buffer = operations[i]->buffer;
+      MathOperation& operation      = *operations[i];
+      MathComputation& computation  = operation.window();
+      MessageBuffer& message_buffer = operation.buffer;
 
       if( computation.isOnCount() )
       {
+        // Streamable computations on count are done as soon as their window is full
+        if( operation.streamable )
+          continue;
+
         // Computation on number of received messages
         const size_t buffer_size       = message_buffer.size();
         const size_t computation_count = computation.getCount();
 
         if( buffer_size >= computation_count )
-          this->computeOnCount( computation, message_buffer );
+          this->computeOnCount( operation );
         else
-          LOG_DEBUG( message_type + " => onCount not ready, need " + std::to_string(computation_count) + " <= " + std::to_string(buffer_size), m_name );
+          LOG_DEBUG( message_buffer.getName() + " => onCount not ready, need " + std::to_string(computation_count) + " <= " + std::to_string(buffer_size), m_name );
       }
       else if( computation.isOnTimeIteration() )
       {
@@ -262,33 +289,54 @@ void MathsPipeline::iteration()
         const ulong next_iteration_time = computation.nextIterationTime();
 
         if( now >= next_iteration_time )
-          this->computeOnTime( computation, message_buffer, now );
+          this->computeOnTime( operation, now );
         else
         {
-          if( !message_buffer.empty() )
-            LOG_DEBUG( message_type + " => onTime not ready, need " + std::to_string(next_iteration_time) + " <= " + std::to_string(now), m_name );
+          if( operation.size() > 0 )
+            LOG_DEBUG( message_buffer.getName() + " => onTime not ready, need " + std::to_string(next_iteration_time) + " <= " + std::to_string(now), m_name );
         }
       }
     }
   }
 }
 
-void MathsPipeline::computeOnCount( MathComputation& computation, MessageBuffer& message_buffer )
+void MathsPipeline::computeOnCount( MathOperation &operation )
 {
-  std::vector<message_ptr> messages;
-  message_buffer.get( messages, computation.getCount() );
+  std::vector<Message> messages;
+  operation.buffer.get( messages, operation.window().getCount() );
 
-  LOG_DEBUG( message_buffer.getName() + " => onCount of " + std::to_string(messages.size()) + " messages", m_name );
+  LOG_DEBUG( operation.buffer.getName() + " => onCount of " + std::to_string(messages.size()) + " messages", m_name );
 
-  this->compute( messages, computation );
+  this->compute( messages, operation );
 }
 
-void MathsPipeline::computeOnTime( MathComputation& computation, MessageBuffer& message_buffer, unsigned long now )
+void MathsPipeline::computeOnTime( MathOperation &operation, unsigned long now )
 {
+  MathComputation& computation  = operation.window();
+  MessageBuffer& message_buffer = operation.buffer;
+
   // Compute messages for each window of iteration time
   do
   {
-    std::vector<message_ptr> messages;
+    if( operation.streamable )
+    {
+      if( operation.current.empty() )
+      {
+        // The window restarts now, the values received after the previous one belong to it
+        LOG_DEBUG( message_buffer.getName() + " => onTime no old enougth messages to compute", m_name );
+        computation.setLastComputeTime( now );
+        operation.shift();
+        break;
+      }
+
+      LOG_DEBUG( message_buffer.getName() + " => onTime of " + std::to_string(operation.current.getCount()) + " messages to compute", m_name );
+      this->compute( operation );
+      operation.shift();
+      computation.incrementLastComputeTime();
+      continue;
+    }
+
+    std::vector<Message> messages;
     message_buffer.getOlderThan( messages, computation.nextIterationTime() );
 
     if( messages.empty() )
@@ -300,14 +348,14 @@ void MathsPipeline::computeOnTime( MathComputation& computation, MessageBuffer&
     else
     {
       LOG_DEBUG( message_buffer.getName() + " => onTime of " + std::to_string(messages.size()) + " messages to compute", m_name );
-      this->compute( messages, computation );
+      this->compute( messages, operation );
       computation.incrementLastComputeTime();
     }
   }
   while( now > computation.nextIterationTime() );
 }
 
-void MathsPipeline::get( std::vector<message_ptr> &target_container )
+void MathsPipeline::get( std::vector<Message> &target_container )
 {
   boost::mutex::scoped_lock lock( m_mutex );
 
@@ -315,68 +363,125 @@ void MathsPipeline::get( std::vector<message_ptr> &target_container )
   {
     std::vector<MathOperation*>& operations = it->second;
     for( size_t j = 0, operations_size = operations.size(); j < operations_size; j++ )
-      operations[j]->buffer.get( target_container );
+      operations[j]->get( target_container );
   }
 }
 
-bool MathsPipeline::add( message_ptr message, const std::string& computation_type )
+MathOperation::MathOperation( const std::vector<MathComputation>& _computations, const std::string &name, unsigned long max_size, series_id _series )
+  : computations(_computations)
+  , streamable(true)
+  , with_distribution(false)
+  , buffer(name, max_size, false)
+  , series(_series)
+  , max_messages(0)
 {
-  if(!m_valid)
+  for( const MathComputation &computation : computations )
   {
-    LOG_ERROR( "Unvalid state, can't accept any message", m_name );
-    return false;
+    streamable        = streamable && computation.isStreamable();
+    with_distribution = with_distribution || computation.getType() == PERCENTILE;
   }
+}
 
-  // Does this message expected?
-  const std::string& message_type = message->getType();
-  MathsCategory* category = this->isWanted(message_type);
-  if( !category )
+bool MathOperation::hasComputation( const std::string &computation_type ) const
+{
+  for( const MathComputation &computation : computations )
   {
-    LOG_INFO( "Message type not accepted by math module: " + message_type, m_name );
-    return false;
+    if( computation.readType() == computation_type )
+      return true;
   }
-  else
+
+  return false;
+}
+
+void MathOperation::get( std::vector<Message> &messages )
+{
+  if( !streamable )
   {
-    LOG_INFO( "Message accepted by category: " + category->getFilter().str(), m_name );
+    buffer.get( messages );
+    return;
+  }
+
+  // As many values as received, so an on count window goes on where it stopped, with the same statistics
+  std::vector<double> values;
+  for( Aggregator* aggregator : { &current, &next } )
+  {
+    if( aggregator->empty() )
+      continue;
+
+    // The values of the buckets of a distribution fill the same buckets once added again
+    values.clear();
+    if( with_distribution )
+      ( aggregator == &current ? current_distribution : next_distribution ).getValues( values );
+    else aggregator->getValues( values );
+
+    const ulong timestamp = aggregator->getTimestamp();
+    for( double value : values )
+      messages.push_back( Message( series, value, timestamp ) );
+
+    aggregator->reset();
+  }
+
+  current_distribution.reset();
+  next_distribution.reset();
+}
+
+void MathOperation::shift()
+{
+  current = next;
+  next.reset();
+
+  current_distribution.swap( next_distribution );
+  next_distribution.reset();
+}
+
+bool MathsPipeline::add( const Message &message, const std::string& computation_type )
+{
+  if(!m_valid)
+  {
+    LOG_ERROR( "Unvalid state, can't accept any message", m_name );
+    return false;
   }
 
+  boost::mutex::scoped_lock lock( m_mutex );
+
   // Does a buffer exist for this message type?
-  auto found_buffer = m_buffers.find(message_type);
+  // The router only sends the series wanted by the current categories, so the category is only matched to create the buffer
+  auto found_buffer = m_buffers.find(message.getSeries());
   std::vector<MathOperation*>* buffer = nullptr;
 
   // No buffer exists yet for this kind of message, let's create it
   if( found_buffer == m_buffers.end() )
   {
+    // Does this message expected?
+    const std::string& message_type = message.getType();
+    MathsCategory* category = this->findCategory(message_type);
+    if( !category )
+    {
+      LOG_INFO( "Message type not accepted by math module: " + message_type, m_name );
+      return false;
+    }
+
+    LOG_INFO( "Message accepted by category: " + category->getFilter().str(), m_name );
     LOG_DEBUG( "No math buffer exists yet for this kind of messages. Creating it.", m_name );
 
     // Create the buffer
-    buffer = &(m_buffers[message_type]);
-
-    // Add operations of this category to the buffer
-    const std::vector<MathComputation>& computations = category->getComputations();
-    for( size_t i = 0, size = computations.size(); i < size; i++ )
-    {
-      const MathComputation& computation  = computations[i];
-      const std::string buffer_name       = message_type + " " + computation.readType();
-      LOG_DEBUG( "Creating math operation: " + buffer_name, m_name );
-      buffer->push_back( new MathOperation(computation, buffer_name, m_buffer_max_size) );
-    }
+    buffer = &(m_buffers[message.getSeries()]);
+    this->createOperations( *category, message_type, message.getSeries(), *buffer );
   }
   else
   {
     buffer = &(found_buffer->second);
   }
 
-  // If a computation type is specified let's select only the buffer corresponding to this computation
+  // If a computation type is specified let's select only the buffer holding this computation
   if( !computation_type.empty() )
   {
     for( size_t i = 0, size = buffer->size(); i < size; i++ )
     {
-      if( buffer->operator[](i)->computation.readType() == computation_type )
+      if( buffer->operator[](i)->hasComputation( computation_type ) )
       {
-        MessageBuffer& message_buffer = buffer->operator[](i)->buffer;
-        LOG_DEBUG( "Add message to math buffer: " + message_buffer.getName(), m_name );
-        message_buffer.add( message );
+        LOG_DEBUG( "Add message to math buffer: " + buffer->operator[](i)->buffer.getName(), m_name );
+        this->add( *buffer->operator[](i), message );
         break;
       }
     }
@@ -386,77 +491,166 @@ bool MathsPipeline::add( message_ptr message, const std::string& computation_typ
     // Add message to the buffers
     for( size_t i = 0, size = buffer->size(); i < size; i++ )
     {
-      MessageBuffer& math_buffer = buffer->operator[](i)->buffer;
-      LOG_DEBUG( "Add message to math buffer: " + math_buffer.getName(), m_name );
-      math_buffer.add( message );
+      LOG_DEBUG( "Add message to math buffer: " + buffer->operator[](i)->buffer.getName(), m_name );
+      this->add( *buffer->operator[](i), message );
     }
   }
 
   return true;
 }
 
-bool MathsPipeline::loadMessage( message_ptr message, const std::string& computation_type )
+void MathsPipeline::createOperations( const MathsCategory &category, const std::string &message_type, series_id series, std::vector<MathOperation*> &operations )
+{
+  // Group the computations by window, in the order of the configuration
+  std::vector<std::vector<MathComputation>> windows;
+  for( const MathComputation &computation : category.getComputations() )
+  {
+    bool found = false;
+    for( size_t i = 0; i < windows.size() && !found; i++ )
+    {
+      found = windows[i].front().isSameWindow( computation );
+      if( found )
+        windows[i].push_back( computation );
+    }
+
+    if( !found )
+      windows.push_back( std::vector<MathComputation>( 1, computation ) );
+  }
+
+  for( const std::vector<MathComputation> &computations : windows )
+  {
+    std::string buffer_name = message_type + " " + computations.front().readType();
+    for( size_t i = 1; i < computations.size(); i++ )
+      buffer_name += "," + computations[i].readType();
+
+    LOG_DEBUG( "Creating math operation: " + buffer_name, m_name );
+    operations.push_back( new MathOperation( computations, buffer_name, m_buffer_max_size, series ) );
+  }
+}
+
+void MathsPipeline::add( MathOperation &operation, const Message &message )
+{
+  if( !operation.streamable )
+  {
+    operation.buffer.add( message );
+    return;
+  }
+
+  // On time, a value newer than the window waits for the next one
+  const MathComputation& computation = operation.window();
+  const bool is_next = computation.isOnTimeIteration() && message.getTimestamp() > computation.nextIterationTime();
+  ( is_next ? operation.next : operation.current ).add( message.getValue(), message.getTimestamp() );
+  if( operation.with_distribution )
+    ( is_next ? operation.next_distribution : operation.current_distribution ).add( message.getValue() );
+  operation.max_messages = std::max( operation.max_messages, operation.size() );
+
+  if( computation.isOnCount() && operation.current.getCount() >= computation.getCount() )
+  {
+    LOG_DEBUG( operation.buffer.getName() + " => onCount of " + std::to_string(operation.current.getCount()) + " messages", m_name );
+    this->compute( operation );
+    operation.current.reset();
+    operation.current_distribution.reset();
+  }
+}
+
+bool MathsPipeline::loadMessage( const Message &message, const std::string& computation_type )
 {
   // Valid message?
-  if( !message && !computation_type.empty() )
+  if( !message.isValid() )
     return false;
 
   return this->add(message, computation_type);
 }
 
-MathsCategory* MathsPipeline::isWanted( const std::string &message_type ) const
+bool MathsPipeline::isWanted( const std::string &message_type ) const
 {
-  boost::mutex::scoped_lock lock( m_mutex );
+  // No lock: the matcher is never modified, a reload replaces it. The category itself is not used.
+  return boost::atomic_load( &m_matcher )->find( message_type ) != nullptr;
+}
+
+MathsCategory* MathsPipeline::findCategory( const std::string &message_type ) const
+{
+  return boost::atomic_load( &m_matcher )->find( message_type );
+}
+
+void MathsPipeline::compute( const std::vector<Message> &messages, const MathOperation &operation )
+{
+  if ( messages.empty() )
+    return;
+
+  // The values are only kept (and sorted once) when a computation needs their order
+  bool is_ordered = false;
+  for( const MathComputation &computation : operation.computations )
+    is_ordered = is_ordered || computation.getType() == MEDIAN || computation.getType() == TILES || computation.getType() == PERCENTILE;
+
+  // A single pass on the values for all the computations
+  Aggregator aggregator;
+  std::vector<double> values;
+  if( is_ordered )
+    values.reserve( messages.size() );
 
-  for( auto it = m_categories.begin(); it != m_categories.end(); ++it )
+  for( const Message &message : messages )
   {
-    MathsCategory* category = *it;
-    if( boost::regex_match( message_type, category->getFilter() )  )
-      return category;
+    aggregator.add( message.getValue(), message.getTimestamp() );
+    if( is_ordered )
+      values.push_back( message.getValue() );
   }
 
-  return nullptr;
+  std::sort( values.begin(), values.end() );
+
+  static const Sketch no_distribution;
+  for( const MathComputation &computation : operation.computations )
+    this->compute( computation, operation.series, aggregator, no_distribution, values );
 }
 
-void MathsPipeline::compute( const std::vector<message_ptr> &messages, const MathComputation& computation )
+void MathsPipeline::compute( const MathOperation &operation )
 {
-  if ( messages.empty() )
-    return;
+  static const std::vector<double> no_values;
+  for( const MathComputation &computation : operation.computations )
+    this->compute( computation, operation.series, operation.current, operation.current_distribution, no_values );
+}
 
-  bool added = true;
+void MathsPipeline::compute( const MathComputation& computation, series_id series, const Aggregator &aggregator, const Sketch &distribution, const std::vector<double> &values )
+{
+  if ( aggregator.empty() )
+    return;
 
   // Wich math computation?
   switch ( computation.getType() )
   {
     case SUM:
       STATS_INCREMENT( stats::STATS_MATHS_SUM );
-      m_buffer->add( this->sum( messages ) );
+      m_buffer->add( Message( series, aggregator.getSum() ) );
       break;
     case AVERAGE:
       STATS_INCREMENT( stats::STATS_MATHS_AVERAGE );
-      m_buffer->add( this->average( messages ) );
+      m_buffer->add( Message( series, aggregator.getSum() / aggregator.getCount() ) );
       break;
     case MAX:
       STATS_INCREMENT( stats::STATS_MATHS_MAX );
-      m_buffer->add( this->max( messages ) );
+      m_buffer->add( Message( series, aggregator.getMax() ) );
       break;
     case MIN:
       STATS_INCREMENT( stats::STATS_MATHS_MIN );
-      m_buffer->add( this->min( messages ) );
-      break;
-    case MEDIAN:
-      STATS_INCREMENT( stats::STATS_MATHS_MEDIAN );
-      m_buffer->add( this->median( messages ) );
+      m_buffer->add( Message( series, aggregator.getMin() ) );
       break;
     case VARIANCE:
       STATS_INCREMENT( stats::STATS_MATHS_VARIANCE );
-      m_buffer->add( this->variance( messages ) );
+      m_buffer->add( Message( series, aggregator.getVariance() ) );
       break;
     case DEVIATION:
       STATS_INCREMENT( stats::STATS_MATHS_DEVIATION );
-      m_buffer->add( this->deviation( messages ) );
+      m_buffer->add( Message( series, sqrt( aggregator.getVariance() ) ) );
+      break;
+    case MEDIAN:
+    {
+      STATS_INCREMENT( stats::STATS_MATHS_MEDIAN );
+      const size_t middle = values.size() / 2;
+      m_buffer->add( Message( series, ( values.size() % 2 != 0 ) ? values[middle] : ( values[middle] + values[middle - 1] ) / 2 ) );
       break;
+    }
     case TILES:
+    {
       STATS_INCREMENT( stats::STATS_MATHS_TILES );
       double value, multiplicator;
       bool   below;
@@ -464,7 +658,7 @@ void MathsPipeline::compute( const std::vector<message_ptr> &messages, const Mat
       try
       {
         std::string below_value = computation.getOption( ATTRIBUTE_BELOW );
-        if ( below_value.empty() ) break;
+        if ( below_value.empty() ) return;
         else if ( below_value == "true" ) below_value = "1";
         else if ( below_value == "false" ) below_value = "0";
 
@@ -475,120 +669,139 @@ void MathsPipeline::compute( const std::vector<message_ptr> &messages, const Mat
       catch ( const boost::bad_lexical_cast &e )
       {
         LOG_ERROR( std::string("Lexical cast error while reading math computation (" + computation.serialize() + ") option value: ") + e.what(), m_name );
-        break;
+        return;
       }
 
-      m_buffer->add( this->tiles( messages, value, below, multiplicator ) );
+      // The values are sorted: the values below and the equal ones are found by dichotomy
+      const auto first_equal = std::lower_bound( values.begin(), values.end(), value );
+      const auto last_equal  = below ? first_equal : std::upper_bound( first_equal, values.end(), value );
+      const double nbr_below = first_equal - values.begin();
+      const double nbr_equal = last_equal - first_equal;
+      m_buffer->add( Message( series, ( (nbr_below + 0.5 * nbr_equal) / values.size() ) * multiplicator ) );
       break;
+    }
+    case PERCENTILE:
+    {
+      // Exact when the values are kept, estimated by the distribution otherwise
+      STATS_INCREMENT( stats::STATS_MATHS_PERCENTILE );
+      const std::string &name = SeriesTable::instance().name( series );
+      for( double percentile : computation.getPercentiles() )
+      {
+        const double result = values.empty() ? distribution.getQuantile( percentile / 100 )
+                                             : values[static_cast<size_t>( percentile / 100 * ( values.size() - 1 ) )];
+        m_buffer->add( Message( name + MathComputation::percentileSuffix( percentile ), result ) );
+      }
+      STATS_RAISE( stats::STATS_MATHS_MESSAGES, computation.getPercentiles().size() );
+      return;
+    }
     default:
-      added = false;
       LOG_ERROR( "Unknown Math Computation: " + computation.serialize() , m_name );
+      return;
   }
 
-  if( added )
-    STATS_INCREMENT( stats::STATS_MATHS_MESSAGES );
+  STATS_INCREMENT( stats::STATS_MATHS_MESSAGES );
 }
 
-message_ptr MathsPipeline::sum( const std::vector<message_ptr> &messages ) const
+Message MathsPipeline::sum( const std::vector<Message> &messages ) const
 {
   if ( messages.empty() )
-    return boost::make_shared<Message>();
+    return Message();
 
-  double result = messages[0]->getValue();
-  std::vector<message_ptr>::size_type i, size = messages.size();
+  double result = messages[0].getValue();
+  std::vector<Message>::size_type i, size = messages.size();
 
   for( i = 1; i < size; i++ )
-    result += messages[i]->getValue();
+    result += messages[i].getValue();
 
-  return boost::make_shared<Message>( messages[0]->getType(), result );
+  return Message( messages[0].getSeries(), result );
 }
 
-message_ptr MathsPipeline::average( const std::vector<message_ptr> &messages ) const
+Message MathsPipeline::average( const std::vector<Message> &messages ) const
 {
   if ( messages.empty() )
-    return boost::make_shared<Message>();
+    return Message();
 
-  double result = messages[0]->getValue();
+  double result = messages[0].getValue();
 
   const size_t size = messages.size();
   for( size_t i = 1; i < size; i++ )
-    result += messages[i]->getValue();
+    result += messages[i].getValue();
 
   result /= size;
 
-  return boost::make_shared<Message>( messages[0]->getType(), result );
+  return Message( messages[0].getSeries(), result );
 }
 
-message_ptr MathsPipeline::variance( const std::vector<message_ptr> &messages ) const
+Message MathsPipeline::variance( const std::vector<Message> &messages ) const
 {
   if ( messages.empty() )
-    return boost::make_shared<Message>();
+    return Message();
 
   // Get the average
-  const double average = this->average(messages)->getValue();
+  const double average = this->average(messages).getValue();
   double result = 0.0;
 
   const size_t size = messages.size();
   for( size_t i = 0; i < size; i++ )
   {
-    const double difference = messages[i]->getValue() - average;
+    const double difference = messages[i].getValue() - average;
     result += difference * difference;
   }
 
   result /= size;
 
-  return boost::make_shared<Message>( messages[0]->getType(), result );
+  return Message( messages[0].getSeries(), result );
 }
 
-message_ptr MathsPipeline::deviation( const std::vector<message_ptr> &messages ) const
+Message MathsPipeline::deviation( const std::vector<Message> &messages ) const
 {
   if ( messages.empty() )
-    return boost::make_shared<Message>();
+    return Message();
 
   // Deviation is only the square of the variance
-  double result = sqrt( this->variance(messages)->getValue() );
+  double result = sqrt( this->variance(messages).getValue() );
 
-  return boost::make_shared<Message>( messages[0]->getType(), result );
+  return Message( messages[0].getSeries(), result );
 }
 
-message_ptr MathsPipeline::max( const std::vector<message_ptr> &messages ) const
+Message MathsPipeline::max( const std::vector<Message> &messages ) const
 {
   if ( messages.empty() )
-    return boost::make_shared<Message>();
+    return Message();
 
-  double result = messages[0]->getValue();
-  std::vector<message_ptr>::size_type i, size = messages.size();
+  double result = messages[0].getValue();
+  std::vector<Message>::size_type i, size = messages.size();
 
   for( i = 1; i < size; i++ )
   {
-    if ( messages[i]->getValue() > result )
-      result = messages[i]->getValue();
+    if ( messages[i].getValue() > result )
+      result = messages[i].getValue();
   }
 
-  return boost::make_shared<Message>( messages[0]->getType(), result );
+  return Message( messages[0].getSeries(), result );
 }
 
-message_ptr MathsPipeline::min( const std::vector<message_ptr> &messages ) const
+Message MathsPipeline::min( const std::vector<Message> &messages ) const
 {
   if ( messages.empty() )
-    return boost::make_shared<Message>();
+    return Message();
 
-  double result = messages[0]->getValue();
+  double result = messages[0].getValue();
 
   const size_t size = messages.size();
   for( size_t i = 1; i < size; i++ )
   {
-    if ( messages[i]->getValue() < result )
-      result = messages[i]->getValue();
+    if ( messages[i].getValue() < result )
+      result = messages[i].getValue();
   }
 
-  return boost::make_shared<Message>( messages[0]->getType(), result );
+  return Message( messages[0].getSeries(), result );
 }
 
-message_ptr MathsPipeline::median( const std::vector<message_ptr> &messages ) const
+Message MathsPipeline::median( const std::vector<Message> &messages ) const
 {
   if ( messages.empty() )
-    return boost::make_shared<Message>();
+    return Message();
 
   const size_t size = messages.size();
   const size_t middle = size / 2;
@@ -597,35 +810,35 @@ message_ptr MathsPipeline::median( const std::vector<message_ptr> &messages ) co
   std::vector<double> values;
   values.reserve( size );
   for( size_t i = 0; i < size; i++ )
-    values.push_back( messages[i]->getValue() );
+    values.push_back( messages[i].getValue() );
 
   std::sort( values.begin(), values.end() );
 
   double value = ( size % 2 != 0 ) ? values[middle] : (values[middle] + values[middle - 1]) / 2;
 
-  return boost::make_shared<Message>( messages[0]->getType(), value );
+  return Message( messages[0].getSeries(), value );
 }
 
-message_ptr MathsPipeline::tiles( const std::vector<message_ptr> &messages, double value, bool strictly_below, double multiplicator ) const
+Message MathsPipeline::tiles( const std::vector<Message> &messages, double value, bool strictly_below, double multiplicator ) const
 {
   if ( messages.empty() )
-    return boost::make_shared<Message>();
+    return Message();
 
   ulong nbr_below = 0;
   ulong nbr_equal = 0;
 
-  const std::vector<message_ptr>::size_type size = messages.size();
+  const std::vector<Message>::size_type size = messages.size();
   for( size_t i = 0; i < size; i++ )
   {
-    if ( messages[i]->getValue() < value )
+    if ( messages[i].getValue() < value )
       nbr_below++;
-    else if ( !strictly_below && messages[i]->getValue() == value )
+    else if ( !strictly_below && messages[i].getValue() == value )
       nbr_equal++;
   }
 
   double result = ( (nbr_below + 0.5 * nbr_equal) / size ) * multiplicator;
 
-  return boost::make_shared<Message>( messages[0]->getType(), result );
+  return Message( messages[0].getSeries(), result );
 }
 
 unsigned long MathsPipeline::getBuffersMaxMessages() const
@@ -640,7 +853,7 @@ unsigned long MathsPipeline::getBuffersMaxMessages() const
       const std::vector<MathOperation*>& operations = it->second;
       for( size_t i = 0, operations_size = operations.size(); i < operations_size; i++ )
       {
-        size = operations[i]->buffer.getMaxMessages();
+        size = operations[i]->getMaxMessages();
         if( size > max )
           max = size;
       }
@@ -650,39 +863,19 @@ unsigned long MathsPipeline::getBuffersMaxMessages() const
   return max;
 }
 
-void MathsPipeline::remove(const std::string& buffer_name)
+void MathsPipeline::remove( series_id series )
 {
   boost::mutex::scoped_lock lock( m_mutex );
-  const unsigned long max = std::numeric_limits<unsigned long>::max();
 
-  for( auto it = m_buffers.begin(); it != m_buffers.end(); ++it )
-  {
-    unsigned long found = max;
-    std::vector<MathOperation*>& operations = it->second;
-    for( size_t i = 0, operations_size = operations.size(); i < operations_size; i++ )
-    {
-      const MessageBuffer& buffer = operations[i]->buffer;
-      if( buffer.getName() == buffer_name )
-      {
-        found = i;
-        break;
-      }
-    }
-
-    // We've found the buffer, let's erase it
-    if(found != max)
-    {
-      // Delete and remove the operation
-      delete operations[found];
-      operations.erase( operations.begin() + found );
-
-      // Operations become empty, remove the entire entry in m_buffers
-      if(operations.empty())
-        m_buffers.erase(it);
+  auto found_buffer = m_buffers.find( series );
+  if( found_buffer == m_buffers.end() )
+    return;
 
-      break;
-    }
-  }
+  // Delete the operations then remove the entire entry in m_buffers
+  std::vector<MathOperation*>& operations = found_buffer->second;
+  for( size_t i = 0, operations_size = operations.size(); i < operations_size; i++ )
+    delete operations[i];
+  m_buffers.erase( found_buffer );
 }
 
 } // namespace maths
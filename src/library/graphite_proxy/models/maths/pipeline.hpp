@@ -6,8 +6,11 @@
 #include <graphite_proxy/models/message.hpp>
 
 #include <graphite_proxy/models/maths/properties.hpp>
+#include <graphite_proxy/models/maths/aggregator.hpp>
+#include <graphite_proxy/models/maths/sketch.hpp>
 #include <graphite_proxy/models/maths/math_computation.hpp>
 #include <graphite_proxy/models/maths/math_category.hpp>
+#include <graphite_proxy/models/maths/category_matcher.hpp>
 
 #include <graphite_proxy/models/buffers/global_buffer.hpp>
 #include <graphite_proxy/models/buffers/message_buffer.hpp>
@@ -17,28 +20,97 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/thread/mutex.hpp>
 
+#include <atomic>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <istream>
 
 namespace graphite_proxy {
 namespace maths {
 
+/*! The computations of a series sharing the same window (same count or same time) and the pending values of the window
+ *  The values are kept once for all the computations: as running statistics (and a sketch of their distribution for percentiles)
+ *  when all the computations are streamable, as messages into the buffer otherwise.
+ */
 struct MathOperation
 {
-    MathOperation( const MathComputation& _computation, const std::string &name, unsigned long max_size )
-      : computation(_computation)
-      , buffer(name, max_size, false)
-    {}
+    /*! Constructor
+     *  \param _computations are the computations sharing the window (at least one), the first one keeps the window time
+     *  \param name          is the name of the buffer
+     *  \param max_size      is the maximum size of the buffer
+     *  \param _series       is the series of the computed values
+     */
+    MathOperation( const std::vector<MathComputation>& _computations, const std::string &name, unsigned long max_size, series_id _series );
+
+    /*! Does the operation do a computation
+     *  \param computation_type is the type of the computation in a human readable string
+     *  \return true if one of the computations has this type
+     */
+    bool hasComputation( const std::string &computation_type ) const;
 
-    MathComputation computation;
+    /*! Getter for the computation keeping the window (count or time) of the operation
+     *  \return the first computation
+     */
+    MathComputation& window() { return computations.front(); }
+
+    /*! Get the number of pending values
+     *  \return the number of values not computed yet
+     */
+    unsigned long size() const { return streamable ? current.getCount() + next.getCount() : buffer.size(); }
+
+    /*! Get the maximum number of pending values that has been kept at the same time
+     *  \return the maximum number of pending values
+     */
+    unsigned long getMaxMessages() const { return streamable ? max_messages : buffer.getMaxMessages(); }
 
+    /*! Retrieve the pending values as messages (remove them from the operation)
+     *  \param messages is the messages container
+     *  \note for streamable computations, the messages are not the received ones but give back the same statistics once added again
+     */
+    void get( std::vector<Message> &messages );
+
+    /*! Move to the next window: the statistics of the next window become the current ones */
+    void shift();
+
+    /*! Computations sharing the window */
+    std::vector<MathComputation> computations;
+
+    /*! Are all the computations streamable */
+    bool            streamable;
+
+    /*! Is one of the computations a percentile (the distribution of the values is kept) */
+    bool            with_distribution;
+
+    /*! Pending messages when a computation is not streamable */
     MessageBuffer   buffer;
+
+    /*! Running statistics of the window to compute next */
+    Aggregator      current;
+
+    /*! Running statistics of the values received with a timestamp after the window (on time computations only) */
+    Aggregator      next;
+
+    /*! Distribution of the values of the window to compute next (percentile computations only) */
+    Sketch          current_distribution;
+
+    /*! Distribution of the values received with a timestamp after the window (on time percentile computations only) */
+    Sketch          next_distribution;
+
+    /*! Series of the computed values */
+    series_id       series;
+
+    /*! Maximum number of pending values kept at the same time by the streamable computations */
+    unsigned long   max_messages;
 };
 
 /*! A maths pipeline is the container for messages which need to be computed by some maths operation like sum, max, min, etc
  *  The pipeline is like a Global Buffer but it changes the messages according to rules set in maths.xml file
  *  When messages has been computed they are given to the global buffer to be send to Graphite
+ *  \note sum, average, min, max, variance, deviation and percentile are updated as the messages come, so their memory doesn't depend on the
+ *        number of messages of a window. On count, they are computed as soon as the window is full.
+ *  \note on time, the values with a timestamp after the current window all go to the next one.
+ *  \note the computations of a category with the same window share the values of each series (see MathOperation), they are stored once.
  */
 class MathsPipeline : public Iterations
 {
@@ -59,73 +131,76 @@ class MathsPipeline : public Iterations
      *  \param message          is the message to add
      *  \param computation_type if this param is empty the message will be added for each computations. If not the message will be added for only the matched computation
      *  \return true if everything went well (on this version of the project, always return true)
+     *  \note the categories are only matched for a series without buffers, the buffers of a series stay until the cleaner removes them
      */
-    bool add( message_ptr message, const std::string& computation_type = "" );
+    bool add( const Message &message, const std::string& computation_type = "" );
 
     /*! Load a message into a buffer
      *  \param message          to load
      *  \param computation_type the type of computation for this message
      *  \return true if the message has been accepted and stored. False otherwise
      */
-    bool loadMessage( message_ptr message, const std::string& computation_type );
+    bool loadMessage( const Message &message, const std::string& computation_type );
 
     /*! Reload configurations from the maths configurations file
      *  \param conf_filepath is the path to access the maths configuration file
      *  \return true if configurations have been reloaded correctly
      *  \note when reloading math configuration it's possible than some old math categories are now useless (the config file changed)
      *        this is not a problem because the cleaner will automaticly remove the unused math buffers.
+     *  \note the new categories replace the previous ones at once, there is no category at all only if the file can't be loaded
      */
     bool reloadConfigurations( const std::string &conf_filepath );
 
     /*! Does the maths module expect a message of the given type
      *  \param message_type is the type of the message (could be a simple string or a regex)
-     *  \return the MathsCategory which requires the message or null is no category wants it
+     *  \return true if a category requires the message
+     *  \note it doesn't lock the pipeline, the answer may be outdated by a reload of the configurations (see getGeneration)
      */
-    MathsCategory* isWanted( const std::string &message_type ) const;
+    bool isWanted( const std::string &message_type ) const;
 
     /*! Get some messages and sum their values
      *  \param messages are the messages to sum
      *  \return a new message holding the computation result
      */
-    message_ptr sum( const std::vector<message_ptr> &messages ) const;
+    Message sum( const std::vector<Message> &messages ) const;
 
     /*! Get some messages and average their values
      *  \param messages are the messages to average
      *  \return a new message holding the computation result
      */
-    message_ptr average( const std::vector<message_ptr> &messages ) const;
+    Message average( const std::vector<Message> &messages ) const;
 
     /*! Get some messages and make a variance with their values
      *  \param messages are the messages to use to calculate the variance
      *  \return a new message holding the computation result
      *  \note standard deviation: http://en.wikipedia.org/wiki/Variance
      */
-    message_ptr variance( const std::vector<message_ptr> &messages ) const;
+    Message variance( const std::vector<Message> &messages ) const;
 
     /*! Get some messages and make a standard deviation with their values
      *  \param messages are the messages to use for the standard deviation
      *  \return a new message holding the computation result
      *  \note standard deviation: http://en.wikipedia.org/wiki/Standard_deviation
      */
-    message_ptr deviation( const std::vector<message_ptr> &messages ) const;
+    Message deviation( const std::vector<Message> &messages ) const;
 
     /*! Get some messages and find the max value
      *  \param messages are the messages to sum
      *  \return a new message holding the computation result
      */
-    message_ptr max( const std::vector<message_ptr> &messages ) const;
+    Message max( const std::vector<Message> &messages ) const;
 
     /*! Get some messages and find the min value
      *  \param messages are the messages to sum
      *  \return a new message holding the computation result
      */
-    message_ptr min( const std::vector<message_ptr> &messages ) const;
+    Message min( const std::vector<Message> &messages ) const;
 
     /*! Get some messages and find the median value
      *  \param messages are the messages to sum
      *  \return a new message holding the computation result
      */
-    message_ptr median( const std::vector<message_ptr> &messages ) const;
+    Message median( const std::vector<Message> &messages ) const;
 
     /*! Get some messages and get a tiles of their values
      *  \note the mathmatical tiles equation is: ( (nbr_values_below + 0.5 * nbr_values_equal) / nbr_values ) * multiplicator
@@ -135,12 +210,12 @@ class MathsPipeline : public Iterations
      *  \param multiplicator is the multiplication value for the tiles operation
      *  \return a new message holding the computation result
      */
-    message_ptr tiles( const std::vector<message_ptr> &messages, double value, bool strictly_below, double multiplicator ) const;
+    Message tiles( const std::vector<Message> &messages, double value, bool strictly_below, double multiplicator ) const;
 
     /*! Retrieve all pending messages (remove them from the Pipeline)
      *  \param target_container is the messages container
      */
-    void get( std::vector<message_ptr> &target_container );
+    void get( std::vector<Message> &target_container );
 
     /*! Getter for the number of buffers
      *  \return the number of buffers
@@ -153,24 +228,30 @@ class MathsPipeline : public Iterations
     unsigned long getBuffersMaxSize() const { return m_buffer_max_size; }
 
     /*! Getter for the categories
-     *  \return the categories
+     *  \return the categories of the current configurations
+     */
+    std::list<MathsCategory*> getCategories() const;
+
+    /*! Getter for the generation of the categories
+     *  \return a number changing each time the categories are replaced (e.g. by a reload of the configurations)
+     *  \note read it before isWanted: a decision taken with a generation is outdated as soon as the generation changes
      */
-    const std::list<MathsCategory*>& getCategories() const { return m_categories; }
+    unsigned int getGeneration() const { return m_generation.load( std::memory_order_acquire ); }
 
     /*! Getter for the buffers
      *  \return the buffers
      */
-    const std::map<std::string, std::vector<MathOperation*>>& getBuffers() const { return m_buffers; }
+    const std::unordered_map<series_id, std::vector<MathOperation*>>& getBuffers() const { return m_buffers; }
 
     /*! Get the number of messages from the most filled buffer
      *  \return the number of messages from the most filled buffer
      */
     unsigned long getBuffersMaxMessages() const;
 
-    /*! Remove a buffer
-     *  \param buffer_name is the name of the buffer to remove
+    /*! Remove the buffers of a series (one buffer per computation)
+     *  \param series is the series ID of the buffers to remove
      */
-    void remove(const std::string& buffer_name);
+    void remove( series_id series );
 
   protected:
 
@@ -183,38 +264,84 @@ class MathsPipeline : public Iterations
     /*! Reset categories */
     void clearCategories();
 
+    /*! Replace the categories and their matcher
+     *  \param categories are the new categories, in priority order (they are deleted with the matcher)
+     */
+    void setCategories( const std::list<MathsCategory*> &categories );
+
+    /*! Find the category wanting a message type
+     *  \param message_type is the type of the message
+     *  \return the MathsCategory which requires the message or null is no category wants it
+     *  \note m_mutex has to be locked by the caller: a reload locks it too, so the category is not deleted meanwhile
+     */
+    MathsCategory* findCategory( const std::string &message_type ) const;
+
     /*! Function called at each new iteration */
     void iteration();
 
-    /*! Compute the given messages with a given computation
-     *  \param messages are the messages to compute
-     *  \param computation is the computation to apply on the messages
+    /*! Create the operations of a new series, the computations with the same window share an operation
+     *  \param category     is the category of the series
+     *  \param message_type is the name of the series
+     *  \param series       is the series ID
+     *  \param operations   receives the created operations
+     */
+    void createOperations( const MathsCategory &category, const std::string &message_type, series_id series, std::vector<MathOperation*> &operations );
+
+    /*! Compute the messages of a window with all the computations of an operation, in a single pass on the values
+     *  \param messages  are the messages to compute
+     *  \param operation is the operation holding the computations
+     *  \note new created messages from the computations will be given to the Global Buffer
+     */
+    void compute( const std::vector<Message> &messages, const MathOperation &operation );
+
+    /*! Compute the running statistics of the current window with all the (streamable) computations of an operation
+     *  \param operation is the operation holding the computations and the statistics
+     *  \note new created messages from the computations will be given to the Global Buffer
+     */
+    void compute( const MathOperation &operation );
+
+    /*! Compute a window with a computation
+     *  \param computation  is the computation to apply on the values
+     *  \param series       is the series of the values
+     *  \param aggregator   holds the statistics of the window values
+     *  \param distribution holds the distribution of the window values (streamable percentile computations only)
+     *  \param values       are the sorted window values (computations which are not streamable only)
      *  \note new created message from the computation will be given to the Global Buffer
+     *  \note each percentile goes to its own series, named after the computed one (see MathComputation::percentileSuffix)
+     */
+    void compute( const MathComputation& computation, series_id series, const Aggregator &aggregator, const Sketch &distribution, const std::vector<double> &values );
+
+    /*! Give a message to an operation
+     *  \param operation is the operation
+     *  \param message   is the message to add
+     *  \note an on count streamable operation is computed as soon as its window is full
      */
-    void compute( const std::vector<message_ptr> &messages, const MathComputation& computation );
+    void add( MathOperation &operation, const Message &message );
 
     /*! Internal compute function. Algorithm for onCount computations.
-     *  \param computation    is the computation to apply
-     *  \param message_buffer is the buffer to use
+     *  \param operation is the operation to compute
      */
-    void computeOnCount( MathComputation& computation, MessageBuffer& message_buffer );
+    void computeOnCount( MathOperation &operation );
 
     /*! Internal compute function. Algorithm for onTime computations.
-     *  \param computation    is the computation to apply
-     *  \param message_buffer is the buffer to use
+     *  \param operation is the operation to compute
+     *  \param now       is the current time (in seconds)
      */
-    void computeOnTime( MathComputation& computation, MessageBuffer& message_buffer, unsigned long now );
+    void computeOnTime( MathOperation &operation, unsigned long now );
 
   private:
 
     /*! Global Buffer instance */
     global_buffer_ptr                      m_buffer;
 
-    /*! Internal representation of the maths.xml configuration file */
-    std::list<MathsCategory*>              m_categories;
+    /*! Internal representation of the maths.xml configuration file, replaced as a whole by a reload (see boost::atomic_store) */
+    category_matcher_ptr                   m_matcher;
+
+    /*! Generation of m_matcher, increased after each replacement */
+    std::atomic<unsigned int>              m_generation;
 
-    /*! A metric name associated with several maths computations */
-    std::map<std::string, std::vector<MathOperation*>> m_buffers;
+    /*! A metric series associated with several maths computations */
+    std::unordered_map<series_id, std::vector<MathOperation*>> m_buffers;
 
     /*! The maximum size of internal messages buffer */
     unsigned long                          m_buffer_max_size;
@@ -7,16 +7,17 @@ namespace graphite_proxy {
 namespace maths {
 
 // Nodes
-#define NODE_ROOT      "maths"
-#define NODE_SUM       "sum"
-#define NODE_AVERAGE   "average"
-#define NODE_MIN       "min"
-#define NODE_MAX       "max"
-#define NODE_MEDIAN    "median"
-#define NODE_TILES     "tiles"
-#define NODE_VARIANCE  "variance"
-#define NODE_DEVIATION "deviation"
-#define NODE_CATEGORY  "category"
+#define NODE_ROOT       "maths"
+#define NODE_SUM        "sum"
+#define NODE_AVERAGE    "average"
+#define NODE_MIN        "min"
+#define NODE_MAX        "max"
+#define NODE_MEDIAN     "median"
+#define NODE_TILES      "tiles"
+#define NODE_VARIANCE   "variance"
+#define NODE_DEVIATION  "deviation"
+#define NODE_PERCENTILE "percentile"
+#define NODE_CATEGORY   "category"
 
 // Attributes
 #define ATTRIBUTE_NAME           "name"
@@ -30,6 +31,11 @@ namespace maths {
 #define ATTRIBUTE_DEFAULT_BELOW         "true"
 #define ATTRIBUTE_DEFAULT_MULTIPLICATOR "100"
 
+// Percentiles sketch
+#define SKETCH_DEFAULT_ACCURACY    0.01 // Relative error of the percentiles
+#define SKETCH_DEFAULT_MAX_BUCKETS 1024 // Spans about 8 orders of magnitude with the default accuracy
+#define SKETCH_MIN_VALUE           1e-9 // Values closer to zero are counted as zeros
+
 // Helpers
 #define XML_UNKNOWN   "unknown"
 #define REGEX_TIME    "^([0-9]*[hH]*)([0-9]*[mM]*)([0-9]*[sS]*)$"
@@ -0,0 +1,167 @@
+#include "sketch.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <math.h>
+
+namespace graphite_proxy {
+namespace maths {
+
+Sketch::Sketch( double accuracy, size_t max_buckets )
+  : m_gamma( ( 1 + accuracy ) / ( 1 - accuracy ) )
+  , m_multiplier( 1 / log( m_gamma ) )
+  , m_max_buckets( std::max( max_buckets, size_t(1) ) )
+  , m_zeros( 0 )
+  , m_count( 0 )
+  , m_min( 0 )
+  , m_max( 0 )
+{
+  // Nothing
+}
+
+void Sketch::add( double value, size_t count )
+{
+  if( count == 0 )
+    return;
+
+  if( m_count == 0 )
+  {
+    m_min = value;
+    m_max = value;
+  }
+  else
+  {
+    m_min = std::min( m_min, value );
+    m_max = std::max( m_max, value );
+  }
+
+  if( value > SKETCH_MIN_VALUE )
+    m_positives.add( this->index( value ), count, m_max_buckets );
+  else if( value < -SKETCH_MIN_VALUE )
+    m_negatives.add( this->index( -value ), count, m_max_buckets );
+  else m_zeros += count;
+
+  m_count += count;
+}
+
+void Sketch::reset()
+{
+  m_positives.counts.clear();
+  m_negatives.counts.clear();
+  m_zeros = 0;
+  m_count = 0;
+  m_min   = 0;
+  m_max   = 0;
+}
+
+void Sketch::swap( Sketch &other )
+{
+  std::swap( *this, other );
+}
+
+double Sketch::getQuantile( double quantile ) const
+{
+  if( m_count == 0 )
+    return 0;
+
+  // The smallest and the largest values are known exactly
+  const double rank = std::min( std::max( quantile, 0.0 ), 1.0 ) * ( m_count - 1 );
+  if( rank <= 0 )
+    return m_min;
+  else if( rank >= m_count - 1 )
+    return m_max;
+
+  // Walk the buckets from the smallest values to the largest ones, until the rank of the wanted value
+  double result = m_max;
+  size_t seen   = 0;
+  for( size_t i = m_negatives.counts.size(); i > 0 && seen <= rank; i-- )
+  {
+    seen  += m_negatives.counts[i - 1];
+    result = -this->value( m_negatives.offset + i - 1 );
+  }
+
+  if( seen <= rank )
+  {
+    seen  += m_zeros;
+    result = 0;
+  }
+
+  for( size_t i = 0, size = m_positives.counts.size(); i < size && seen <= rank; i++ )
+  {
+    seen  += m_positives.counts[i];
+    result = this->value( m_positives.offset + i );
+  }
+
+  return std::min( std::max( result, m_min ), m_max );
+}
+
+void Sketch::getValues( std::vector<double> &values ) const
+{
+  if( m_count == 0 )
+    return;
+
+  const size_t first = values.size();
+  values.reserve( first + m_count );
+
+  for( size_t i = m_negatives.counts.size(); i > 0; i-- )
+    values.insert( values.end(), m_negatives.counts[i - 1], -this->value( m_negatives.offset + i - 1 ) );
+
+  values.insert( values.end(), m_zeros, 0.0 );
+
+  for( size_t i = 0, size = m_positives.counts.size(); i < size; i++ )
+    values.insert( values.end(), m_positives.counts[i], this->value( m_positives.offset + i ) );
+
+  // Both ends fall into their own buckets, so they can be exact
+  values[first] = m_min;
+  values.back() = m_max;
+}
+
+int Sketch::index( double value ) const
+{
+  return static_cast<int>( ceil( log( value ) * m_multiplier ) );
+}
+
+double Sketch::value( int index ) const
+{
+  return 2 * pow( m_gamma, index ) / ( m_gamma + 1 );
+}
+
+void Sketch::Store::add( int index, size_t count, size_t max_buckets )
+{
+  if( counts.empty() )
+  {
+    offset = index;
+    counts.push_back( 0 );
+  }
+  else if( index < offset )
+  {
+    // Without room for more buckets, a value below the lowest bucket goes to it
+    const int lowest = offset + static_cast<int>( counts.size() ) - static_cast<int>( max_buckets );
+    index = std::max( index, lowest );
+    if( index < offset )
+    {
+      counts.insert( counts.begin(), offset - index, 0 );
+      offset = index;
+    }
+  }
+  else if( index >= offset + static_cast<int>( counts.size() ) )
+  {
+    const int first = std::max( offset, index - static_cast<int>( max_buckets ) + 1 );
+    if( first > offset )
+    {
+      // Collapse the lowest buckets into the first kept one
+      const size_t collapsed = std::min( static_cast<size_t>( first - offset ), counts.size() );
+      const size_t total     = std::accumulate( counts.begin(), counts.begin() + collapsed, size_t(0) );
+      counts.erase( counts.begin(), counts.begin() + collapsed );
+      offset = first;
+      counts.resize( index - offset + 1, 0 );
+      counts.front() += total;
+    }
+    else counts.resize( index - offset + 1, 0 );
+  }
+
+  counts[index - offset] += count;
+}
+
+} // namespace maths
+} // namespace graphite_proxy
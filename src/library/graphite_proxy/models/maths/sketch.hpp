@@ -0,0 +1,129 @@
+#ifndef GRAPHITE_PROXY_SKETCH_HPP
+#define GRAPHITE_PROXY_SKETCH_HPP
+
+#include <graphite_proxy/models/maths/properties.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace graphite_proxy {
+namespace maths {
+
+/*! Streaming sketch of the distribution of some values, to get their percentiles without keeping nor sorting them
+ *  Values are counted in logarithmic buckets (like DDSketch): a percentile is given with a bounded relative error.
+ *  Memory is bounded by a maximum number of buckets, the lowest buckets are collapsed together when it is reached.
+ *  \note values close to zero (below SKETCH_MIN_VALUE) are counted as zeros
+ */
+class Sketch
+{
+  public:
+
+    /*! Constructor of an empty sketch
+     *  \param accuracy    is the relative error of the percentiles (0.01 means 1%)
+     *  \param max_buckets is the maximum number of buckets for the positive values, and for the negative ones
+     */
+    Sketch( double accuracy = SKETCH_DEFAULT_ACCURACY, size_t max_buckets = SKETCH_DEFAULT_MAX_BUCKETS );
+
+    /*! Add a value
+     *  \param value is the value to add
+     *  \param count is the number of times the value is added
+     */
+    void add( double value, size_t count = 1 );
+
+    /*! Forget all values, the buckets memory is kept */
+    void reset();
+
+    /*! Exchange the values of two sketches
+     *  \param other is the sketch to exchange values with
+     */
+    void swap( Sketch &other );
+
+    /*! Has no value been added
+     *  \return true if the sketch is empty
+     */
+    bool empty() const { return m_count == 0; }
+
+    /*! Getter for the number of values
+     *  \return the number of values
+     */
+    size_t getCount() const { return m_count; }
+
+    /*! Get a quantile of the values
+     *  \param quantile is the quantile to get, from 0 (the smallest value) to 1 (the largest value)
+     *  \return the estimated value, 0 if there is no value
+     */
+    double getQuantile( double quantile ) const;
+
+    /*! Get values having the same distribution than the added values (one value per added value)
+     *  \param values receives the values in ascending order, the smallest and the largest ones are exact
+     */
+    void getValues( std::vector<double> &values ) const;
+
+    /*! Getter for the number of buckets in use (usefull for statistics)
+     *  \return the number of buckets
+     */
+    size_t getNbrBuckets() const { return m_positives.counts.size() + m_negatives.counts.size(); }
+
+  private:
+
+    /*! Contiguous buckets of the values of a sign, by index of their logarithm */
+    struct Store
+    {
+      /*! Index of the first bucket */
+      int                 offset = 0;
+
+      /*! Number of values in each bucket */
+      std::vector<size_t> counts;
+
+      /*! Count values in a bucket
+       *  \param index       is the index of the bucket
+       *  \param count       is the number of values
+       *  \param max_buckets is the maximum number of buckets, the lowest ones are collapsed to stay below
+       */
+      void add( int index, size_t count, size_t max_buckets );
+    };
+
+    /*! Get the bucket index of a value
+     *  \param value is a value above SKETCH_MIN_VALUE
+     *  \return the index of the bucket of the value
+     */
+    int index( double value ) const;
+
+    /*! Get the value representing a bucket (with the same relative error for each value of the bucket)
+     *  \param index is the index of the bucket
+     *  \return the value of the bucket
+     */
+    double value( int index ) const;
+
+    /*! Growth factor from a bucket to the next one */
+    double m_gamma;
+
+    /*! Inverse of the logarithm of m_gamma */
+    double m_multiplier;
+
+    /*! Maximum number of buckets of each store */
+    size_t m_max_buckets;
+
+    /*! Buckets of the positive values */
+    Store  m_positives;
+
+    /*! Buckets of the absolute value of the negative values */
+    Store  m_negatives;
+
+    /*! Number of values counted as zero */
+    size_t m_zeros;
+
+    /*! Number of values */
+    size_t m_count;
+
+    /*! Smallest value */
+    double m_min;
+
+    /*! Largest value */
+    double m_max;
+};
+
+} // namespace maths
+} // namespace graphite_proxy
+
+#endif // GRAPHITE_PROXY_SKETCH_HPP
@@ -1,23 +1,25 @@
 #include "message.hpp"
 
-#include <boost/lexical_cast.hpp>
-#include <boost/make_shared.hpp>
-#include <boost/algorithm/string.hpp>
-
+#include <algorithm>
+#include <charconv>
+#include <type_traits>
 #include <vector>
 
 namespace graphite_proxy {
 
+static_assert( std::is_trivially_copyable<Message>::value, "Messages are copied by value into the buffers" );
+
 Message::Message()
- : m_type( std::string() )
+ : m_series( INVALID_SERIES_ID )
  , m_value( 0.0 )
  , m_timestamp( 0 )
+ , m_received_timestamp( 0 )
 {
   /* Nothing to do */
 }
 
 Message::Message( const std::string &type, double value, ulong timestamp, ulong received_timestamp )
-  : m_type( type )
+  : m_series( SeriesTable::instance().intern( type ) )
   , m_value( value )
   , m_timestamp( timestamp )
   , m_received_timestamp( received_timestamp )
@@ -25,80 +27,158 @@ Message::Message( const std::string &type, double value, ulong timestamp, ulong
   /* Nothing to do */
 }
 
-boost::shared_ptr<Message> Message::createMessage( const std::string &input )
+Message::Message( series_id series, double value, ulong timestamp, ulong received_timestamp )
+  : m_series( series )
+  , m_value( value )
+  , m_timestamp( timestamp )
+  , m_received_timestamp( received_timestamp )
 {
-  // Split message into parts
-  const std::string trimmed_input = boost::trim_copy( input );
-  std::vector<std::string> message_parts;
-  message_parts.reserve(3);
-  boost::split( message_parts, trimmed_input, boost::is_any_of(" ") );
+  /* Nothing to do */
+}
 
-  // Does the syntax appears to be correct ?
-  if ( message_parts.size() != 3 || message_parts[0].empty() || message_parts[1].empty() || message_parts[2].empty() )
-    return boost::shared_ptr<Message>();
+namespace {
 
-  const std::string message_type = message_parts[0];
+/*! Is the character a field separator or a trailing blank ? */
+inline bool isBlank( char c )
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
 
-  try
-  {
-    // Try to parse the message_value (double)
-    const double message_value = boost::lexical_cast<double>( message_parts[1] );
+/*! Extract the next field of a line
+ *  \param  input  is the remaining part of the line, the field and the blanks before it are removed from it
+ *  \return the field (empty if there is no more field)
+ */
+inline std::string_view nextField( std::string_view &input )
+{
+  size_t begin = 0;
+  while( begin < input.size() && isBlank( input[begin] ) )
+    begin++;
 
-    // Try to parse the message_time (integer)
-    const ulong message_time = boost::lexical_cast<ulong>( message_parts[2] );
+  size_t end = begin;
+  while( end < input.size() && !isBlank( input[end] ) )
+    end++;
 
-    // Everything good, create the message
-    return boost::make_shared<Message>( message_type, message_value, message_time );
-  }
-  catch(...)
-  { /* Nothing */ }
+  const std::string_view field = input.substr( begin, end - begin );
+  input.remove_prefix( end );
+  return field;
+}
+
+} // namespace
 
-  return boost::shared_ptr<Message>();
+Message::ParseStatus Message::parse( std::string_view input, std::string_view &type, double &value, ulong &timestamp )
+{
+  // Split message into parts
+  type = nextField( input );
+  const std::string_view value_field     = nextField( input );
+  const std::string_view timestamp_field = nextField( input );
+
+  // Does the syntax appears to be correct ?
+  if( type.empty() )
+    return ParseStatus::EMPTY;
+  if( timestamp_field.empty() || !nextField( input ).empty() )
+    return ParseStatus::BAD_SYNTAX;
+
+  // Parse the message value (double), from_chars doesn't accept an explicit positive sign
+  const char* value_begin = value_field.data();
+  const char* value_end   = value_begin + value_field.size();
+  if( value_field.size() > 1 && value_field[0] == '+' && value_field[1] != '-' )
+    value_begin++;
+  const std::from_chars_result value_result = std::from_chars( value_begin, value_end, value );
+  if( value_result.ec != std::errc() || value_result.ptr != value_end )
+    return ParseStatus::BAD_VALUE;
+
+  // Parse the message timestamp (integer)
+  const char* timestamp_end = timestamp_field.data() + timestamp_field.size();
+  const std::from_chars_result timestamp_result = std::from_chars( timestamp_field.data(), timestamp_end, timestamp );
+  if( timestamp_result.ec != std::errc() || timestamp_result.ptr != timestamp_end )
+    return ParseStatus::BAD_TIMESTAMP;
+
+  return ParseStatus::OK;
+}
+
+Message Message::createMessage( std::string_view input )
+{
+  std::string_view type;
+  double           value;
+  ulong            timestamp;
+  if( Message::parse( input, type, value, timestamp ) != ParseStatus::OK )
+    return Message();
+
+  // Everything good, create the message
+  return Message( SeriesTable::instance().intern( type ), value, timestamp );
 }
 
-bool Message::createMessages( const std::string &input, std::vector<boost::shared_ptr<Message> > &messages_container )
+bool Message::createMessages( std::string_view input, std::vector<Message> &messages_container )
 {
-  std::vector<std::string> parts;
-  boost::split( parts, input, boost::is_any_of("\n") );
-  const size_t parts_size = parts.size();
-  messages_container.reserve( parts_size );
+  const size_t previous_size = messages_container.size();
 
-  for ( size_t i = 0; i < parts_size; i++ )
+  while( !input.empty() )
   {
-    message_ptr message = Message::createMessage( parts[i] );
-    if( message )
+    const size_t line_end = input.find( '\n' );
+    const Message message = Message::createMessage( input.substr( 0, line_end ) );
+    if( message.isValid() )
       messages_container.push_back( message );
+
+    if( line_end == std::string_view::npos )
+      break;
+    input.remove_prefix( line_end + 1 );
   }
 
-  return ( messages_container.empty() ) ? false : true;
+  return messages_container.size() != previous_size;
 }
 
-const std::string& Message::serialize()
+std::string Message::serialize() const
 {
-  if (m_serialized.empty() && !m_type.empty())
-  {
-    // No need to catch boost::bad_lexical cast here, values are obviously correct
-    std::string string_value = std::to_string( m_value );
-    std::string string_time  = std::to_string( m_timestamp );
+  std::string serialized;
+  this->appendTo( serialized );
+  return serialized;
+}
 
-    m_serialized.reserve( m_type.size() + string_value.size() + string_time.size() + 2 );
-    m_serialized = m_type + " " + string_value + " " + string_time;
-  }
+size_t Message::serialize( char* output, size_t output_size ) const
+{
+  if( m_series == INVALID_SERIES_ID )
+    return 0;
+
+  const std::string& type = this->getType();
+  if( type.size() + 2 > output_size )
+    return 0;
+
+  char* const output_end = output + output_size;
+  char*       position   = std::copy( type.begin(), type.end(), output );
+  *position++ = ' ';
+
+  const std::to_chars_result value_result = std::to_chars( position, output_end, m_value );
+  if( value_result.ec != std::errc() || value_result.ptr == output_end )
+    return 0;
+  position    = value_result.ptr;
+  *position++ = ' ';
 
-  return m_serialized;
+  const std::to_chars_result timestamp_result = std::to_chars( position, output_end, m_timestamp );
+  if( timestamp_result.ec != std::errc() )
+    return 0;
+
+  return timestamp_result.ptr - output;
 }
 
-ulong Message::length()
+void Message::appendTo( std::string &output ) const
 {
-  if (m_serialized.empty())
-    this->serialize();
+  if( m_series == INVALID_SERIES_ID )
+    return;
+
+  const size_t previous_size = output.size();
+  output.resize( previous_size + this->getType().size() + 2 * MAX_NUMBER_LENGTH + 2 );
+  const size_t written = this->serialize( &output[previous_size], output.size() - previous_size );
+  output.resize( previous_size + written );
+}
 
-  return m_serialized.size();
+ulong Message::length() const
+{
+  return this->serialize().size();
 }
 
 bool Message::isValid() const
 {
-  return !m_type.empty();
+  return m_series != INVALID_SERIES_ID;
 }
 
 } // namespace graphite_proxy
@@ -1,18 +1,24 @@
 #ifndef GRAPHITE_PROXY_MESSAGE_HPP
 #define GRAPHITE_PROXY_MESSAGE_HPP
 
-#include <graphite_proxy/utils/time.hpp>
+#include <graphite_proxy/models/series_table.hpp>
 
-#include <boost/shared_ptr.hpp>
+#include <graphite_proxy/utils/time.hpp>
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 #define MAX_MESSAGE_LENGTH 2048
 
+/*! Maximum length of a serialized number (value or timestamp) */
+#define MAX_NUMBER_LENGTH 32
+
 namespace graphite_proxy {
 
-/*! Network incoming message representation of type Graphite plain text (name value timestamp) */
+/*! Network incoming message representation of type Graphite plain text (name value timestamp)
+ *  \note a message is a small trivially copyable record, it's passed and stored by value (no allocation, no reference counting)
+ */
 class Message
 {
   public:
@@ -24,30 +30,64 @@ class Message
      *  \param type is an identifier to categorise the message,
      *  \param value is the value number of the message
      *  \param timestamp is a timestamp for the message
-     *  \param received_timestamp is the time when the message has been received (in seconds)
+     *  \param received_timestamp is the time when the message has been received (in milliseconds)
      */
     Message( const std::string &type, double value,
              ulong timestamp          = utils::time::now(),
-             ulong received_timestamp = utils::time::now() );
+             ulong received_timestamp = utils::time::nowMilliseconds() );
 
-    /*! Create a message from an input string
-     *  \param input is a string representing a message
+    /*! Constructor
+     *  \param series is the ID of the message type (see SeriesTable)
+     *  \param value is the value number of the message
+     *  \param timestamp is a timestamp for the message
+     *  \param received_timestamp is the time when the message has been received (in milliseconds)
+     */
+    Message( series_id series, double value,
+             ulong timestamp          = utils::time::now(),
+             ulong received_timestamp = utils::time::nowMilliseconds() );
+
+    /*! Result of the parsing of a message line */
+    enum class ParseStatus
+    {
+      OK,            ///< The line is a valid message
+      EMPTY,         ///< The line only contains blanks
+      BAD_SYNTAX,    ///< The line doesn't have exactly 3 fields
+      BAD_VALUE,     ///< The value field is not a number
+      BAD_TIMESTAMP  ///< The timestamp field is not an unsigned integer
+    };
+
+    /*! Parse a message line (name value timestamp), fields are separated by runs of spaces or tabs
+     *  \param input     is the line to parse (without the line feed)
+     *  \param type      is set to the message type, it points into the input
+     *  \param value     is set to the message value
+     *  \param timestamp is set to the message timestamp
+     *  \return ParseStatus::OK if the line is a valid message, the output parameters are undefined otherwise
+     *  \note this function doesn't allocate memory nor throw
+     */
+    static ParseStatus parse( std::string_view input, std::string_view &type, double &value, ulong &timestamp );
+
+    /*! Create messages from an input string, one message per line
+     *  \param input is a string representing several messages separated by line feeds
      *  \param messages_container is the target container to put created messages
      *  \return true if at least one message could be created
      */
-    static bool createMessages( const std::string &input, std::vector<boost::shared_ptr<Message> > &messages_container );
+    static bool createMessages( std::string_view input, std::vector<Message> &messages_container );
 
     /*! Create a message from an input string
      *  \param input is a string representing a message
-     *  \param messages_container is the target container to put created messages
-     *  \return the created message (null if an error occured)
+     *  \return the created message (not valid if an error occured)
      */
-    static boost::shared_ptr<Message> createMessage( const std::string &input );
+    static Message createMessage( std::string_view input );
 
     /*! Message type getter
      *  \return the type of the message
      */
-    const std::string& getType() const { return m_type; }
+    const std::string& getType() const { return SeriesTable::instance().name( m_series ); }
+
+    /*! Message series ID getter
+     *  \return the ID of the message type
+     */
+    series_id getSeries() const { return m_series; }
 
     /*! Message value getter
      *  \return the value of the message
@@ -60,20 +100,32 @@ class Message
     ulong getTimestamp() const { return m_timestamp; }
 
     /*! Message received timestamp getter
-     *  \return the received timestamp of the message (in seconds)
+     *  \return the received timestamp of the message (in milliseconds)
      */
     ulong getReceivedTimestamp() const { return m_received_timestamp; }
 
     /*! Serialize the message by returning the string expected by Graphite
      *  \return a representation of the message
-     *  \note this function initialize the m_serialized variable only once. After the first call the value has already been computed, so directly returned it
      */
-    const std::string& serialize();
+    std::string serialize() const;
+
+    /*! Serialize the message into a caller provided buffer (name value timestamp, without line feed)
+     *  \param output      is the buffer to write into
+     *  \param output_size is the size of the buffer
+     *  \return the number of written characters (0 if the message is not valid or if the buffer is too small)
+     *  \note the value is written with the shortest representation that reads back to the same double
+     */
+    size_t serialize( char* output, size_t output_size ) const;
+
+    /*! Serialize the message at the end of a string (name value timestamp, without line feed)
+     *  \param output is the string to append the message to
+     */
+    void appendTo( std::string &output ) const;
 
     /*! Get the length of the serialized representation of the message
      *  \return the length of the string representation of the message
      */
-    ulong length();
+    ulong length() const;
 
     /*! Is this message valid? It means it has a non empty type
      *  \return true if the message is considered valid
@@ -82,8 +134,8 @@ class Message
 
   private:
 
-    /*! Message content type (category) */
-    std::string m_type;
+    /*! Message content type (category), interned into the SeriesTable */
+    series_id   m_series;
 
     /*! Message content value */
     double      m_value;
@@ -91,15 +143,10 @@ class Message
     /*! Message content time */
     ulong       m_timestamp;
 
-    /*! Message receiving time (in seconds) */
+    /*! Message receiving time (in milliseconds) */
     ulong       m_received_timestamp;
-
-    /*! This variable old the entire content of the message. It's empty at the message creation. It's computed when needed */
-    std::string m_serialized;
 };
 
-typedef boost::shared_ptr<Message> message_ptr;
-
 } // namespace graphite_proxy
 
 #endif // GRAPHITE_PROXY_MESSAGE_HPP
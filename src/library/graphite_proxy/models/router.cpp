@@ -9,19 +9,29 @@
 #include <boost/algorithm/string.hpp>
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <stdio.h>
 
 namespace graphite_proxy {
 
-Router::Router( global_buffer_ptr global_buffer, maths::maths_ptr maths_pipeline )
+Router::Router( global_buffer_ptr global_buffer, maths::maths_ptr maths_pipeline, size_t cache_size )
   : m_global_buffer( global_buffer )
   , m_maths_pipeline( maths_pipeline )
+  , m_cache_size( maths_pipeline ? cache_size : 0 )
+  , m_cache_hits( 0 )
+  , m_cache_misses( 0 )
 {
-  // Nothing
+  // Without Maths Pipeline, every message goes to the Global Buffer: there is nothing to cache
+  if( m_cache_size > 0 )
+  {
+    m_cache.reset( new std::atomic<uint64_t>[m_cache_size] );
+    for( size_t i = 0; i < m_cache_size; i++ )
+      m_cache[i].store( 0, std::memory_order_relaxed );
+  }
 }
 
-bool Router::routeMessage( const std::string& message ) const
+bool Router::routeMessage( std::string_view message ) const
 {
   if( message.empty() )
     return false;
@@ -29,20 +39,39 @@ bool Router::routeMessage( const std::string& message ) const
   return this->routeMessage( Message::createMessage(message) );
 }
 
-bool Router::routeMessage( const message_ptr message ) const
+size_t Router::routeMessages( const char* content, size_t length ) const
 {
-  if( message && message->isValid() )
+  size_t nbr_routed = 0;
+  const char* end = content + length;
+  while( content < end )
+  {
+    const char* eol = static_cast<const char*>( memchr( content, '\n', end - content ) );
+    if( !eol )
+      eol = end;
+
+    if( eol != content && this->routeMessage( std::string_view( content, eol - content ) ) )
+      nbr_routed++;
+
+    content = eol + 1;
+  }
+
+  return nbr_routed;
+}
+
+bool Router::routeMessage( const Message &message ) const
+{
+  if( message.isValid() )
   {
     STATS_INCREMENT( stats::STATS_MESSAGE_CREATED );
 
-    if( m_maths_pipeline && m_maths_pipeline->isWanted( message->getType() ) )
+    if( m_maths_pipeline && this->isMaths( message ) )
     {
-      LOG_DEBUG( "Route message to Maths: " + message->serialize(), utils::logging::LOG_HEADER_ROUTER );
+      LOG_DEBUG( "Route message to Maths: " + message.serialize(), utils::logging::LOG_HEADER_ROUTER );
       m_maths_pipeline->add( message );
     }
     else
     {
-      LOG_DEBUG( "Route message to Global Buffer: " + message->serialize(), utils::logging::LOG_HEADER_ROUTER );
+      LOG_DEBUG( "Route message to Global Buffer: " + message.serialize(), utils::logging::LOG_HEADER_ROUTER );
       m_global_buffer->add( message );
     }
 
@@ -55,10 +84,39 @@ bool Router::routeMessage( const message_ptr message ) const
   }
 }
 
+bool Router::isMaths( const Message &message ) const
+{
+  const series_id series = message.getSeries();
+  if( m_cache_size == 0 || series == INVALID_SERIES_ID )
+    return m_maths_pipeline->isWanted( message.getType() );
+
+  // The generation is read before matching, so a decision taken during a reload is stored with the outdated generation
+  const uint64_t key = ( static_cast<uint64_t>( series ) << 31 ) | ( m_maths_pipeline->getGeneration() & 0x7FFFFFFF );
+  std::atomic<uint64_t>& entry = m_cache[series % m_cache_size];
+
+  const uint64_t cached = entry.load( std::memory_order_relaxed );
+  if( ( cached >> 1 ) == key )
+  {
+    m_cache_hits.fetch_add( 1, std::memory_order_relaxed );
+    return cached & 1;
+  }
+
+  m_cache_misses.fetch_add( 1, std::memory_order_relaxed );
+  const bool is_maths = m_maths_pipeline->isWanted( message.getType() );
+  entry.store( ( key << 1 ) | ( is_maths ? 1 : 0 ), std::memory_order_relaxed );
+  return is_maths;
+}
+
+void Router::getCacheStatistics( unsigned long &hits, unsigned long &misses )
+{
+  hits   = m_cache_hits.exchange( 0, std::memory_order_relaxed );
+  misses = m_cache_misses.exchange( 0, std::memory_order_relaxed );
+}
+
 int64_t Router::serialize( const std::string& pass_through_messages_filepath, const std::string& maths_messages_filepath )
 {
   // Retrieve pending pass through messages into the program
-  std::vector<message_ptr> messages;
+  std::vector<Message> messages;
   m_global_buffer->get( messages );
   long int nbr_saved_messages = this->serializeMessages( messages, pass_through_messages_filepath );
   if( nbr_saved_messages != -1 )
@@ -77,7 +135,7 @@ int64_t Router::serialize( const std::string& pass_through_messages_filepath, co
     messages.clear();
 
     // Get math buffers to prepare messages that will be saved with their suffixes
-    const std::map<std::string, std::vector<maths::MathOperation*>>& math_buffers = m_maths_pipeline->getBuffers();
+    const std::unordered_map<series_id, std::vector<maths::MathOperation*>>& math_buffers = m_maths_pipeline->getBuffers();
     std::vector<std::string> suffixes;
     for( auto& math_buffer : math_buffers )
     {
@@ -85,13 +143,12 @@ int64_t Router::serialize( const std::string& pass_through_messages_filepath, co
       for( size_t j = 0, size = math_operations.size(); j < size; j++ )
       {
         const size_t previous_size = messages.size();
-        MessageBuffer& buffer      = math_operations[j]->buffer;
-        buffer.get(messages);
+        math_operations[j]->get(messages);
         const size_t nbr_added_messages = messages.size() - previous_size;
         if( nbr_added_messages > 0 )
         {
-          // Add computation type as suffix for each messages
-          const std::string& computation_type = math_operations[j]->computation.readType();
+          // Add computation type as suffix for each messages (the first one of the operation, it loads them back into the same operation)
+          const std::string& computation_type = math_operations[j]->computations.front().readType();
           for( size_t i = 0; i < nbr_added_messages; i++ )
             suffixes.push_back( computation_type );
         }
@@ -114,7 +171,7 @@ int64_t Router::serialize( const std::string& pass_through_messages_filepath, co
   return nbr_saved_messages;
 }
 
-long int Router::serializeMessages( const std::vector<message_ptr>& messages, const std::string& filename, const std::vector<std::string>& suffixes ) const
+long int Router::serializeMessages( const std::vector<Message>& messages, const std::string& filename, const std::vector<std::string>& suffixes ) const
 {
   if( messages.empty() )
     return 0;
@@ -129,13 +186,13 @@ long int Router::serializeMessages( const std::vector<message_ptr>& messages, co
   }
 
   // Write messages into the save file
-  const std::vector<message_ptr>::size_type messages_count = messages.size();
+  const std::vector<Message>::size_type messages_count = messages.size();
   const std::vector<std::string>::size_type suffixes_count = suffixes.size();
-  std::vector<message_ptr>::size_type i;
+  std::vector<Message>::size_type i;
   for ( i = 0; i < messages_count; i++ )
   {
     // Print message
-    file << messages[i]->serialize();
+    file << messages[i].serialize();
 
     // Add suffix if there is one
     if( i < suffixes_count )
@@ -213,11 +270,11 @@ long int Router::loadMessages( const std::string& filename, bool math ) const
   return loaded;
 }
 
-void Router::badSyntax( const message_ptr message ) const
+void Router::badSyntax( const Message &message ) const
 {
-  if( message )
+  if( message.isValid() )
   {
-    LOG_WARNING( "Bad message syntax, drop it: " + message->serialize(), utils::logging::LOG_HEADER_REQUEST );
+    LOG_WARNING( "Bad message syntax, drop it: " + message.serialize(), utils::logging::LOG_HEADER_REQUEST );
   }
   else
   {
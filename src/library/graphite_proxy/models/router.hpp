@@ -7,12 +7,22 @@
 
 #include <boost/shared_ptr.hpp>
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace graphite_proxy {
 
-/*! Route messages to the Global Buffer or to the Maths Pipeline */
+/*! Default number of routing decisions kept by the Router */
+static const size_t ROUTER_DEFAULT_CACHE_SIZE = 65536;
+
+/*! Route messages to the Global Buffer or to the Maths Pipeline
+ *  The decision taken for a series is cached, so the maths filters are matched once per series instead of once per message.
+ *  The cache is a fixed array indexed by series ID: a series takes the slot of another one sharing its index.
+ */
 class Router
 {
   public:
@@ -20,20 +30,28 @@ class Router
     /*! Constructor
      *  \param global_buffer  is a GlobalBuffer instance
      *  \param maths_pipeline is a MathsPipeline instance
+     *  \param cache_size     is the number of routing decisions kept (0 to match the maths filters for each message)
      */
-    Router( global_buffer_ptr global_buffer, boost::shared_ptr<maths::MathsPipeline> maths_pipeline );
+    Router( global_buffer_ptr global_buffer, boost::shared_ptr<maths::MathsPipeline> maths_pipeline, size_t cache_size = ROUTER_DEFAULT_CACHE_SIZE );
 
     /*! Route a message depending on it's type
      *  \param message to route
      *  \return false if the message couldn't be routed
      */
-    bool routeMessage( const message_ptr message ) const;
+    bool routeMessage( const Message &message ) const;
 
     /*! Route a message depending on it's type
      *  \param message to route
      *  \return false if the message couldn't be routed
      */
-    bool routeMessage( const std::string& message ) const;
+    bool routeMessage( std::string_view message ) const;
+
+    /*! Route each line of a raw content (e.g. an UDP datagram)
+     *  \param content is the raw content, lines are separated by '\n'
+     *  \param length  is the content length
+     *  \return the number of routed messages
+     */
+    size_t routeMessages( const char* content, size_t length ) const;
 
     /*! Save all pending messages from the Global Buffer
      *  \param  pass_through_messages_filepath is the name of the file where the pass through messages will be save
@@ -49,12 +67,25 @@ class Router
      */
     long int load( const std::string& pass_through_messages_filepath, const std::string& maths_messages_filepath );
 
+    /*! Get and reset the usage of the routing decisions cache (usefull for statistics)
+     *  \param hits   receives the number of messages routed with a cached decision
+     *  \param misses receives the number of messages whose decision had to be taken
+     */
+    void getCacheStatistics( unsigned long &hits, unsigned long &misses );
+
   protected:
 
+    /*! Does a message go to the Maths Pipeline
+     *  \param message is a valid message
+     *  \return true if a maths category wants the message
+     *  \note a cached decision is used only if the maths configurations haven't been reloaded since it was taken
+     */
+    bool isMaths( const Message &message ) const;
+
     /*! Function called when a bad message is received
      *  \param message is the syntax incorrect message
      */
-    void badSyntax( const message_ptr message ) const;
+    void badSyntax( const Message &message ) const;
 
     /*! Load messages from a file
      *  \param filename is the file path to access the file
@@ -69,7 +100,7 @@ class Router
      *  \param suffixes are some suffixes to add at the end of a message line (default empty vector). For example: The message at position '2' will be suffixed by the suffix at position '2' and so on.
      *  \return the number of serialized messages
      */
-    long int serializeMessages( const std::vector<message_ptr>& messages, const std::string& filename, const std::vector<std::string>& suffixes = std::vector<std::string>() ) const;
+    long int serializeMessages( const std::vector<Message>& messages, const std::string& filename, const std::vector<std::string>& suffixes = std::vector<std::string>() ) const;
 
   private:
 
@@ -78,6 +109,18 @@ class Router
 
     /*! A MathsPipeline instance */
     boost::shared_ptr<maths::MathsPipeline> m_maths_pipeline;
+
+    /*! Routing decisions, by series ID modulo m_cache_size: the series ID, the maths generation and the decision in its lowest bit (0 if empty) */
+    std::unique_ptr<std::atomic<uint64_t>[]> m_cache;
+
+    /*! Number of routing decisions in m_cache */
+    size_t                                  m_cache_size;
+
+    /*! Number of messages routed with a cached decision */
+    mutable std::atomic<unsigned long>      m_cache_hits;
+
+    /*! Number of messages whose decision wasn't cached */
+    mutable std::atomic<unsigned long>      m_cache_misses;
 };
 
 typedef boost::shared_ptr<graphite_proxy::Router> router_ptr;
@@ -0,0 +1,73 @@
+#include "series_table.hpp"
+
+#include <boost/thread/locks.hpp>
+
+#include <limits>
+
+namespace graphite_proxy {
+
+SeriesTable& SeriesTable::instance()
+{
+  static SeriesTable s_instance;
+  return s_instance;
+}
+
+SeriesTable::SeriesTable()
+{
+  // Nothing
+}
+
+series_id SeriesTable::intern( std::string_view name )
+{
+  if( name.empty() )
+    return INVALID_SERIES_ID;
+
+  // Most names are already known
+  {
+    boost::shared_lock<boost::shared_mutex> lock( m_mutex );
+    auto found = m_ids.find( name );
+    if( found != m_ids.end() )
+      return found->second;
+  }
+
+  boost::unique_lock<boost::shared_mutex> lock( m_mutex );
+
+  // The name could have been added while the lock was released
+  auto found = m_ids.find( name );
+  if( found != m_ids.end() )
+    return found->second;
+
+  if( m_names.size() >= std::numeric_limits<series_id>::max() )
+    return INVALID_SERIES_ID;
+
+  m_names.emplace_back( name );
+  const series_id id = static_cast<series_id>( m_names.size() );
+  m_ids.emplace( m_names.back(), id );
+  return id;
+}
+
+series_id SeriesTable::find( std::string_view name ) const
+{
+  boost::shared_lock<boost::shared_mutex> lock( m_mutex );
+  auto found = m_ids.find( name );
+  return ( found != m_ids.end() ) ? found->second : INVALID_SERIES_ID;
+}
+
+const std::string& SeriesTable::name( series_id id ) const
+{
+  static const std::string s_empty;
+
+  boost::shared_lock<boost::shared_mutex> lock( m_mutex );
+  if( id == INVALID_SERIES_ID || id > m_names.size() )
+    return s_empty;
+
+  return m_names[id - 1];
+}
+
+size_t SeriesTable::size() const
+{
+  boost::shared_lock<boost::shared_mutex> lock( m_mutex );
+  return m_names.size();
+}
+
+} // namespace graphite_proxy
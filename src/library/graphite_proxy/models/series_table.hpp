@@ -0,0 +1,78 @@
+#ifndef GRAPHITE_PROXY_SERIES_TABLE_HPP
+#define GRAPHITE_PROXY_SERIES_TABLE_HPP
+
+#include <boost/thread/shared_mutex.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace graphite_proxy {
+
+/*! Compact identifier of a metric name (a series) */
+typedef uint32_t series_id;
+
+/*! Identifier of the empty metric name, it's never given to a real series */
+static const series_id INVALID_SERIES_ID = 0;
+
+/*! Global symbol table which interns metric names
+ *  Each distinct metric name is stored once and associated to a stable series ID.
+ *  Buffers and messages use this ID instead of the name, the name is only needed to match the maths filters and to send messages.
+ *  \note this class is a singleton
+ *  \note IDs are never recycled: a name keeps its ID for the whole program life, even if its buffers are removed by the Cleaner
+ */
+class SeriesTable
+{
+  public:
+
+    /*! Gets the unique series table instance
+     *  \return The unique series table instance
+     */
+    static SeriesTable& instance();
+
+    /*! Get the ID of a metric name, the name is added to the table if it's unknown
+     *  \param name is the metric name
+     *  \return the series ID (INVALID_SERIES_ID if the name is empty or the table is full)
+     */
+    series_id intern( std::string_view name );
+
+    /*! Get the ID of a metric name without adding it to the table
+     *  \param name is the metric name
+     *  \return the series ID (INVALID_SERIES_ID if the name is unknown)
+     */
+    series_id find( std::string_view name ) const;
+
+    /*! Get the metric name of a series ID
+     *  \param id is the series ID
+     *  \return the metric name (an empty string for an unknown ID)
+     *  \note the returned reference remains valid for the whole program life
+     */
+    const std::string& name( series_id id ) const;
+
+    /*! Get the number of interned names
+     *  \return the number of interned names
+     */
+    size_t size() const;
+
+  protected:
+
+    /*! Hidden constructor */
+    SeriesTable();
+
+  private:
+
+    /*! Interned names, the name of the ID 'n' is at the position 'n - 1'. A deque never moves its elements so views on them stay valid */
+    std::deque<std::string>                         m_names;
+
+    /*! Association between a name (a view on m_names) and its ID */
+    std::unordered_map<std::string_view, series_id> m_ids;
+
+    /*! Mutex for thread safety, lookups of known names only need a shared lock */
+    mutable boost::shared_mutex                     m_mutex;
+};
+
+} // namespace graphite_proxy
+
+#endif // GRAPHITE_PROXY_SERIES_TABLE_HPP
@@ -4,8 +4,6 @@
 
 #include <graphite_proxy/models/message.hpp>
 
-#include <boost/make_shared.hpp>
-
 namespace graphite_proxy {
 
 statistics_ptr Statistics::s_instance;
@@ -35,34 +33,44 @@ void Statistics::iteration()
 
   // Get other statistics values than those stored into m_metrics
   const unsigned long global_buffer_messages_max = m_buffer->getBuffersMaxMessages();
+  const size_t flush_queue_depth                 = m_buffer->getFlushQueueDepth();
   unsigned long math_buffer_messages_max = 0;
   if(m_math)
     math_buffer_messages_max = m_math->getBuffersMaxMessages();
+  unsigned long router_cache_hits = 0, router_cache_misses = 0;
+  m_router->getCacheStatistics( router_cache_hits, router_cache_misses );
 
+  // Take the metrics and reset them, so the incoming threads are not blocked while sending them
+  std::map<std::string, long> metrics;
   {
     boost::mutex::scoped_lock lock( m_mutex );
 
     // Some global buffers stats
     m_metrics[stats::STATS_GLOBAL_BUFFER_MESSAGES_MAX] = global_buffer_messages_max;
+    m_metrics[stats::STATS_FLUSH_QUEUE_DEPTH]          = flush_queue_depth;
 
     // Some math buffers stats
     m_metrics[stats::STATS_MATH_BUFFER_MESSAGES_MAX] = math_buffer_messages_max;
 
+    // Router stats (only when the routing decisions are cached)
+    if( router_cache_hits + router_cache_misses > 0 )
+    {
+      m_metrics[stats::STATS_ROUTER_CACHE_HITS]      = router_cache_hits;
+      m_metrics[stats::STATS_ROUTER_CACHE_MISSES]    = router_cache_misses;
+      m_metrics[stats::STATS_ROUTER_CACHE_HIT_RATIO] = router_cache_hits * 100 / ( router_cache_hits + router_cache_misses );
+    }
+
     // Stats of stats ;-)
     m_metrics[stats::STATS_STATS_MESSAGES] = m_metrics.size();
+
+    metrics.swap( m_metrics );
   }
 
   static const std::string stats_header = "graphite_proxy." + m_hostname + ".stats.";
 
   // Create each message and give it to the router so it can eventually go to the MathsPipeline or directly to the client
-  for( auto it = m_metrics.begin(); it != m_metrics.end(); ++it )
-    m_router->routeMessage( boost::make_shared<Message>( stats_header + it->first, it->second, timestamp ) );
-
-  {
-    // Reset statistic metrics
-    boost::mutex::scoped_lock lock( m_mutex );
-    m_metrics.clear();
-  }
+  for( auto it = metrics.begin(); it != metrics.end(); ++it )
+    m_router->routeMessage( Message( stats_header + it->first, it->second, timestamp ) );
 }
 
 void Statistics::raise( const std::string &metric_name, long value )
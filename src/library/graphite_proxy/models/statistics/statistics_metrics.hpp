@@ -10,6 +10,7 @@ namespace stats {
 static const std::string STATS_REQUESTS_INCOMING 				 = "requests.incoming.nbr";
 static const std::string STATS_REQUESTS_ACCEPTED 				 = "requests.accepted.nbr";
 static const std::string STATS_REQUESTS_DROPPED  				 = "requests.dropped.nbr";
+static const std::string STATS_REQUESTS_UDP_TRUNCATED   = "requests.udp.truncated.nbr"; // Number of datagrams bigger than the reception buffer
 static const std::string STATS_REQUESTS_SEND     				 = "requests.send.nbr";
 static const std::string STATS_REQUESTS_SEND_CONTENT     = "requests.send.content"; // Number of metrics messages into a client message
 
@@ -23,6 +24,7 @@ static const std::string STATS_MATHS_MIN                 = "maths.operations.min
 static const std::string STATS_MATHS_MAX                 = "maths.operations.max";
 static const std::string STATS_MATHS_MEDIAN              = "maths.operations.median";
 static const std::string STATS_MATHS_TILES               = "maths.operations.tiles";
+static const std::string STATS_MATHS_PERCENTILE          = "maths.operations.percentile";
 
 // Statistics metrics of statistics
 static const std::string STATS_STATS_MESSAGES 					 = "statistics.messages.created.nbr";
@@ -30,13 +32,30 @@ static const std::string STATS_STATS_MESSAGES 					 = "statistics.messages.creat
 // Buffers
 static const std::string STATS_GLOBAL_BUFFER_MESSAGES_MAX= "global_buffer.messages.max";
 static const std::string STATS_MATH_BUFFER_MESSAGES_MAX  = "math_buffer.messages.max";
+static const std::string STATS_FLUSH_QUEUE_DEPTH         = "global_buffer.flush_queue.depth"; // Number of full buffers waiting to be sent
+static const std::string STATS_FLUSH_QUEUE_FULL          = "global_buffer.flush_queue.full.nbr"; // Number of full buffers kept because the queue was full
 
 // Client
 static const std::string STATS_CLIENT_CONNECTIONFAILED   = "client.connection.failed.nbr";
+static const std::string STATS_CLIENT_CONNECTION_LOST    = "client.connection.lost.nbr"; // Connections closed by the server or broken while writing
+static const std::string STATS_CLIENT_RECONNECTED        = "client.connection.reconnected.nbr";
+static const std::string STATS_CLIENT_CIRCUIT_OPEN       = "client.circuit.open.nbr"; // Number of times a server is not sent anything after too many failures
+static const std::string STATS_CLIENT_FAILOVER           = "client.failover.nbr"; // Messages sent to another server than their own because it is unhealthy
+static const std::string STATS_CLIENT_REPLICA_FAILED     = "client.replica.failed.nbr"; // Copies of messages lost because neither their replica nor a spare node took them
+static const std::string STATS_CLIENT_REPLICA_REROUTED   = "client.replica.rerouted.nbr"; // Copies of messages sent to a spare node because their replica failed
+static const std::string STATS_CLIENT_COMPRESSION_INPUT  = "client.compression.input.bytes"; // Bytes given to the compressor
+static const std::string STATS_CLIENT_COMPRESSION_OUTPUT = "client.compression.output.bytes"; // Compressed bytes written
+static const std::string STATS_CLIENT_QUEUE_FULL         = "client.queue.full.nbr"; // Number of batches refused because too many are waiting to be written
+static const std::string STATS_CLIENT_RATE_PACED        = "client.rate.paced.nbr"; // Number of times writes wait for the rate limit
 
 // Message
 static const std::string STATS_MESSAGE_CREATED 					 = "messages.created.nbr";
 
+// Router
+static const std::string STATS_ROUTER_CACHE_HITS         = "router.cache.hit.nbr"; // Messages routed with a cached decision
+static const std::string STATS_ROUTER_CACHE_MISSES       = "router.cache.miss.nbr"; // Messages whose decision had to be taken
+static const std::string STATS_ROUTER_CACHE_HIT_RATIO    = "router.cache.hit.ratio"; // Percentage of the messages routed with a cached decision
+
 } // namespace stats
 } // namespace graphite_proxy
 
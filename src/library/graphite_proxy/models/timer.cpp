@@ -2,32 +2,128 @@
 
 #include <graphite_proxy/models/message.hpp>
 
+#include <boost/weak_ptr.hpp>
+
+#include <algorithm>
 #include <vector>
 
 namespace graphite_proxy {
 
-Timer::Timer( global_buffer_ptr buffer, networking::client_ptr client, long buffer_flush_time )
+Timer::Timer( global_buffer_ptr buffer, networking::client_ptr client, long buffer_flush_time, size_t chunk_size )
   : Iterations( buffer_flush_time, utils::logging::LOG_HEADER_TIMER )
   , m_buffer( buffer )
   , m_client( client )
+  , m_chunk_size( chunk_size )
+  , m_flush_bytes( 0 )
+  , m_flush_age( 0 )
+  , m_last_flush( std::chrono::steady_clock::now() )
+  , m_retry_delay( TIMER_RETRY_MIN_DELAY )
+  , m_is_failing( false )
 {
   // Nothing
 }
 
+void Timer::setFlushPolicy( size_t max_bytes, unsigned long max_age )
+{
+  m_flush_bytes = max_bytes;
+  m_flush_age   = std::chrono::milliseconds( max_age );
+
+  // The thread adding the message reaching the size wakes the timer up, instead of waiting for the next iteration
+  // The buffer may outlive the timer, so the trigger doesn't keep it
+  boost::weak_ptr<Timer> timer = boost::static_pointer_cast<Timer>( this->shared_from_this() );
+  m_buffer->setFlushTrigger( m_flush_bytes, [timer]()
+  {
+    if( timer_ptr locked = timer.lock() )
+      locked->wake();
+  } );
+}
+
+bool Timer::isFlushDue( std::chrono::steady_clock::time_point now ) const
+{
+  if( m_flush_bytes == 0 && m_flush_age.count() == 0 )
+    return true;
+
+  if( this->isRetryDue( now ) )
+  {
+    if( m_flush_bytes > 0 && m_buffer->getBufferedBytes() >= m_flush_bytes )
+      return true;
+
+    if( m_flush_age.count() > 0 && m_buffer->getOldestAge() >= m_flush_age )
+      return true;
+  }
+
+  return now - m_last_flush >= std::chrono::seconds( m_sleep_time );
+}
+
+long Timer::getNextSleep() const
+{
+  if( m_flush_age.count() == 0 )
+    return Iterations::getNextSleep();
+
+  // Wake up when the oldest message reaches its maximum age, or at the end of the sleep time
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  const std::chrono::milliseconds until_flush = std::chrono::duration_cast<std::chrono::milliseconds>( m_last_flush + std::chrono::seconds( m_sleep_time ) - now );
+  std::chrono::milliseconds until_age         = m_flush_age - m_buffer->getOldestAge();
+  if( m_is_failing )
+    until_age = std::max( until_age, std::chrono::duration_cast<std::chrono::milliseconds>( m_last_flush + m_retry_delay - now ) );
+
+  return std::max<long>( std::min( until_flush, until_age ).count(), 1 );
+}
+
 void Timer::iteration()
 {
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if( !this->isFlushDue( now ) )
+    return;
+
+  // The retry delay grows while the flushes fail, up to the sleep time
+  m_retry_delay = m_is_failing ? std::min<std::chrono::milliseconds>( m_retry_delay * 2, std::chrono::seconds( m_sleep_time ) )
+                               : std::chrono::milliseconds( TIMER_RETRY_MIN_DELAY );
+  m_last_flush  = now;
+
   // Get messages from the Global Buffer
-  std::vector<message_ptr> messages_to_send;
+  std::vector<Message> messages_to_send;
   m_buffer->get( messages_to_send );
 
   LOG_DEBUG( std::to_string( messages_to_send.size() ) + " messages to send", utils::logging::LOG_HEADER_TIMER );
 
-  // Try to send the messages to the Graphite Server
-  if( !m_client->send( messages_to_send ) )
+  if( messages_to_send.empty() )
+    return;
+
+  // Hand the messages to the client, they are put back into the Global Buffer if they can't be sent
+  global_buffer_ptr buffer    = m_buffer;
+  boost::weak_ptr<Timer> timer = boost::static_pointer_cast<Timer>( this->shared_from_this() );
+  const networking::Client::completion_handler restore = [buffer, timer]( bool sent, std::vector<Message> &messages )
+  {
+    if( !sent )
+      buffer->restore( messages );
+
+    if( timer_ptr locked = timer.lock() )
+      locked->m_is_failing = !sent;
+  };
+
+  if( m_chunk_size == 0 || messages_to_send.size() <= m_chunk_size )
+  {
+    if( !m_client->sendAsync( messages_to_send, restore ) )
+    {
+      m_is_failing = true;
+      m_buffer->restore( messages_to_send );
+    }
+    return;
+  }
+
+  // Smaller batches are paced by the connections instead of hitting the servers all at once
+  for( size_t begin = 0; begin < messages_to_send.size(); begin += m_chunk_size )
   {
-    // Messages can't be send, back them back into the Global Buffer
-    for( message_ptr message : messages_to_send )
-      m_buffer->add(message);
+    std::vector<Message> chunk( messages_to_send.begin() + begin, messages_to_send.begin() + std::min( begin + m_chunk_size, messages_to_send.size() ) );
+    if( !m_client->sendAsync( chunk, restore ) )
+    {
+      // The client refuses more messages, the remaining ones wait for the next iteration
+      m_is_failing = true;
+      std::vector<Message> remaining( messages_to_send.begin() + begin, messages_to_send.end() );
+      m_buffer->restore( remaining );
+      return;
+    }
   }
 }
 
@@ -10,10 +10,23 @@
 
 #include <boost/shared_ptr.hpp>
 
+#include <atomic>
+#include <chrono>
+
 namespace graphite_proxy {
 
+/*! Default maximum number of messages handed to the client at once */
+static const size_t TIMER_DEFAULT_CHUNK_SIZE = 1000;
+
+/*! Delay before the size or the age of the messages trigger a flush again after a failed flush (in milliseconds), doubled after each failure */
+static const unsigned long TIMER_RETRY_MIN_DELAY = 100;
+
 /*! Timer class is the link between the Global Buffer and the Client.
- *  It will give buffered messages to the client when needed
+ *  It will give buffered messages to the client when needed, in chunks so the connections can pace them
+ *  \note with a flush policy, the messages are given as soon as they reach a size or the oldest one reaches an age,
+ *        and at least once per sleep time. Otherwise they are given once per sleep time.
+ *  \note while the messages are put back because the client can't send them, the size and the age only trigger a flush
+ *        once the retry delay has passed, so the same messages are not taken and put back again in a loop.
  */
 class Timer : public Iterations
 {
@@ -23,21 +36,64 @@ class Timer : public Iterations
      *  \param buffer is a GlobalBuffer instance to pick messages
      *  \param client is a Client instance to give messages
      *  \param buffer_flush_time is the amount of time to wait before calling a new send messages iteration
+     *  \param chunk_size is the maximum number of messages handed to the client at once, 0 hands all of them at once
+     */
+    Timer( global_buffer_ptr buffer, networking::client_ptr client, long buffer_flush_time, size_t chunk_size = TIMER_DEFAULT_CHUNK_SIZE );
+
+    /*! Flush the Global Buffer according to the size and the age of the buffered messages
+     *  \param max_bytes is the estimated size of the buffered messages triggering a flush, 0 ignores the size
+     *  \param max_age   is the time the oldest message may wait before a flush (in milliseconds), 0 ignores the age
+     *  \note must be called before starting the timer and adding messages, on a timer owned by a timer_ptr
      */
-    Timer( global_buffer_ptr buffer, networking::client_ptr client, long buffer_flush_time );
+    void setFlushPolicy( size_t max_bytes, unsigned long max_age );
 
   protected:
 
     /*! Get messages from the Global Buffer and give them to the Client */
     void iteration();
 
+    /*! Get the time to sleep until the next flush is due
+     *  \return the time to sleep (in milliseconds)
+     */
+    long getNextSleep() const;
+
   private:
 
+    /*! Is a flush due according to the flush policy
+     *  \param now is the current time
+     *  \return true if the buffered messages have to be given to the Client
+     */
+    bool isFlushDue( std::chrono::steady_clock::time_point now ) const;
+
+    /*! Can the size and the age of the messages trigger a flush
+     *  \param now is the current time
+     *  \return false while the flushes fail and the retry delay has not passed
+     */
+    bool isRetryDue( std::chrono::steady_clock::time_point now ) const { return !m_is_failing || now - m_last_flush >= m_retry_delay; }
+
     /*! An instance of the Global Buffer */
     global_buffer_ptr      m_buffer;
 
     /*! An instance of the Client */
     networking::client_ptr m_client;
+
+    /*! Maximum number of messages handed to the client at once */
+    const size_t           m_chunk_size;
+
+    /*! Estimated size of the buffered messages triggering a flush (0 to ignore it) */
+    size_t                 m_flush_bytes;
+
+    /*! Age of the oldest message triggering a flush (0 to ignore it) */
+    std::chrono::milliseconds m_flush_age;
+
+    /*! Time of the last flush */
+    std::chrono::steady_clock::time_point m_last_flush;
+
+    /*! Delay after the last flush before the size and the age trigger a flush again, while the flushes fail */
+    std::chrono::milliseconds m_retry_delay;
+
+    /*! Have the messages of the last flush been put back (set from the client threads) */
+    std::atomic<bool>      m_is_failing;
 };
 
 typedef boost::shared_ptr<Timer> timer_ptr;
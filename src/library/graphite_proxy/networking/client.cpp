@@ -1,37 +1,102 @@
 #include "client.hpp"
 
+#include <graphite_proxy/models/series_table.hpp>
 #include <graphite_proxy/models/statistics/statistics_metrics.hpp>
 #include <graphite_proxy/models/statistics/statistics.hpp>
 
 #include <graphite_proxy/utils/logging/logger.hpp>
 #include <graphite_proxy/utils/logging/log_headers.hpp>
 
-#include <sstream>
+#include <boost/algorithm/string.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <algorithm>
+#include <future>
 
 namespace graphite_proxy {
 namespace networking {
 
-Client::Client( const std::string &host, const std::string &port )
- : m_socket( m_io_service )
- , m_ready( false )
+Client::Client( const std::string &host, const std::string &port, unsigned long reconnect_min_delay, unsigned long reconnect_max_delay, size_t max_pending, unsigned long health_check_interval )
+  : m_replication_factor( 1 )
+  , m_stopped( false )
 {
-  LOG_INFO( "Creating client to: " + host + ":" + port, utils::logging::LOG_HEADER_CLIENT );
+  m_connections.push_back( boost::make_shared<Connection>( host, port, reconnect_min_delay, reconnect_max_delay, max_pending, health_check_interval ) );
+  m_ring.addNode( host, "", 0 );
+}
 
-  try
+Client::Client( const std::vector<Destination> &destinations, size_t replication_factor, unsigned long reconnect_min_delay, unsigned long reconnect_max_delay, size_t max_pending, unsigned long health_check_interval )
+  : m_stopped( false )
+{
+  for( const Destination &destination : destinations )
   {
-    boost::asio::ip::tcp::resolver resolver( m_io_service );
-    boost::asio::ip::tcp::resolver::query query( boost::asio::ip::tcp::v4(), host, port );
-    m_tcp_iterator = resolver.resolve( query );
-    m_ready = true;
+    m_ring.addNode( destination.host, destination.instance, m_connections.size() );
+    m_connections.push_back( boost::make_shared<Connection>( destination.host, destination.port, reconnect_min_delay, reconnect_max_delay, max_pending, health_check_interval, destination.protocol, destination.compression ) );
   }
-  catch (...)
+
+  m_replication_factor = std::max( std::min( replication_factor, m_connections.size() ), size_t(1) );
+
+  if( m_connections.size() > 1 )
+    LOG_INFO( "Spreading series among " + std::to_string( m_connections.size() ) + " destinations (replication factor: " + std::to_string( m_replication_factor ) + ")", utils::logging::LOG_HEADER_CLIENT );
+}
+
+Client::~Client()
+{
+  // The pending copies are completed before the members they are rerouted with are destroyed
+  this->stop();
+}
+
+bool Client::send( const std::vector<Message> &messages )
+{
+  if( m_connections.size() == 1 )
+    return m_connections[0]->send( messages );
+
+  if( messages.empty() || !this->isReady() )
+    return false;
+
+  std::vector<Message> messages_to_send( messages );
+  std::vector<std::vector<Message>> parts, replicas;
+  this->split( messages_to_send, parts, replicas );
+
+  // Wait for the completion of each part (the state is shared with the connection threads, which may still hold it when the result is set)
+  struct Result
+  {
+    boost::mutex       mutex;
+    size_t             remaining;
+    bool               sent;
+    std::promise<bool> promise;
+  };
+
+  boost::shared_ptr<Result> result = boost::make_shared<Result>();
+  result->remaining = 0;
+  result->sent      = true;
+  for( const std::vector<Message> &part : parts )
+    result->remaining += part.empty() ? 0 : 1;
+
+  const completion_handler handler = [result]( bool sent, std::vector<Message>& )
+  {
+    boost::mutex::scoped_lock lock( result->mutex );
+    result->sent = result->sent && sent;
+    if( --result->remaining == 0 )
+      result->promise.set_value( result->sent );
+  };
+
+  std::future<bool> sent = result->promise.get_future();
+  for( size_t i = 0; i < parts.size(); i++ )
   {
-    LOG_ERROR( "Client could not start", utils::logging::LOG_HEADER_CLIENT );
+    if( !parts[i].empty() && !m_connections[i]->sendAsync( parts[i], handler ) )
+      handler( false, parts[i] );
   }
+
+  this->sendReplicas( replicas );
+  return sent.get();
 }
 
-bool Client::send( const std::vector<message_ptr> &messages )
+bool Client::sendAsync( std::vector<Message> &messages, completion_handler handler )
 {
+  if( m_connections.size() == 1 )
+    return m_connections[0]->sendAsync( messages, handler );
+
   if( messages.empty() )
   {
     LOG_DEBUG( "Nothing to send", utils::logging::LOG_HEADER_CLIENT );
@@ -39,43 +104,299 @@ bool Client::send( const std::vector<message_ptr> &messages )
   }
   else if( !this->isReady() )
   {
-    // Not ready to communicate with Graphite, abort
     LOG_WARNING( "Not ready to send", utils::logging::LOG_HEADER_CLIENT );
     return false;
   }
 
-  boost::mutex::scoped_lock lock( m_mutex );
+  std::vector<std::vector<Message>> parts, replicas;
+  this->split( messages, parts, replicas );
 
-  // Try to connect to the Graphite Server
-  try
+  for( size_t i = 0; i < parts.size(); i++ )
   {
-    boost::asio::connect( m_socket, m_tcp_iterator );
+    if( !parts[i].empty() && !m_connections[i]->sendAsync( parts[i], handler ) && handler )
+      handler( false, parts[i] );
   }
-  catch( const boost::system::system_error &e )
-  {
-    // One more failed connection attempt
-    STATS_INCREMENT( stats::STATS_CLIENT_CONNECTIONFAILED );
-    LOG_ERROR( (e.code() == boost::asio::error::connection_refused) ? "Connection refused" : std::string("Connection problem: ") + e.what(), utils::logging::LOG_HEADER_CLIENT );
+
+  this->sendReplicas( replicas );
+  return true;
+}
+
+void Client::setCircuitBreaker( unsigned int max_failures, unsigned long cooldown )
+{
+  for( const connection_ptr &connection : m_connections )
+    connection->setCircuitBreaker( max_failures, cooldown );
+}
+
+void Client::setRateLimit( double messages_per_second, double bytes_per_second, unsigned long max_latency )
+{
+  for( const connection_ptr &connection : m_connections )
+    connection->setRateLimit( messages_per_second, bytes_per_second, max_latency );
+}
+
+void Client::stop()
+{
+  m_stopped = true;
+  for( const connection_ptr &connection : m_connections )
+    connection->stop();
+}
+
+bool Client::isReady() const
+{
+  if( m_connections.empty() )
     return false;
+
+  for( const connection_ptr &connection : m_connections )
+  {
+    if( !connection->isReady() )
+      return false;
   }
 
-  // Build the message to send
-  size_t messages_count = messages.size();
-  std::stringstream computed_message;
-  for(size_t messages_offset = 0; messages_offset < messages_count; messages_offset++)
-    computed_message << messages[messages_offset]->serialize() << '\n';
+  return true;
+}
+
+bool Client::isConnected() const
+{
+  if( m_connections.empty() )
+    return false;
 
-  // Send the data
-  const std::string graphite_message = computed_message.str();
-  boost::asio::write( m_socket, boost::asio::buffer( graphite_message, graphite_message.size() ) );
+  for( const connection_ptr &connection : m_connections )
+  {
+    if( !connection->isConnected() )
+      return false;
+  }
 
-  LOG_INFO( "Sending " + std::to_string(messages_count) + " messages", utils::logging::LOG_HEADER_CLIENT );
-  LOG_DEBUG( "Send content:\n" + graphite_message, utils::logging::LOG_HEADER_CLIENT );
-  STATS_INCREMENT( stats::STATS_REQUESTS_SEND );
-  STATS_RAISE( stats::STATS_REQUESTS_SEND_CONTENT, messages_count );
   return true;
 }
 
+size_t Client::getPendingBatches() const
+{
+  size_t result = 0;
+  for( const connection_ptr &connection : m_connections )
+    result += connection->getPendingBatches();
+
+  return result;
+}
+
+size_t Client::getNbrHealthyDestinations() const
+{
+  size_t result = 0;
+  for( const connection_ptr &connection : m_connections )
+    result += connection->isHealthy() ? 1 : 0;
+
+  return result;
+}
+
+size_t Client::getDestination( series_id series ) const
+{
+  std::vector<size_t> destinations;
+  this->getDestinations( series, destinations );
+  return destinations.front();
+}
+
+bool Client::getDestinations( series_id series, std::vector<size_t> &destinations ) const
+{
+  if( m_connections.size() <= 1 )
+  {
+    destinations.push_back( 0 );
+    return false;
+  }
+
+  const std::string &name = SeriesTable::instance().name( series );
+  const size_t       first = destinations.size();
+  m_ring.getNodes( name, m_replication_factor, destinations );
+
+  bool is_healthy = true;
+  for( size_t i = first; i < destinations.size() && is_healthy; i++ )
+    is_healthy = m_connections[destinations[i]]->isHealthy();
+
+  if( is_healthy )
+    return false;
+
+  // Skip the unhealthy nodes, the next healthy ones on the ring take their part
+  std::vector<size_t> nodes;
+  m_ring.getNodes( name, m_connections.size(), nodes );
+  destinations.resize( first );
+  for( size_t node : nodes )
+  {
+    if( m_connections[node]->isHealthy() && destinations.size() - first < m_replication_factor )
+      destinations.push_back( node );
+  }
+
+  // No server is healthy, the messages wait in the queues of their own nodes
+  if( destinations.size() == first )
+  {
+    destinations.insert( destinations.end(), nodes.begin(), nodes.begin() + m_replication_factor );
+    return false;
+  }
+
+  return destinations[first] != nodes.front();
+}
+
+void Client::split( std::vector<Message> &messages, std::vector<std::vector<Message>> &parts, std::vector<std::vector<Message>> &replicas ) const
+{
+  parts.resize( m_connections.size() );
+  if( m_replication_factor > 1 )
+    replicas.resize( m_connections.size() );
+
+  // Messages usually come grouped by series, so the destinations are only computed when the series changes
+  series_id           series      = INVALID_SERIES_ID;
+  std::vector<size_t> destinations;
+  bool                is_rerouted = false;
+  size_t              rerouted    = 0;
+  for( const Message &message : messages )
+  {
+    if( message.getSeries() != series )
+    {
+      series = message.getSeries();
+      destinations.clear();
+      is_rerouted = this->getDestinations( series, destinations );
+    }
+
+    parts[destinations.front()].push_back( message );
+    for( size_t i = 1; i < destinations.size(); i++ )
+      replicas[destinations[i]].push_back( message );
+
+    rerouted += is_rerouted ? 1 : 0;
+  }
+
+  messages.clear();
+
+  if( rerouted > 0 )
+    STATS_RAISE( stats::STATS_CLIENT_FAILOVER, rerouted );
+}
+
+void Client::sendReplicas( std::vector<std::vector<Message>> &replicas )
+{
+  for( size_t i = 0; i < replicas.size(); i++ )
+  {
+    if( replicas[i].empty() )
+      continue;
+
+    const completion_handler reroute = [this, i]( bool sent, std::vector<Message> &messages ) { if( !sent ) this->rerouteReplicas( i, messages ); };
+    if( !m_connections[i]->sendAsync( replicas[i], reroute ) )
+      this->rerouteReplicas( i, replicas[i] );
+  }
+}
+
+void Client::rerouteReplicas( size_t failed, std::vector<Message> &messages )
+{
+  static const completion_handler count_failures = []( bool sent, std::vector<Message> &messages )
+  {
+    if( !sent )
+      STATS_RAISE( stats::STATS_CLIENT_REPLICA_FAILED, messages.size() );
+  };
+
+  // The other connections are stopped as well, the copies are lost
+  if( m_stopped )
+  {
+    count_failures( false, messages );
+    return;
+  }
+
+  // Messages usually come grouped by series, so the spare node is only computed when the series changes
+  std::vector<std::vector<Message>> parts( m_connections.size() );
+  series_id series = INVALID_SERIES_ID;
+  size_t    spare  = m_connections.size();
+  size_t    lost   = 0;
+  for( const Message &message : messages )
+  {
+    if( message.getSeries() != series )
+    {
+      series = message.getSeries();
+      spare  = this->getSpareDestination( series, failed );
+    }
+
+    if( spare < m_connections.size() )
+      parts[spare].push_back( message );
+    else lost++;
+  }
+
+  if( lost > 0 )
+    STATS_RAISE( stats::STATS_CLIENT_REPLICA_FAILED, lost );
+  if( lost < messages.size() )
+  {
+    STATS_RAISE( stats::STATS_CLIENT_REPLICA_REROUTED, messages.size() - lost );
+    LOG_WARNING( std::to_string( messages.size() - lost ) + " copies not written to " + m_connections[failed]->getName() + " are sent to another destination", utils::logging::LOG_HEADER_CLIENT );
+  }
+
+  // The copies are rerouted once, a second failure loses them
+  for( size_t i = 0; i < parts.size(); i++ )
+  {
+    if( !parts[i].empty() && !m_connections[i]->sendAsync( parts[i], count_failures ) )
+      count_failures( false, parts[i] );
+  }
+}
+
+size_t Client::getSpareDestination( series_id series, size_t failed ) const
+{
+  std::vector<size_t> destinations;
+  this->getDestinations( series, destinations );
+
+  // Once the failed node is skipped, the last destination is the one taking its place: it doesn't hold the series yet
+  std::vector<size_t> holders( destinations );
+  if( std::find( holders.begin(), holders.end(), failed ) == holders.end() && holders.size() == m_replication_factor )
+    holders.pop_back();
+  holders.push_back( failed );
+
+  std::vector<size_t> nodes;
+  m_ring.getNodes( SeriesTable::instance().name( series ), m_connections.size(), nodes );
+  for( size_t node : nodes )
+  {
+    if( m_connections[node]->isHealthy() && std::find( holders.begin(), holders.end(), node ) == holders.end() )
+      return node;
+  }
+
+  return m_connections.size();
+}
+
+bool Client::parseDestinations( const std::string &input, std::vector<Destination> &destinations, Protocol protocol, Compression compression )
+{
+  std::vector<std::string> items;
+  boost::split( items, input, boost::is_any_of( ", \t\n" ), boost::token_compress_on );
+
+  for( const std::string &item : items )
+  {
+    if( item.empty() )
+      continue;
+
+    // The protocol and the compression may be given before the address
+    Destination destination;
+    destination.protocol    = protocol;
+    destination.compression = compression;
+
+    std::string address = item;
+    const size_t scheme_end = address.find( "://" );
+    if( scheme_end != std::string::npos )
+    {
+      std::vector<std::string> schemes;
+      boost::split( schemes, address.substr( 0, scheme_end ), boost::is_any_of( "+" ) );
+      for( const std::string &scheme : schemes )
+      {
+        if( !encoder::parseProtocol( scheme, destination.protocol ) && !Compressor::parse( scheme, destination.compression ) )
+        {
+          LOG_ERROR( "Bad destination protocol: " + item, utils::logging::LOG_HEADER_CLIENT );
+          return false;
+        }
+      }
+      address.erase( 0, scheme_end + 3 );
+    }
+
+    std::vector<std::string> fields;
+    boost::split( fields, address, boost::is_any_of( ":" ) );
+    if( fields.size() < 2 || fields.size() > 3 || fields[0].empty() || fields[1].empty() )
+    {
+      LOG_ERROR( "Bad destination: " + item, utils::logging::LOG_HEADER_CLIENT );
+      return false;
+    }
+
+    destination.host     = fields[0];
+    destination.port     = fields[1];
+    destination.instance = ( fields.size() == 3 ) ? fields[2] : "";
+    destinations.push_back( destination );
+  }
+
+  return !destinations.empty();
+}
+
 } // namespace networking
 } // namespace graphite proxy
-
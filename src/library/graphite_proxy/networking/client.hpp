@@ -2,10 +2,12 @@
 #define GRAPHITE_PROXY_CLIENT_HPP
 
 #include <graphite_proxy/models/message.hpp>
+#include <graphite_proxy/networking/connection.hpp>
+#include <graphite_proxy/networking/hash_ring.hpp>
 
-#include <boost/asio.hpp>
 #include <boost/shared_ptr.hpp>
-#include <boost/thread/mutex.hpp>
+
+#include <atomic>
 
 #include <vector>
 #include <string>
@@ -13,43 +15,193 @@
 namespace graphite_proxy {
 namespace networking {
 
-/*! Network client to send messages to Graphite */
+/*! Address of a Graphite Server */
+struct Destination
+{
+  std::string host;     ///< Server address
+  std::string port;     ///< Server port
+  std::string instance; ///< Carbon instance name (may be empty), only used to place the server on the hash ring
+  Protocol    protocol = Protocol::PLAINTEXT; ///< Wire format of the messages sent to the server
+  Compression compression = Compression::NONE; ///< Compression of the stream sent to the server
+};
+
+/*! Network client to send messages to Graphite
+ *  Each destination has its own connection (and so its own queue and thread). With several destinations,
+ *  series are spread among them with a carbon compatible consistent hash ring, so a series always goes to the same server.
+ *  With a replication factor R, a series goes to the R first nodes following it on the ring (like carbon-relay does).
+ *  An unhealthy server is skipped: its series go to the next healthy nodes on the ring until it comes back.
+ *  \note only the first destination of a series reports failures to the completion handler. A copy which can't be written
+ *        to a replica is sent once to the next healthy node of the ring, and is only counted as lost if that fails too.
+ */
 class Client
 {
   public:
 
-    /*! Constructor
-     *  \param host is the address to reach the Graphite Server
-     *  \param port is the port to reach the Graphite Server
+    /*! Function called once messages have been written (sent is true) or have failed (sent is false)
+     *  \note it is called by a connection thread, so it must neither block nor call send()
+     *  \note with several destinations, it is called once for the messages of each destination
+     */
+    typedef Connection::completion_handler completion_handler;
+
+    /*! Constructor of a client to a single Graphite Server
+     *  \param host                is the address to reach the Graphite Server
+     *  \param port                is the port to reach the Graphite Server
+     *  \param reconnect_min_delay is the delay before connecting again after a failure (in milliseconds)
+     *  \param reconnect_max_delay is the maximum delay between two connection attempts (in milliseconds)
+     *  \param max_pending         is the maximum number of batches waiting to be written
+     *  \param health_check_interval is the delay between two health checks of the server (in milliseconds), 0 disables them
      */
-    Client( const std::string &host, const std::string &port );
+    Client( const std::string &host, const std::string &port,
+            unsigned long reconnect_min_delay   = CLIENT_DEFAULT_RECONNECT_MIN_DELAY,
+            unsigned long reconnect_max_delay   = CLIENT_DEFAULT_RECONNECT_MAX_DELAY,
+            size_t        max_pending           = CLIENT_DEFAULT_MAX_PENDING_BATCHES,
+            unsigned long health_check_interval = CLIENT_DEFAULT_HEALTH_CHECK_INTERVAL );
+
+    /*! Constructor of a client spreading the series among several Graphite Servers
+     *  \param destinations        are the Graphite Servers (at least one)
+     *  \param replication_factor  is the number of servers receiving each series (bounded by the number of destinations)
+     *  \param reconnect_min_delay is the delay before connecting again after a failure (in milliseconds)
+     *  \param reconnect_max_delay is the maximum delay between two connection attempts (in milliseconds)
+     *  \param max_pending         is the maximum number of batches waiting to be written to each server
+     *  \param health_check_interval is the delay between two health checks of each server (in milliseconds), 0 disables them
+     */
+    Client( const std::vector<Destination> &destinations,
+            size_t        replication_factor    = 1,
+            unsigned long reconnect_min_delay   = CLIENT_DEFAULT_RECONNECT_MIN_DELAY,
+            unsigned long reconnect_max_delay   = CLIENT_DEFAULT_RECONNECT_MAX_DELAY,
+            size_t        max_pending           = CLIENT_DEFAULT_MAX_PENDING_BATCHES,
+            unsigned long health_check_interval = CLIENT_DEFAULT_HEALTH_CHECK_INTERVAL );
+
+    /*! Destructor, stops the connections */
+    ~Client();
 
-    /*! Send given messages (and pending ones)
+    /*! Send given messages and wait for the result
      *  \param messages are some new messages to send
+     *  \return true if all messages have been written to their connection
+     *  \note with several destinations, false doesn't tell which part failed: use sendAsync to take back only the failed messages
      */
-    bool send( const std::vector<message_ptr> &messages );
+    bool send( const std::vector<Message> &messages );
+
+    /*! Queue given messages and return immediately
+     *  \param messages are the messages to send, they are moved into the queues on success
+     *  \param handler  is called with the messages once they have been written or have failed
+     *  \return false if the messages can't be queued, they are left untouched
+     *  \note with several destinations, the messages refused by a full queue are completed as failed
+     */
+    bool sendAsync( std::vector<Message> &messages, completion_handler handler );
+
+    /*! Configure the circuit breaker of each connection
+     *  \param max_failures is the number of consecutive failures with a server before it is not sent anything, 0 disables the circuit breaker
+     *  \param cooldown     is the time nothing is sent to the server (in milliseconds)
+     *  \note must be called before sending messages
+     */
+    void setCircuitBreaker( unsigned int max_failures, unsigned long cooldown );
+
+    /*! Configure the rate limit of each connection
+     *  \param messages_per_second is the maximum number of messages written per second to each server, 0 means no limit
+     *  \param bytes_per_second    is the maximum number of bytes written per second to each server, 0 means no limit
+     *  \param max_latency         is the write latency above which the rate of a server is lowered (in milliseconds), 0 keeps the rates fixed
+     *  \note must be called before sending messages
+     */
+    void setRateLimit( double messages_per_second, double bytes_per_second, unsigned long max_latency = CLIENT_DEFAULT_RATE_MAX_LATENCY );
+
+    /*! Stop the connections
+     *  \note the batches not written yet are completed as failed, the failed copies are not rerouted anymore
+     */
+    void stop();
 
     /*! Is the client ready to send messages
      *  \return true if the client is ready to send messages
      */
-    bool isReady() const { return m_ready; }
+    bool isReady() const;
+
+    /*! Is the client currently connected to all Graphite Servers
+     *  \return true if all connections are open
+     */
+    bool isConnected() const;
+
+    /*! Get the number of batches waiting to be written (usefull for statistics)
+     *  \return the number of batches waiting to be written to all servers
+     */
+    size_t getPendingBatches() const;
+
+    /*! Getter for the number of Graphite Servers
+     *  \return the number of destinations
+     */
+    size_t getNbrDestinations() const { return m_connections.size(); }
+
+    /*! Get the number of Graphite Servers currently healthy
+     *  \return the number of healthy destinations
+     */
+    size_t getNbrHealthyDestinations() const;
+
+    /*! Getter for the replication factor
+     *  \return the number of servers receiving each series
+     */
+    size_t getReplicationFactor() const { return m_replication_factor; }
+
+    /*! Find the Graphite Server of a series
+     *  \param series is the series ID
+     *  \return the index of the first destination of the series
+     */
+    size_t getDestination( series_id series ) const;
+
+    /*! Find the Graphite Servers of a series, skipping the unhealthy ones
+     *  \param series       is the series ID
+     *  \param destinations receives the indexes of the destinations of the series, the first one reports failures
+     *  \return true if the series doesn't go to its own first node because it is unhealthy
+     */
+    bool getDestinations( series_id series, std::vector<size_t> &destinations ) const;
+
+    /*! Parse a list of destinations
+     *  \param input        is a list of [protocol[+compression]://]host:port[:instance] separated by commas or spaces
+     *  \param destinations is a container for the parsed destinations
+     *  \param protocol     is the protocol of the destinations without one
+     *  \param compression  is the compression of the destinations without one
+     *  \return false if a destination is malformed
+     */
+    static bool parseDestinations( const std::string &input, std::vector<Destination> &destinations,
+                                   Protocol protocol = Protocol::PLAINTEXT, Compression compression = Compression::NONE );
 
   private:
 
-    /*! Input / Output service */
-    boost::asio::io_service                  m_io_service;
+    /*! Split messages according to their destinations
+     *  \param messages are the messages to split, they are moved into the parts
+     *  \param parts    receives the messages of each destination
+     *  \param replicas receives the copies of the messages sent to the other destinations of their series
+     */
+    void split( std::vector<Message> &messages, std::vector<std::vector<Message>> &parts, std::vector<std::vector<Message>> &replicas ) const;
+
+    /*! Queue the copies of the messages, the failed ones are rerouted
+     *  \param replicas are the copies to send to each destination
+     */
+    void sendReplicas( std::vector<std::vector<Message>> &replicas );
+
+    /*! Send the copies which couldn't be written to a replica to the next healthy node of their series, their failures are only counted
+     *  \param failed   is the index of the destination which failed
+     *  \param messages are the copies of the messages
+     *  \note called by the connection thread of the failed destination, it doesn't block
+     */
+    void rerouteReplicas( size_t failed, std::vector<Message> &messages );
+
+    /*! Find the healthy node taking the place of a failed replica of a series
+     *  \param series is the series ID
+     *  \param failed is the index of the destination which failed
+     *  \return the index of a healthy destination not holding the series yet, the number of destinations if there is none
+     */
+    size_t getSpareDestination( series_id series, size_t failed ) const;
 
-    /*! TCP iterator used by the socket */
-    boost::asio::ip::tcp::resolver::iterator m_tcp_iterator;
+    /*! Connection to each Graphite Server */
+    std::vector<connection_ptr> m_connections;
 
-    /*! Socket used to send messages */
-    boost::asio::ip::tcp::socket             m_socket;
+    /*! Position of the Graphite Servers on the ring */
+    HashRing                    m_ring;
 
-    /*! Is the client ready to send messages */
-    bool                                     m_ready;
+    /*! Number of servers receiving each series */
+    size_t                      m_replication_factor;
 
-    /*! Mutex for thread safe */
-    boost::mutex                             m_mutex;
+    /*! Has the client been stopped (read by the connection threads) */
+    std::atomic<bool>           m_stopped;
 };
 
 typedef boost::shared_ptr<Client> client_ptr;
@@ -0,0 +1,113 @@
+#include "compression.hpp"
+
+#include <cstring>
+
+namespace graphite_proxy {
+namespace networking {
+
+/*! Size of the chunks appended to the output while compressing or decompressing (in bytes) */
+static const size_t COMPRESSION_CHUNK_SIZE = 16384;
+
+Compressor::Compressor( int level )
+{
+  std::memset( &m_stream, 0, sizeof( m_stream ) );
+  deflateInit( &m_stream, level );
+}
+
+Compressor::~Compressor()
+{
+  deflateEnd( &m_stream );
+}
+
+bool Compressor::compress( const std::string &input, std::string &output )
+{
+  m_stream.next_in  = reinterpret_cast<Bytef*>( const_cast<char*>( input.data() ) );
+  m_stream.avail_in = static_cast<uInt>( input.size() );
+  return this->deflate( Z_NO_FLUSH, output );
+}
+
+bool Compressor::flush( std::string &output )
+{
+  m_stream.next_in  = Z_NULL;
+  m_stream.avail_in = 0;
+  return this->deflate( Z_SYNC_FLUSH, output );
+}
+
+void Compressor::reset()
+{
+  deflateReset( &m_stream );
+}
+
+bool Compressor::deflate( int flush, std::string &output )
+{
+  // Compress into the free space at the end of the output, growing it by chunks
+  do
+  {
+    const size_t previous_size = output.size();
+    output.resize( previous_size + COMPRESSION_CHUNK_SIZE );
+    m_stream.next_out  = reinterpret_cast<Bytef*>( &output[previous_size] );
+    m_stream.avail_out = COMPRESSION_CHUNK_SIZE;
+
+    const int result = ::deflate( &m_stream, flush );
+    output.resize( output.size() - m_stream.avail_out );
+    if( result != Z_OK && result != Z_BUF_ERROR )
+      return false;
+  }
+  while( m_stream.avail_out == 0 );
+
+  return m_stream.avail_in == 0;
+}
+
+bool Compressor::parse( const std::string &name, Compression &compression )
+{
+  if( name == "none" )
+    compression = Compression::NONE;
+  else if( name == "zlib" )
+    compression = Compression::ZLIB;
+  else return false;
+
+  return true;
+}
+
+std::string Compressor::toString( Compression compression )
+{
+  return ( compression == Compression::ZLIB ) ? "zlib" : "none";
+}
+
+Decompressor::Decompressor()
+{
+  std::memset( &m_stream, 0, sizeof( m_stream ) );
+  inflateInit( &m_stream );
+}
+
+Decompressor::~Decompressor()
+{
+  inflateEnd( &m_stream );
+}
+
+bool Decompressor::decompress( const char* input, size_t input_size, std::string &output )
+{
+  m_stream.next_in  = reinterpret_cast<Bytef*>( const_cast<char*>( input ) );
+  m_stream.avail_in = static_cast<uInt>( input_size );
+
+  do
+  {
+    const size_t previous_size = output.size();
+    output.resize( previous_size + COMPRESSION_CHUNK_SIZE );
+    m_stream.next_out  = reinterpret_cast<Bytef*>( &output[previous_size] );
+    m_stream.avail_out = COMPRESSION_CHUNK_SIZE;
+
+    const int result = inflate( &m_stream, Z_SYNC_FLUSH );
+    output.resize( output.size() - m_stream.avail_out );
+    if( result == Z_STREAM_END )
+      return true;
+    if( result != Z_OK && result != Z_BUF_ERROR )
+      return false;
+  }
+  while( m_stream.avail_out == 0 );
+
+  return true;
+}
+
+} // namespace networking
+} // namespace graphite_proxy
@@ -0,0 +1,113 @@
+#ifndef GRAPHITE_PROXY_COMPRESSION_HPP
+#define GRAPHITE_PROXY_COMPRESSION_HPP
+
+#include <zlib.h>
+
+#include <string>
+
+namespace graphite_proxy {
+namespace networking {
+
+/*! Compression of a stream between two proxies */
+enum class Compression
+{
+  NONE, ///< Data is sent as is
+  ZLIB  ///< Data is sent as a zlib stream, flushed after each write so the receiver never waits for more data
+};
+
+/*! Default compression level (fastest, metric names are repetitive enough to compress well anyway) */
+static const int COMPRESSION_DEFAULT_LEVEL = Z_BEST_SPEED;
+
+/*! Streaming compressor
+ *  The whole connection is one zlib stream: the dictionary is kept from one write to the other, so the names
+ *  sent again and again cost a few bytes each. A stream must be reset when a new connection starts.
+ */
+class Compressor
+{
+  public:
+
+    /*! Constructor
+     *  \param level is the zlib compression level (1 to 9)
+     */
+    explicit Compressor( int level = COMPRESSION_DEFAULT_LEVEL );
+
+    /*! Destructor, release the zlib stream */
+    ~Compressor();
+
+    Compressor( const Compressor& ) = delete;
+    Compressor& operator=( const Compressor& ) = delete;
+
+    /*! Compress data at the end of a string, the compressed data may be kept until the next flush
+     *  \param input  is the data to compress
+     *  \param output receives the compressed data
+     *  \return false if the stream is broken
+     */
+    bool compress( const std::string &input, std::string &output );
+
+    /*! Write all pending compressed data at the end of a string, so the receiver can decompress everything received
+     *  \param output receives the compressed data
+     *  \return false if the stream is broken
+     */
+    bool flush( std::string &output );
+
+    /*! Start a new stream */
+    void reset();
+
+    /*! Get a compression from its name
+     *  \param name        is the compression name ("none" or "zlib")
+     *  \param compression receives the compression
+     *  \return false if the name is unknown
+     */
+    static bool parse( const std::string &name, Compression &compression );
+
+    /*! Get the name of a compression
+     *  \param compression is the compression
+     *  \return the compression name
+     */
+    static std::string toString( Compression compression );
+
+  private:
+
+    /*! Run deflate until all input is consumed
+     *  \param flush  is the zlib flush mode
+     *  \param output receives the compressed data
+     *  \return false if the stream is broken
+     */
+    bool deflate( int flush, std::string &output );
+
+    /*! zlib stream state */
+    z_stream m_stream;
+};
+
+/*! Streaming decompressor, the counterpart of Compressor */
+class Decompressor
+{
+  public:
+
+    /*! Constructor */
+    Decompressor();
+
+    /*! Destructor, release the zlib stream */
+    ~Decompressor();
+
+    Decompressor( const Decompressor& ) = delete;
+    Decompressor& operator=( const Decompressor& ) = delete;
+
+    /*! Decompress data at the end of a string
+     *  \param input      is the compressed data
+     *  \param input_size is the size of the compressed data
+     *  \param output     receives the decompressed data
+     *  \return false if the data is not a valid stream
+     */
+    bool decompress( const char* input, size_t input_size, std::string &output );
+
+  private:
+
+    /*! zlib stream state */
+    z_stream m_stream;
+};
+
+} // namespace networking
+} // namespace graphite_proxy
+
+#endif // GRAPHITE_PROXY_COMPRESSION_HPP
@@ -0,0 +1,593 @@
+#include "connection.hpp"
+
+#include <graphite_proxy/models/statistics/statistics_metrics.hpp>
+#include <graphite_proxy/models/statistics/statistics.hpp>
+
+#include <graphite_proxy/utils/logging/logger.hpp>
+#include <graphite_proxy/utils/logging/log_headers.hpp>
+
+#include <boost/bind.hpp>
+
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <future>
+
+namespace graphite_proxy {
+namespace networking {
+
+/*! Maximum number of batches written with one gather write (far below IOV_MAX) */
+static const size_t CONNECTION_MAX_BATCHES_PER_WRITE = 64;
+
+/*! Maximum time to wait for the write in progress when the connection stops (in milliseconds) */
+static const long CONNECTION_STOP_TIMEOUT = 1000;
+
+/*! Maximum duration of a connection attempt (in milliseconds) */
+static const long CONNECTION_CONNECT_TIMEOUT = 5000;
+
+Connection::Connection( const std::string &host, const std::string &port, unsigned long reconnect_min_delay, unsigned long reconnect_max_delay, size_t max_pending, unsigned long health_check_interval, Protocol protocol, Compression compression )
+ : m_work( new boost::asio::io_service::work( m_io_service ) )
+ , m_socket( m_io_service )
+ , m_ready( false )
+ , m_connected( false )
+ , m_is_connecting( false )
+ , m_connect_timer( m_io_service )
+ , m_healthy( true )
+ , m_health_timer( m_io_service )
+ , m_health_check_interval( health_check_interval )
+ , m_was_connected( false )
+ , m_reconnect_min_delay( reconnect_min_delay )
+ , m_reconnect_max_delay( std::max( reconnect_min_delay, reconnect_max_delay ) )
+ , m_reconnect_delay( m_reconnect_min_delay )
+ , m_next_connection( std::chrono::steady_clock::now() )
+ , m_max_pending( max_pending > 0 ? max_pending : 1 )
+ , m_free_buffers_bytes( 0 )
+ , m_stopped( false )
+ , m_breaker_max_failures( CLIENT_DEFAULT_BREAKER_MAX_FAILURES )
+ , m_breaker_cooldown( CLIENT_DEFAULT_BREAKER_COOLDOWN )
+ , m_failures( 0 )
+ , m_breaker_open_until( 0 )
+ , m_name( host + ":" + port )
+ , m_protocol( protocol )
+ , m_compressor( ( compression == Compression::ZLIB ) ? new Compressor() : nullptr )
+ , m_pacing_timer( m_io_service )
+ , m_is_pacing( false )
+{
+  LOG_INFO( "Creating client to: " + m_name + " (" + encoder::toString( m_protocol ) + ", compression: " + Compressor::toString( compression ) + ")", utils::logging::LOG_HEADER_CLIENT );
+
+  try
+  {
+    boost::asio::ip::tcp::resolver resolver( m_io_service );
+    boost::asio::ip::tcp::resolver::query query( boost::asio::ip::tcp::v4(), host, port );
+    m_tcp_iterator = resolver.resolve( query );
+    m_ready = true;
+  }
+  catch (...)
+  {
+    LOG_ERROR( "Client to " + m_name + " could not start", utils::logging::LOG_HEADER_CLIENT );
+  }
+
+  m_free_buffers.reserve( CONNECTION_MAX_FREE_BUFFERS );
+
+  if( m_ready && m_health_check_interval.count() > 0 )
+    this->scheduleHealthCheck();
+
+  // The connection thread writes the batches
+  m_thread = boost::thread( [this]() { m_io_service.run(); } );
+}
+
+Connection::~Connection()
+{
+  this->stop();
+}
+
+void Connection::stop()
+{
+  {
+    boost::mutex::scoped_lock lock( m_mutex );
+    if( m_stopped )
+      return;
+    m_stopped = true;
+  }
+
+  // Let the write in progress complete, unless the server doesn't read anymore. A connection attempt is aborted.
+  m_io_service.post( [this]()
+  {
+    boost::system::error_code error;
+    m_health_timer.cancel( error );
+    m_pacing_timer.cancel( error );
+    if( m_is_connecting )
+      m_socket.close( error );
+  });
+  m_work.reset();
+  if( m_thread.joinable() && !m_thread.try_join_for( boost::chrono::milliseconds( CONNECTION_STOP_TIMEOUT ) ) )
+  {
+    LOG_WARNING( "Write to " + m_name + " still in progress, abort it", utils::logging::LOG_HEADER_CLIENT );
+    m_io_service.stop();
+    m_thread.join();
+  }
+
+  this->disconnect();
+
+  // Nothing will be written anymore
+  this->complete( false );
+
+  std::deque<Batch> pending;
+  {
+    boost::mutex::scoped_lock lock( m_mutex );
+    pending.swap( m_pending );
+  }
+
+  for( Batch &batch : pending )
+  {
+    if( batch.handler )
+      batch.handler( false, batch.messages );
+  }
+}
+
+void Connection::setCircuitBreaker( unsigned int max_failures, unsigned long cooldown )
+{
+  // The connection thread uses the settings, they are changed between two of its handlers
+  m_io_service.post( [this, max_failures, cooldown]()
+  {
+    m_breaker_max_failures = max_failures;
+    m_breaker_cooldown     = std::chrono::milliseconds( cooldown );
+  });
+}
+
+void Connection::setRateLimit( double messages_per_second, double bytes_per_second, unsigned long max_latency )
+{
+  // The connection thread uses the rate limiter, it is replaced between two of its handlers
+  const RateLimiter rate_limiter( messages_per_second, bytes_per_second, max_latency );
+  m_io_service.post( [this, rate_limiter]() { m_rate_limiter = rate_limiter; } );
+}
+
+size_t Connection::getPendingBatches() const
+{
+  boost::mutex::scoped_lock lock( m_mutex );
+  return m_pending.size();
+}
+
+size_t Connection::getFreeBuffers() const
+{
+  boost::mutex::scoped_lock lock( m_mutex );
+  return m_free_buffers.size();
+}
+
+size_t Connection::getFreeBuffersBytes() const
+{
+  boost::mutex::scoped_lock lock( m_mutex );
+  return m_free_buffers_bytes;
+}
+
+bool Connection::connect()
+{
+  if( m_connected || m_is_connecting )
+    return true;
+
+  // No connection is attempted while the circuit is open
+  if( this->isCircuitOpen() )
+    return false;
+
+  // Wait for the end of the reconnection delay
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if( now < m_next_connection )
+  {
+    LOG_DEBUG( "Waiting before connecting again", utils::logging::LOG_HEADER_CLIENT );
+    return false;
+  }
+
+  // Try to connect to the Graphite Server, without waiting longer than the timeout
+  m_is_connecting = true;
+  m_connect_timer.expires_from_now( std::chrono::milliseconds( CONNECTION_CONNECT_TIMEOUT ) );
+  m_connect_timer.async_wait( boost::bind( &Connection::handleConnectTimeout, this, boost::asio::placeholders::error ) );
+  boost::asio::async_connect( m_socket, m_tcp_iterator, boost::bind( &Connection::handleConnect, this, boost::asio::placeholders::error ) );
+  return true;
+}
+
+void Connection::handleConnectTimeout( const boost::system::error_code &error )
+{
+  if( error || !m_is_connecting )
+    return;
+
+  // Closing the socket aborts the connection attempt
+  LOG_WARNING( "Connection to " + m_name + " takes too long, abort it", utils::logging::LOG_HEADER_CLIENT );
+  boost::system::error_code close_error;
+  m_socket.close( close_error );
+}
+
+void Connection::handleConnect( const boost::system::error_code &error )
+{
+  m_is_connecting = false;
+  boost::system::error_code cancel_error;
+  m_connect_timer.cancel( cancel_error );
+
+  if( error )
+  {
+    {
+      boost::mutex::scoped_lock lock( m_mutex );
+      if( m_stopped )
+        return;
+    }
+
+    // One more failed connection attempt, wait longer before the next one
+    STATS_INCREMENT( stats::STATS_CLIENT_CONNECTIONFAILED );
+    LOG_ERROR( (error == boost::asio::error::connection_refused) ? "Connection refused by " + m_name : "Connection problem with " + m_name + ": " + error.message(), utils::logging::LOG_HEADER_CLIENT );
+
+    this->disconnect();
+    m_next_connection = std::chrono::steady_clock::now() + m_reconnect_delay;
+    m_reconnect_delay = std::min( m_reconnect_delay * 2, m_reconnect_max_delay );
+    this->fail();
+
+    // Give back the batches waiting for the connection and go on with the next ones
+    if( !m_writing.empty() )
+    {
+      this->complete( false );
+      m_io_service.post( boost::bind( &Connection::write, this ) );
+    }
+    return;
+  }
+
+  boost::system::error_code error_option;
+
+  // Detect a dead server even if nothing is sent for a while
+  m_socket.set_option( boost::asio::socket_base::keep_alive( true ), error_option );
+
+  if( m_was_connected )
+  {
+    STATS_INCREMENT( stats::STATS_CLIENT_RECONNECTED );
+    LOG_INFO( "Reconnected to " + m_name, utils::logging::LOG_HEADER_CLIENT );
+  }
+  else LOG_INFO( "Connected to " + m_name, utils::logging::LOG_HEADER_CLIENT );
+
+  // A new connection is a new compressed stream
+  if( m_compressor )
+    m_compressor->reset();
+
+  m_connected       = true;
+  m_healthy         = true;
+  m_was_connected   = true;
+  m_reconnect_delay = m_reconnect_min_delay;
+  this->succeed();
+
+  // Write the batches waiting for the connection
+  if( !m_writing.empty() )
+    this->writeBatches();
+}
+
+void Connection::fail()
+{
+  if( m_breaker_max_failures == 0 || ++m_failures < m_breaker_max_failures )
+    return;
+
+  // Stop trying for a while instead of failing each batch on its own
+  const bool was_open = m_failures > m_breaker_max_failures;
+  m_breaker_open_until = ( std::chrono::steady_clock::now() + m_breaker_cooldown ).time_since_epoch().count();
+  STATS_INCREMENT( stats::STATS_CLIENT_CIRCUIT_OPEN );
+  if( !was_open )
+    LOG_ERROR( std::to_string( m_failures ) + " consecutive failures with " + m_name + ", stop sending for " + std::to_string( m_breaker_cooldown.count() ) + " ms", utils::logging::LOG_HEADER_CLIENT );
+}
+
+void Connection::succeed()
+{
+  if( m_breaker_max_failures > 0 && m_failures >= m_breaker_max_failures )
+    LOG_INFO( "Sending to " + m_name + " again", utils::logging::LOG_HEADER_CLIENT );
+
+  m_failures = 0;
+}
+
+void Connection::disconnect()
+{
+  boost::system::error_code error;
+  m_socket.close( error );
+  m_connected = false;
+  m_healthy   = false;
+}
+
+bool Connection::isAlive()
+{
+  char byte;
+  const ssize_t received = ::recv( m_socket.native_handle(), &byte, 1, MSG_PEEK | MSG_DONTWAIT );
+  if( received > 0 )
+    return true;
+  if( received < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ) )
+    return true;
+
+  return false;
+}
+
+void Connection::scheduleHealthCheck()
+{
+  m_health_timer.expires_from_now( m_health_check_interval );
+  m_health_timer.async_wait( boost::bind( &Connection::checkHealth, this, boost::asio::placeholders::error ) );
+}
+
+void Connection::checkHealth( const boost::system::error_code &error )
+{
+  if( error )
+    return;
+
+  {
+    boost::mutex::scoped_lock lock( m_mutex );
+    if( m_stopped )
+      return;
+  }
+
+  // A write in progress checks the connection by itself
+  if( m_writing.empty() )
+  {
+    if( m_connected && !this->isAlive() )
+    {
+      STATS_INCREMENT( stats::STATS_CLIENT_CONNECTION_LOST );
+      LOG_WARNING( "Connection closed by " + m_name, utils::logging::LOG_HEADER_CLIENT );
+      this->disconnect();
+    }
+
+    // Only after a failure, so an unused server is not connected to
+    if( !m_connected && !m_healthy )
+      this->connect();
+  }
+
+  this->scheduleHealthCheck();
+}
+
+bool Connection::send( const std::vector<Message> &messages )
+{
+  if( messages.empty() )
+  {
+    LOG_DEBUG( "Nothing to send", utils::logging::LOG_HEADER_CLIENT );
+    return false;
+  }
+
+  // Queue a copy of the messages and wait for the connection thread to write them
+  std::promise<bool>   result;
+  std::future<bool>    sent = result.get_future();
+  std::vector<Message> messages_to_send( messages );
+
+  if( !this->sendAsync( messages_to_send, [&result]( bool is_sent, std::vector<Message>& ) { result.set_value( is_sent ); } ) )
+    return false;
+
+  return sent.get();
+}
+
+bool Connection::sendAsync( std::vector<Message> &messages, completion_handler handler )
+{
+  if( messages.empty() )
+  {
+    LOG_DEBUG( "Nothing to send", utils::logging::LOG_HEADER_CLIENT );
+    return false;
+  }
+  else if( !this->isReady() )
+  {
+    // Not ready to communicate with Graphite, abort
+    LOG_WARNING( "Not ready to send", utils::logging::LOG_HEADER_CLIENT );
+    return false;
+  }
+  else if( this->isCircuitOpen() )
+  {
+    // Too many failures, the messages are refused before being serialized
+    LOG_DEBUG( "Circuit open, not sending to " + m_name, utils::logging::LOG_HEADER_CLIENT );
+    return false;
+  }
+
+  // Build the message to send, out of the connection thread, into a buffer of a previous batch
+  Batch batch;
+  this->acquireBuffer( batch.content );
+  encoder::encode( m_protocol, messages, batch.content );
+
+  {
+    boost::mutex::scoped_lock lock( m_mutex );
+    if( m_stopped )
+      return false;
+
+    if( m_pending.size() >= m_max_pending )
+    {
+      this->recycleBuffer( batch.content );
+      STATS_INCREMENT( stats::STATS_CLIENT_QUEUE_FULL );
+      LOG_WARNING( "Too many messages waiting to be sent to " + m_name + ", retry later", utils::logging::LOG_HEADER_CLIENT );
+      return false;
+    }
+
+    batch.messages.swap( messages );
+    batch.handler = handler;
+    m_pending.push_back( std::move( batch ) );
+  }
+
+  m_io_service.post( boost::bind( &Connection::write, this ) );
+  return true;
+}
+
+void Connection::write()
+{
+  // A write is in progress or waits for the rate limit, the queued batches will be written later
+  if( !m_writing.empty() || m_is_pacing )
+    return;
+
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if( m_rate_limiter.isLimited() )
+  {
+    const std::chrono::microseconds delay = m_rate_limiter.delay( now );
+    if( delay.count() > 0 )
+    {
+      {
+        boost::mutex::scoped_lock lock( m_mutex );
+        if( m_pending.empty() || m_stopped )
+          return;
+      }
+
+      // Too much has been written lately, wait for the buckets to refill
+      STATS_INCREMENT( stats::STATS_CLIENT_RATE_PACED );
+      m_is_pacing = true;
+      m_pacing_timer.expires_from_now( delay );
+      m_pacing_timer.async_wait( boost::bind( &Connection::handlePacing, this, boost::asio::placeholders::error ) );
+      return;
+    }
+  }
+
+  {
+    boost::mutex::scoped_lock lock( m_mutex );
+
+    // The connection is stopping, the queued batches are not written
+    if( m_stopped )
+      return;
+
+    // With a rate limit, batches are taken until the buckets are empty (the last one may put them in debt)
+    while( !m_pending.empty() && m_writing.size() < CONNECTION_MAX_BATCHES_PER_WRITE
+           && ( m_writing.empty() || m_rate_limiter.delay( now ).count() == 0 ) )
+    {
+      m_rate_limiter.consume( m_pending.front().messages.size(), m_pending.front().content.size(), now );
+      m_writing.push_back( std::move( m_pending.front() ) );
+      m_pending.pop_front();
+    }
+  }
+
+  if( m_writing.empty() )
+    return;
+
+  // The server may have closed the connection since the last write
+  if( m_connected && !this->isAlive() )
+  {
+    STATS_INCREMENT( stats::STATS_CLIENT_CONNECTION_LOST );
+    LOG_WARNING( "Connection closed by " + m_name, utils::logging::LOG_HEADER_CLIENT );
+    this->disconnect();
+  }
+
+  if( m_connected )
+  {
+    this->writeBatches();
+  }
+  else if( !this->connect() )
+  {
+    // Give back the batches and go on with the next ones, they fail immediately until the reconnection delay is elapsed
+    this->complete( false );
+    m_io_service.post( boost::bind( &Connection::write, this ) );
+  }
+  // Otherwise the batches are written once connected (see handleConnect)
+}
+
+void Connection::writeBatches()
+{
+  // Write all batches with one gather write
+  std::vector<boost::asio::const_buffer> buffers;
+  buffers.reserve( m_writing.size() );
+  if( m_compressor )
+  {
+    // The batches are compressed together by the connection thread, then flushed so the receiver gets all of them
+    m_compressed.clear();
+    size_t input_size = 0;
+    bool   is_compressed = true;
+    for( const Batch &batch : m_writing )
+    {
+      is_compressed = is_compressed && m_compressor->compress( batch.content, m_compressed );
+      input_size   += batch.content.size();
+    }
+
+    if( !is_compressed || !m_compressor->flush( m_compressed ) )
+    {
+      LOG_ERROR( "Compression error, connection to " + m_name + " closed", utils::logging::LOG_HEADER_CLIENT );
+      this->disconnect();
+      this->complete( false );
+      m_io_service.post( boost::bind( &Connection::write, this ) );
+      return;
+    }
+
+    STATS_RAISE( stats::STATS_CLIENT_COMPRESSION_INPUT, input_size );
+    STATS_RAISE( stats::STATS_CLIENT_COMPRESSION_OUTPUT, m_compressed.size() );
+    buffers.push_back( boost::asio::buffer( m_compressed ) );
+  }
+  else
+  {
+    for( const Batch &batch : m_writing )
+      buffers.push_back( boost::asio::buffer( batch.content ) );
+  }
+
+  m_write_start = std::chrono::steady_clock::now();
+  boost::asio::async_write( m_socket, buffers, boost::bind( &Connection::handleWrite, this, boost::asio::placeholders::error ) );
+}
+
+void Connection::handlePacing( const boost::system::error_code &error )
+{
+  m_is_pacing = false;
+  if( !error )
+    this->write();
+}
+
+void Connection::handleWrite( const boost::system::error_code &error )
+{
+  if( error )
+  {
+    STATS_INCREMENT( stats::STATS_CLIENT_CONNECTION_LOST );
+    LOG_ERROR( "Connection lost with " + m_name + ": " + error.message(), utils::logging::LOG_HEADER_CLIENT );
+    this->disconnect();
+    this->fail();
+    this->complete( false );
+  }
+  else
+  {
+    size_t messages_count = 0;
+    for( const Batch &batch : m_writing )
+    {
+      messages_count += batch.messages.size();
+      if( m_protocol == Protocol::PLAINTEXT )
+        LOG_DEBUG( "Send content:\n" + batch.content, utils::logging::LOG_HEADER_CLIENT );
+    }
+
+    // A slow write means the server can't keep up, the rate limit follows it
+    if( m_rate_limiter.isLimited() )
+      m_rate_limiter.adapt( std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - m_write_start ) );
+
+    LOG_INFO( "Sending " + std::to_string(messages_count) + " messages to " + m_name, utils::logging::LOG_HEADER_CLIENT );
+    STATS_RAISE( stats::STATS_REQUESTS_SEND, m_writing.size() );
+    STATS_RAISE( stats::STATS_REQUESTS_SEND_CONTENT, messages_count );
+    this->complete( true );
+  }
+
+  // Write the batches queued meanwhile
+  this->write();
+}
+
+void Connection::complete( bool sent )
+{
+  for( Batch &batch : m_writing )
+  {
+    if( batch.handler )
+      batch.handler( sent, batch.messages );
+  }
+
+  {
+    boost::mutex::scoped_lock lock( m_mutex );
+    for( Batch &batch : m_writing )
+      this->recycleBuffer( batch.content );
+  }
+
+  m_writing.clear();
+}
+
+void Connection::acquireBuffer( std::string &buffer )
+{
+  boost::mutex::scoped_lock lock( m_mutex );
+  if( m_free_buffers.empty() )
+    return;
+
+  buffer.swap( m_free_buffers.back() );
+  m_free_buffers.pop_back();
+  m_free_buffers_bytes -= buffer.capacity();
+}
+
+void Connection::recycleBuffer( std::string &buffer )
+{
+  // The memory kept is bounded, so a burst or an unusual batch doesn't hold more than CONNECTION_MAX_FREE_BUFFERS_BYTES
+  if( m_free_buffers.size() >= CONNECTION_MAX_FREE_BUFFERS || m_free_buffers_bytes + buffer.capacity() > CONNECTION_MAX_FREE_BUFFERS_BYTES )
+    return;
+
+  // Only the content is cleared, the capacity is kept
+  buffer.clear();
+  m_free_buffers_bytes += buffer.capacity();
+  m_free_buffers.push_back( std::string() );
+  m_free_buffers.back().swap( buffer );
+}
+
+} // namespace networking
+} // namespace graphite proxy
+
@@ -0,0 +1,383 @@
+#ifndef GRAPHITE_PROXY_CONNECTION_HPP
+#define GRAPHITE_PROXY_CONNECTION_HPP
+
+#include <graphite_proxy/models/message.hpp>
+#include <graphite_proxy/networking/compression.hpp>
+#include <graphite_proxy/networking/encoder.hpp>
+#include <graphite_proxy/networking/rate_limiter.hpp>
+
+#include <boost/asio.hpp>
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <string>
+
+namespace graphite_proxy {
+namespace networking {
+
+/*! Default delay before the first reconnection attempt (in milliseconds) */
+static const unsigned long CLIENT_DEFAULT_RECONNECT_MIN_DELAY = 100;
+
+/*! Default maximum delay between two reconnection attempts (in milliseconds) */
+static const unsigned long CLIENT_DEFAULT_RECONNECT_MAX_DELAY = 30000;
+
+/*! Default maximum number of batches waiting to be written */
+static const size_t CLIENT_DEFAULT_MAX_PENDING_BATCHES = 1024;
+
+/*! Default delay between two health checks (in milliseconds) */
+static const unsigned long CLIENT_DEFAULT_HEALTH_CHECK_INTERVAL = 1000;
+
+/*! Default number of consecutive failures opening the circuit breaker */
+static const unsigned int CLIENT_DEFAULT_BREAKER_MAX_FAILURES = 5;
+
+/*! Default time the circuit breaker stays open (in milliseconds) */
+static const unsigned long CLIENT_DEFAULT_BREAKER_COOLDOWN = 10000;
+
+/*! Default write latency above which the server is considered as slow (in milliseconds) */
+static const unsigned long CLIENT_DEFAULT_RATE_MAX_LATENCY = 200;
+
+/*! Maximum number of serialization buffers kept for the next batches (two gather writes) */
+static const size_t CONNECTION_MAX_FREE_BUFFERS = 128;
+
+/*! Maximum capacity of all the serialization buffers kept for the next batches (in bytes), a buffer exceeding it is freed */
+static const size_t CONNECTION_MAX_FREE_BUFFERS_BYTES = 8 * 1024 * 1024;
+
+/*! Connection to one Graphite Server
+ *  Batches of messages are serialized by the calling thread and queued. The connection thread, running its own io_service,
+ *  writes all queued batches at once with a single gather write, so several batches are in flight while callers go on.
+ *  The connection is kept open between two writes, with TCP keepalive enabled. A connection closed by the server
+ *  is detected before writing and any write error closes it, the next write connects again.
+ *  The connection is opened asynchronously and an attempt lasting too long is aborted, so an unreachable server
+ *  never blocks the connection thread.
+ *  \note after a failed connection attempt, batches fail immediately until the reconnection delay is elapsed.
+ *        The delay doubles after each failure (bounded by the maximum delay) and is reset once connected.
+ *  \note the connection thread also checks the connection periodically, so a closed connection is detected and
+ *        a server coming back is reconnected even when nothing is sent to it.
+ *  \note with compression, all batches written at once are compressed by the connection thread into one flushed block
+ *        of a zlib stream lasting as long as the connection.
+ *  \note after several consecutive failures, the circuit breaker opens: batches are refused at once and no connection
+ *        is attempted until the cooldown is elapsed. The first failure after the cooldown opens it again.
+ *  \note the serialization buffers of the written batches are cleared and kept for the next batches, so a steady flow of
+ *        batches doesn't allocate memory anymore once the buffers have grown to the usual batch size.
+ *  \note with a rate limit, the connection thread paces the writes so the server never gets more than the allowed
+ *        messages and bytes per second, and lowers the rate while the writes are slow.
+ */
+class Connection
+{
+  public:
+
+    /*! Function called once a batch has been written (sent is true) or has failed (sent is false)
+     *  \note it is called by the connection thread, so it must neither block nor call send()
+     */
+    typedef boost::function<void ( bool sent, std::vector<Message> &messages )> completion_handler;
+
+    /*! Constructor
+     *  \param host                is the address to reach the Graphite Server
+     *  \param port                is the port to reach the Graphite Server
+     *  \param reconnect_min_delay is the delay before connecting again after a failure (in milliseconds)
+     *  \param reconnect_max_delay is the maximum delay between two connection attempts (in milliseconds)
+     *  \param max_pending         is the maximum number of batches waiting to be written
+     *  \param health_check_interval is the delay between two health checks (in milliseconds), 0 disables them
+     *  \param protocol            is the wire format of the messages
+     *  \param compression         is the compression of the stream
+     */
+    Connection( const std::string &host, const std::string &port,
+                unsigned long reconnect_min_delay   = CLIENT_DEFAULT_RECONNECT_MIN_DELAY,
+                unsigned long reconnect_max_delay   = CLIENT_DEFAULT_RECONNECT_MAX_DELAY,
+                size_t        max_pending           = CLIENT_DEFAULT_MAX_PENDING_BATCHES,
+                unsigned long health_check_interval = CLIENT_DEFAULT_HEALTH_CHECK_INTERVAL,
+                Protocol      protocol              = Protocol::PLAINTEXT,
+                Compression   compression           = Compression::NONE );
+
+    /*! Destructor, stop the connection thread */
+    ~Connection();
+
+    /*! Send given messages and wait for the result
+     *  \param messages are some new messages to send
+     *  \return true if the messages have been written to the connection
+     */
+    bool send( const std::vector<Message> &messages );
+
+    /*! Queue given messages and return immediately
+     *  \param messages are the messages to send, they are moved into the queue on success
+     *  \param handler  is called with the messages once they have been written or have failed
+     *  \return false if the messages can't be queued (the queue is full or the connection is not ready), they are left untouched
+     */
+    bool sendAsync( std::vector<Message> &messages, completion_handler handler );
+
+    /*! Configure the circuit breaker
+     *  \param max_failures is the number of consecutive failures opening the circuit, 0 disables the circuit breaker
+     *  \param cooldown     is the time the circuit stays open (in milliseconds)
+     *  \note it is applied by the connection thread, before the batches sent afterwards
+     */
+    void setCircuitBreaker( unsigned int max_failures, unsigned long cooldown );
+
+    /*! Configure the rate limit
+     *  \param messages_per_second is the maximum number of messages written per second, 0 means no limit
+     *  \param bytes_per_second    is the maximum number of bytes written per second (before compression), 0 means no limit
+     *  \param max_latency         is the write latency above which the rate is lowered (in milliseconds), 0 keeps the rate fixed
+     *  \note it is applied by the connection thread, before the batches sent afterwards
+     */
+    void setRateLimit( double messages_per_second, double bytes_per_second, unsigned long max_latency = CLIENT_DEFAULT_RATE_MAX_LATENCY );
+
+    /*! Stop the connection thread
+     *  \note the batches not written yet are completed as failed
+     */
+    void stop();
+
+    /*! Is the connection ready to send messages (the server address has been resolved)
+     *  \return true if the connection is ready to send messages
+     */
+    bool isReady() const { return m_ready; }
+
+    /*! Is the connection currently open
+     *  \return true if the connection is open
+     */
+    bool isConnected() const { return m_connected; }
+
+    /*! Is the server expected to take messages (the last connection attempt has not failed and the connection has not been lost)
+     *  \return true if the server is healthy
+     */
+    bool isHealthy() const { return m_healthy && !this->isCircuitOpen(); }
+
+    /*! Is the circuit breaker open (nothing is sent until the cooldown is elapsed)
+     *  \return true if the circuit is open
+     */
+    bool isCircuitOpen() const { return std::chrono::steady_clock::now().time_since_epoch().count() < m_breaker_open_until; }
+
+    /*! Get the number of batches waiting to be written (usefull for statistics)
+     *  \return the number of batches waiting to be written
+     */
+    size_t getPendingBatches() const;
+
+    /*! Get the number of serialization buffers kept for the next batches (usefull for statistics)
+     *  \return the number of buffers kept
+     */
+    size_t getFreeBuffers() const;
+
+    /*! Get the memory held by the serialization buffers kept for the next batches (usefull for statistics)
+     *  \return the capacity of the buffers kept (in bytes)
+     */
+    size_t getFreeBuffersBytes() const;
+
+    /*! Getter for the server address
+     *  \return the server address as host:port
+     */
+    const std::string& getName() const { return m_name; }
+
+    /*! Getter for the wire format
+     *  \return the protocol used to send the messages
+     */
+    Protocol getProtocol() const { return m_protocol; }
+
+  private:
+
+    /*! Messages queued together and their serialization */
+    struct Batch
+    {
+      std::vector<Message> messages;
+      std::string          content;
+      completion_handler   handler;
+    };
+
+    /*! Write all queued batches if no write is in progress
+     *  \note called by the connection thread
+     */
+    void write();
+
+    /*! Write the batches taken by write() with one gather write, the connection must be open
+     *  \note called by the connection thread
+     */
+    void writeBatches();
+
+    /*! Completion of a gather write
+     *  \param error is the result of the write
+     *  \note called by the connection thread
+     */
+    void handleWrite( const boost::system::error_code &error );
+
+    /*! Call the completion handler of the batches being written
+     *  \param sent is true if the batches have been written
+     */
+    void complete( bool sent );
+
+    /*! Take a serialization buffer kept from a previous batch
+     *  \param buffer receives an empty buffer, with the capacity of the previous batch if there is one
+     */
+    void acquireBuffer( std::string &buffer );
+
+    /*! Keep a serialization buffer for a next batch
+     *  \param buffer is the buffer to keep, it is left empty
+     *  \note the mutex must be locked
+     */
+    void recycleBuffer( std::string &buffer );
+
+    /*! Start opening the connection if needed
+     *  \return true if the connection is open or being opened, false if no attempt can be made yet
+     *  \note called by the connection thread, the batches being written are written once the connection is open
+     */
+    bool connect();
+
+    /*! Completion of a connection attempt
+     *  \param error is the result of the attempt
+     *  \note called by the connection thread
+     */
+    void handleConnect( const boost::system::error_code &error );
+
+    /*! Abort a connection attempt lasting too long
+     *  \param error is the result of the wait
+     *  \note called by the connection thread
+     */
+    void handleConnectTimeout( const boost::system::error_code &error );
+
+    /*! Close the connection, the next write will connect again */
+    void disconnect();
+
+    /*! Check that the server has not closed the connection (it never sends anything, so a readable socket means it is closed)
+     *  \return true if the connection is still usable
+     */
+    bool isAlive();
+
+    /*! Count a failed connection attempt or write, open the circuit after too many consecutive ones */
+    void fail();
+
+    /*! Count a successful connection attempt or write, the circuit is closed */
+    void succeed();
+
+    /*! Schedule the next health check */
+    void scheduleHealthCheck();
+
+    /*! Check that the connection is still open, or try to open it again once the reconnection delay is elapsed
+     *  \param error is the result of the wait
+     *  \note called by the connection thread
+     */
+    void checkHealth( const boost::system::error_code &error );
+
+    /*! Write the queued batches once the rate limit allows it
+     *  \param error is the result of the wait
+     *  \note called by the connection thread
+     */
+    void handlePacing( const boost::system::error_code &error );
+
+    /*! Input / Output service of the connection thread */
+    boost::asio::io_service                  m_io_service;
+
+    /*! Keep the connection thread running while there is nothing to write */
+    boost::scoped_ptr<boost::asio::io_service::work> m_work;
+
+    /*! Thread writing the batches */
+    boost::thread                            m_thread;
+
+    /*! TCP iterator used by the socket */
+    boost::asio::ip::tcp::resolver::iterator m_tcp_iterator;
+
+    /*! Socket used to send messages */
+    boost::asio::ip::tcp::socket             m_socket;
+
+    /*! Is the connection ready to send messages */
+    bool                                     m_ready;
+
+    /*! Is the connection open (read by other threads) */
+    std::atomic<bool>                        m_connected;
+
+    /*! Is a connection attempt in progress (only used by the connection thread) */
+    bool                                     m_is_connecting;
+
+    /*! Timer aborting a connection attempt lasting too long */
+    boost::asio::steady_timer                m_connect_timer;
+
+    /*! Is the server healthy (read by other threads) */
+    std::atomic<bool>                        m_healthy;
+
+    /*! Timer of the health checks */
+    boost::asio::steady_timer                m_health_timer;
+
+    /*! Delay between two health checks */
+    const std::chrono::milliseconds          m_health_check_interval;
+
+    /*! Has the connection already been opened (a new connection is then a reconnection) */
+    bool                                     m_was_connected;
+
+    /*! Delay before the first reconnection attempt */
+    const std::chrono::milliseconds          m_reconnect_min_delay;
+
+    /*! Maximum delay between two reconnection attempts */
+    const std::chrono::milliseconds          m_reconnect_max_delay;
+
+    /*! Current delay between two reconnection attempts */
+    std::chrono::milliseconds                m_reconnect_delay;
+
+    /*! No connection is attempted before this time */
+    std::chrono::steady_clock::time_point    m_next_connection;
+
+    /*! Maximum number of batches waiting to be written */
+    const size_t                             m_max_pending;
+
+    /*! Batches waiting to be written */
+    std::deque<Batch>                        m_pending;
+
+    /*! Batches being written (only used by the connection thread) */
+    std::vector<Batch>                       m_writing;
+
+    /*! Empty serialization buffers kept for the next batches */
+    std::vector<std::string>                 m_free_buffers;
+
+    /*! Capacity of the buffers kept (in bytes) */
+    size_t                                   m_free_buffers_bytes;
+
+    /*! Is the connection stopped */
+    bool                                     m_stopped;
+
+    /*! Mutex for thread safety of the pending batches */
+    mutable boost::mutex                     m_mutex;
+
+    /*! Number of consecutive failures opening the circuit, 0 if there is no circuit breaker (only used by the connection thread) */
+    unsigned int                             m_breaker_max_failures;
+
+    /*! Time the circuit stays open (only used by the connection thread) */
+    std::chrono::milliseconds                m_breaker_cooldown;
+
+    /*! Number of consecutive failures (only used by the connection thread) */
+    unsigned int                             m_failures;
+
+    /*! The circuit is open until this time (steady clock ticks, read by other threads) */
+    std::atomic<std::chrono::steady_clock::rep> m_breaker_open_until;
+
+    /*! Server address as host:port (for logs) */
+    const std::string                        m_name;
+
+    /*! Wire format of the messages */
+    const Protocol                           m_protocol;
+
+    /*! Compressor of the stream (null without compression, only used by the connection thread) */
+    boost::scoped_ptr<Compressor>            m_compressor;
+
+    /*! Compressed batches being written */
+    std::string                              m_compressed;
+
+    /*! Rate limit of the writes (only used by the connection thread) */
+    RateLimiter                              m_rate_limiter;
+
+    /*! Timer delaying the writes exceeding the rate limit */
+    boost::asio::steady_timer                m_pacing_timer;
+
+    /*! Is a write waiting for the pacing timer */
+    bool                                     m_is_pacing;
+
+    /*! Start time of the write in progress */
+    std::chrono::steady_clock::time_point    m_write_start;
+};
+
+typedef boost::shared_ptr<Connection> connection_ptr;
+
+} // namespace networking
+} // namespace graphite proxy
+
+#endif // GRAPHITE_PROXY_CONNECTION_HPP
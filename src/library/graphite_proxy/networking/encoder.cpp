@@ -0,0 +1,153 @@
+#include "encoder.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace graphite_proxy {
+namespace networking {
+namespace encoder {
+
+namespace {
+
+// Pickle opcodes used by the encoder (see python Lib/pickle.py)
+const char PICKLE_PROTO      = '\x80';
+const char PICKLE_EMPTY_LIST = ']';
+const char PICKLE_MARK       = '(';
+const char PICKLE_APPENDS    = 'e';
+const char PICKLE_BINUNICODE = 'X';
+const char PICKLE_BININT     = 'J';
+const char PICKLE_LONG1      = '\x8a';
+const char PICKLE_BINFLOAT   = 'G';
+const char PICKLE_TUPLE2     = '\x86';
+const char PICKLE_STOP       = '.';
+
+/*! Append an unsigned integer, least significant byte first */
+void appendLittleEndian( std::string &output, uint64_t value, size_t nbr_bytes )
+{
+  for( size_t i = 0; i < nbr_bytes; i++ )
+    output.push_back( static_cast<char>( ( value >> ( 8 * i ) ) & 0xFF ) );
+}
+
+/*! Append an unsigned integer, most significant byte first */
+void appendBigEndian( std::string &output, uint64_t value, size_t nbr_bytes )
+{
+  for( size_t i = nbr_bytes; i > 0; i-- )
+    output.push_back( static_cast<char>( ( value >> ( 8 * ( i - 1 ) ) ) & 0xFF ) );
+}
+
+/*! Append a timestamp as a python int */
+void appendInteger( std::string &output, unsigned long value )
+{
+  if( value <= 0x7FFFFFFF )
+  {
+    output.push_back( PICKLE_BININT );
+    appendLittleEndian( output, value, 4 );
+    return;
+  }
+
+  // Two's complement on the smallest number of bytes keeping the sign positive
+  size_t nbr_bytes = 1;
+  while( nbr_bytes < 8 && ( value >> ( 8 * nbr_bytes - 1 ) ) != 0 )
+    nbr_bytes++;
+  if( ( value >> ( 8 * nbr_bytes - 1 ) ) != 0 )
+    nbr_bytes++;
+
+  output.push_back( PICKLE_LONG1 );
+  output.push_back( static_cast<char>( nbr_bytes ) );
+  appendLittleEndian( output, value, std::min<size_t>( nbr_bytes, 8 ) );
+  if( nbr_bytes > 8 )
+    output.push_back( '\0' );
+}
+
+/*! Append one pickle payload with its length */
+void appendPickle( std::vector<Message>::const_iterator begin, std::vector<Message>::const_iterator end, std::string &output )
+{
+  // The length is only known at the end
+  const size_t header = output.size();
+  output.append( 4, '\0' );
+
+  output.push_back( PICKLE_PROTO );
+  output.push_back( '\x02' );
+  output.push_back( PICKLE_EMPTY_LIST );
+  output.push_back( PICKLE_MARK );
+
+  for( ; begin != end; ++begin )
+  {
+    if( !begin->isValid() )
+      continue;
+
+    const std::string &name = begin->getType();
+    output.push_back( PICKLE_BINUNICODE );
+    appendLittleEndian( output, name.size(), 4 );
+    output.append( name );
+
+    appendInteger( output, begin->getTimestamp() );
+
+    const double value = begin->getValue();
+    uint64_t     bits;
+    std::memcpy( &bits, &value, sizeof( bits ) );
+    output.push_back( PICKLE_BINFLOAT );
+    appendBigEndian( output, bits, 8 );
+
+    output.push_back( PICKLE_TUPLE2 ); // (timestamp, value)
+    output.push_back( PICKLE_TUPLE2 ); // (name, (timestamp, value))
+  }
+
+  output.push_back( PICKLE_APPENDS );
+  output.push_back( PICKLE_STOP );
+
+  const uint32_t length = static_cast<uint32_t>( output.size() - header - 4 );
+  for( size_t i = 0; i < 4; i++ )
+    output[header + i] = static_cast<char>( ( length >> ( 8 * ( 3 - i ) ) ) & 0xFF );
+}
+
+} // namespace
+
+bool parseProtocol( const std::string &name, Protocol &protocol )
+{
+  if( name == "plaintext" || name == "line" )
+    protocol = Protocol::PLAINTEXT;
+  else if( name == "pickle" )
+    protocol = Protocol::PICKLE;
+  else return false;
+
+  return true;
+}
+
+std::string toString( Protocol protocol )
+{
+  return ( protocol == Protocol::PICKLE ) ? "pickle" : "plaintext";
+}
+
+void encode( Protocol protocol, const std::vector<Message> &messages, std::string &output )
+{
+  if( protocol == Protocol::PICKLE )
+    encodePickle( messages, output );
+  else encodePlaintext( messages, output );
+}
+
+void encodePlaintext( const std::vector<Message> &messages, std::string &output )
+{
+  output.reserve( output.size() + messages.size() * 64 );
+  for( const Message &message : messages )
+  {
+    message.appendTo( output );
+    output.push_back( '\n' );
+  }
+}
+
+void encodePickle( const std::vector<Message> &messages, std::string &output )
+{
+  output.reserve( output.size() + messages.size() * 48 );
+  for( auto begin = messages.begin(); begin != messages.end(); )
+  {
+    const auto end = begin + std::min<size_t>( PICKLE_MAX_MESSAGES_PER_PAYLOAD, messages.end() - begin );
+    appendPickle( begin, end, output );
+    begin = end;
+  }
+}
+
+} // namespace encoder
+} // namespace networking
+} // namespace graphite_proxy
@@ -0,0 +1,61 @@
+#ifndef GRAPHITE_PROXY_ENCODER_HPP
+#define GRAPHITE_PROXY_ENCODER_HPP
+
+#include <graphite_proxy/models/message.hpp>
+
+#include <string>
+#include <vector>
+
+namespace graphite_proxy {
+namespace networking {
+
+/*! Wire format of the messages sent to a Graphite Server */
+enum class Protocol
+{
+  PLAINTEXT, ///< One "name value timestamp" line per message (carbon line receiver)
+  PICKLE     ///< Length prefixed pickled lists of (name, (timestamp, value)) tuples (carbon pickle receiver)
+};
+
+namespace encoder {
+
+/*! Maximum number of messages into one pickle payload (carbon MAX_DATAPOINTS_PER_MESSAGE default) */
+static const size_t PICKLE_MAX_MESSAGES_PER_PAYLOAD = 500;
+
+/*! Get a protocol from its name
+ *  \param name     is the protocol name ("plaintext" or "pickle")
+ *  \param protocol receives the protocol
+ *  \return false if the name is unknown
+ */
+bool parseProtocol( const std::string &name, Protocol &protocol );
+
+/*! Get the name of a protocol
+ *  \param protocol is the protocol
+ *  \return the protocol name
+ */
+std::string toString( Protocol protocol );
+
+/*! Encode messages at the end of a string
+ *  \param protocol is the wire format
+ *  \param messages are the messages to encode
+ *  \param output   receives the encoded messages
+ */
+void encode( Protocol protocol, const std::vector<Message> &messages, std::string &output );
+
+/*! Encode messages as plaintext lines at the end of a string
+ *  \param messages are the messages to encode
+ *  \param output   receives the lines
+ */
+void encodePlaintext( const std::vector<Message> &messages, std::string &output );
+
+/*! Encode messages as pickle payloads (protocol 2) at the end of a string
+ *  \param messages are the messages to encode
+ *  \param output   receives the payloads, each one preceded by its length (4 bytes, big endian)
+ *  \note messages are split into payloads of at most PICKLE_MAX_MESSAGES_PER_PAYLOAD messages, so carbon never refuses them
+ */
+void encodePickle( const std::vector<Message> &messages, std::string &output );
+
+} // namespace encoder
+} // namespace networking
+} // namespace graphite_proxy
+
+#endif // GRAPHITE_PROXY_ENCODER_HPP
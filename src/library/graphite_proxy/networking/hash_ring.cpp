@@ -0,0 +1,89 @@
+#include "hash_ring.hpp"
+
+#include <boost/uuid/detail/md5.hpp>
+
+#include <algorithm>
+
+namespace graphite_proxy {
+namespace networking {
+
+HashRing::HashRing( unsigned int replicas )
+  : m_replicas( replicas > 0 ? replicas : 1 )
+  , m_nbr_nodes( 0 )
+{
+  // Nothing
+}
+
+unsigned int HashRing::position( std::string_view key )
+{
+  boost::uuids::detail::md5 hash;
+  boost::uuids::detail::md5::digest_type digest;
+  hash.process_bytes( key.data(), key.size() );
+  hash.get_digest( digest );
+
+  // The first word holds the first 4 hexadecimal digits of the digest in its most significant bits
+  return ( digest[0] >> 16 ) & 0xFFFF;
+}
+
+void HashRing::addNode( const std::string &server, const std::string &instance, size_t node )
+{
+  // Same key as carbon: the string representation of the python tuple (server, instance)
+  const std::string node_key = "('" + server + "', " + ( instance.empty() ? std::string( "None" ) : "'" + instance + "'" ) + ")";
+
+  for( unsigned int i = 0; i < m_replicas; i++ )
+  {
+    unsigned int position = HashRing::position( node_key + ":" + std::to_string( i ) );
+
+    // A position is never shared, the next free one is taken
+    auto it = std::lower_bound( m_ring.begin(), m_ring.end(), std::make_pair( position, size_t(0) ) );
+    while( it != m_ring.end() && it->first == position )
+    {
+      position++;
+      ++it;
+    }
+
+    m_ring.insert( it, std::make_pair( position, node ) );
+  }
+
+  m_nbr_nodes++;
+}
+
+size_t HashRing::getNode( std::string_view metric ) const
+{
+  if( m_ring.empty() )
+    return 0;
+
+  return m_ring[this->find( metric )].second;
+}
+
+void HashRing::getNodes( std::string_view metric, size_t max_nodes, std::vector<size_t> &nodes ) const
+{
+  if( m_ring.empty() )
+    return;
+
+  // Walk the ring from the metric position, each node is only taken once
+  const size_t nbr_nodes = std::min( max_nodes, m_nbr_nodes );
+  const size_t first     = nodes.size();
+  size_t       index     = this->find( metric );
+  for( size_t i = 0; i < m_ring.size() && nodes.size() - first < nbr_nodes; i++ )
+  {
+    const size_t node = m_ring[index].second;
+    if( std::find( nodes.begin() + first, nodes.end(), node ) == nodes.end() )
+      nodes.push_back( node );
+
+    index = ( index + 1 < m_ring.size() ) ? index + 1 : 0;
+  }
+}
+
+size_t HashRing::find( std::string_view metric ) const
+{
+  // First node position after the metric position, the ring wraps around
+  const unsigned int position = HashRing::position( metric );
+  auto it = std::lower_bound( m_ring.begin(), m_ring.end(), position,
+                              []( const std::pair<unsigned int, size_t> &entry, unsigned int value ) { return entry.first < value; } );
+
+  return ( it != m_ring.end() ) ? it - m_ring.begin() : 0;
+}
+
+} // namespace networking
+} // namespace graphite_proxy
@@ -0,0 +1,85 @@
+#ifndef GRAPHITE_PROXY_HASH_RING_HPP
+#define GRAPHITE_PROXY_HASH_RING_HPP
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace graphite_proxy {
+namespace networking {
+
+/*! Number of positions of each node on the ring (carbon default) */
+static const unsigned int HASH_RING_DEFAULT_REPLICAS = 100;
+
+/*! Consistent hash ring compatible with the carbon relay one (carbon_ch hash type)
+ *  Each node is placed at several positions computed from the MD5 of its key, a metric belongs to the first node
+ *  following the position of its own name. So a metric always goes to the node carbon-relay would choose.
+ */
+class HashRing
+{
+  public:
+
+    /*! Constructor
+     *  \param replicas is the number of positions of each node on the ring
+     */
+    explicit HashRing( unsigned int replicas = HASH_RING_DEFAULT_REPLICAS );
+
+    /*! Add a node on the ring
+     *  \param server   is the node server (host), as written in the carbon destinations
+     *  \param instance is the node instance name, empty if there is none
+     *  \param node     is the value returned by getNode() for the metrics of this node
+     */
+    void addNode( const std::string &server, const std::string &instance, size_t node );
+
+    /*! Find the node of a metric
+     *  \param metric is the metric name
+     *  \return the node of the metric, 0 if the ring is empty
+     */
+    size_t getNode( std::string_view metric ) const;
+
+    /*! Find the nodes of a metric, in the order carbon uses them for replication
+     *  \param metric    is the metric name
+     *  \param max_nodes is the maximum number of nodes to find
+     *  \param nodes     receives the distinct nodes following the metric position on the ring
+     */
+    void getNodes( std::string_view metric, size_t max_nodes, std::vector<size_t> &nodes ) const;
+
+    /*! Get the number of distinct nodes on the ring
+     *  \return the number of nodes
+     */
+    size_t getNbrNodes() const { return m_nbr_nodes; }
+
+    /*! Get the number of positions on the ring
+     *  \return the number of positions
+     */
+    size_t size() const { return m_ring.size(); }
+
+    /*! Compute the position of a key on the ring (the 16 first bits of its MD5)
+     *  \param key is the key to place on the ring
+     *  \return the position of the key
+     */
+    static unsigned int position( std::string_view key );
+
+  private:
+
+    /*! Find the first position of a metric
+     *  \param metric is the metric name
+     *  \return the index of the first position following the metric position (wrapping around)
+     */
+    size_t find( std::string_view metric ) const;
+
+    /*! Number of positions of each node */
+    const unsigned int                          m_replicas;
+
+    /*! Positions of the nodes, sorted by position */
+    std::vector<std::pair<unsigned int, size_t>> m_ring;
+
+    /*! Number of distinct nodes */
+    size_t                                      m_nbr_nodes;
+};
+
+} // namespace networking
+} // namespace graphite_proxy
+
+#endif // GRAPHITE_PROXY_HASH_RING_HPP
@@ -0,0 +1,71 @@
+#include "rate_limiter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace graphite_proxy {
+namespace networking {
+
+RateLimiter::RateLimiter( double messages_per_second, double bytes_per_second, unsigned long max_latency )
+  : m_messages_rate( std::max( messages_per_second, 0.0 ) )
+  , m_bytes_rate( std::max( bytes_per_second, 0.0 ) )
+  , m_max_latency( std::chrono::milliseconds( max_latency ) )
+  , m_factor( 1 )
+  , m_messages_tokens( m_messages_rate * RATE_LIMITER_BURST / 1000 )
+  , m_bytes_tokens( m_bytes_rate * RATE_LIMITER_BURST / 1000 )
+  , m_last_refill( std::chrono::steady_clock::now() )
+{
+  // Nothing
+}
+
+std::chrono::microseconds RateLimiter::delay( time_point now )
+{
+  this->refill( now );
+
+  // Time to pay back the debt of the most indebted bucket
+  double seconds = 0;
+  if( m_messages_rate > 0 && m_messages_tokens < 0 )
+    seconds = std::max( seconds, -m_messages_tokens / ( m_messages_rate * m_factor ) );
+  if( m_bytes_rate > 0 && m_bytes_tokens < 0 )
+    seconds = std::max( seconds, -m_bytes_tokens / ( m_bytes_rate * m_factor ) );
+
+  return std::chrono::microseconds( static_cast<long>( std::ceil( seconds * 1000000 ) ) );
+}
+
+void RateLimiter::consume( size_t messages, size_t bytes, time_point now )
+{
+  this->refill( now );
+
+  if( m_messages_rate > 0 )
+    m_messages_tokens -= messages;
+  if( m_bytes_rate > 0 )
+    m_bytes_tokens -= bytes;
+}
+
+void RateLimiter::adapt( std::chrono::microseconds latency )
+{
+  if( m_max_latency.count() == 0 || !this->isLimited() )
+    return;
+
+  // Back off quickly when the server is slow, come back slowly
+  if( latency > m_max_latency )
+    m_factor = std::max( m_factor / 2, RATE_LIMITER_MIN_FACTOR );
+  else m_factor = std::min( m_factor + RATE_LIMITER_RECOVERY, 1.0 );
+}
+
+void RateLimiter::refill( time_point now )
+{
+  if( now <= m_last_refill )
+    return;
+
+  const double seconds = std::chrono::duration<double>( now - m_last_refill ).count();
+  m_last_refill = now;
+
+  // The buckets never hold more than the burst
+  const double burst = m_factor * RATE_LIMITER_BURST / 1000;
+  m_messages_tokens = std::min( m_messages_tokens + seconds * m_messages_rate * m_factor, m_messages_rate * burst );
+  m_bytes_tokens    = std::min( m_bytes_tokens + seconds * m_bytes_rate * m_factor, m_bytes_rate * burst );
+}
+
+} // namespace networking
+} // namespace graphite_proxy
@@ -0,0 +1,98 @@
+#ifndef GRAPHITE_PROXY_RATE_LIMITER_HPP
+#define GRAPHITE_PROXY_RATE_LIMITER_HPP
+
+#include <chrono>
+#include <cstddef>
+
+namespace graphite_proxy {
+namespace networking {
+
+/*! Time worth of tokens a bucket can hold, so writes are at most this much ahead of the rate (in milliseconds) */
+static const long RATE_LIMITER_BURST = 100;
+
+/*! Lowest fraction of the configured rates kept when the server is slow */
+static const double RATE_LIMITER_MIN_FACTOR = 0.1;
+
+/*! Fraction of the configured rates given back after each fast write */
+static const double RATE_LIMITER_RECOVERY = 0.05;
+
+/*! Token buckets limiting the messages and the bytes written to a server
+ *  A write is allowed as soon as both buckets are not in debt, then its cost is taken even if the buckets go
+ *  into debt: a big batch is never refused, it only delays the next ones.
+ *  The rates adapt to the server: they are halved each time a write is slower than the maximum latency,
+ *  and slowly increased back to the configured rates while writes are fast.
+ */
+class RateLimiter
+{
+  public:
+
+    typedef std::chrono::steady_clock::time_point time_point;
+
+    /*! Constructor
+     *  \param messages_per_second is the maximum number of messages written per second, 0 means no limit
+     *  \param bytes_per_second    is the maximum number of bytes written per second, 0 means no limit
+     *  \param max_latency         is the write latency above which the server is considered as slow (in milliseconds), 0 disables the adaptation
+     */
+    RateLimiter( double messages_per_second = 0, double bytes_per_second = 0, unsigned long max_latency = 0 );
+
+    /*! Is there any limit
+     *  \return true if writes are limited
+     */
+    bool isLimited() const { return m_messages_rate > 0 || m_bytes_rate > 0; }
+
+    /*! Get the time to wait before the next write
+     *  \param now is the current time
+     *  \return 0 if a write is allowed now
+     */
+    std::chrono::microseconds delay( time_point now );
+
+    /*! Take the cost of a write
+     *  \param messages is the number of written messages
+     *  \param bytes    is the number of written bytes
+     *  \param now      is the current time
+     */
+    void consume( size_t messages, size_t bytes, time_point now );
+
+    /*! Adapt the rates to the latency of a write
+     *  \param latency is the time the write took
+     */
+    void adapt( std::chrono::microseconds latency );
+
+    /*! Get the fraction of the configured rates currently used
+     *  \return the current factor, between RATE_LIMITER_MIN_FACTOR and 1
+     */
+    double getFactor() const { return m_factor; }
+
+  private:
+
+    /*! Add the tokens earned since the last refill
+     *  \param now is the current time
+     */
+    void refill( time_point now );
+
+    /*! Configured number of messages per second (0 if not limited) */
+    double                          m_messages_rate;
+
+    /*! Configured number of bytes per second (0 if not limited) */
+    double                          m_bytes_rate;
+
+    /*! Latency above which the rates are decreased */
+    std::chrono::microseconds       m_max_latency;
+
+    /*! Fraction of the configured rates currently used */
+    double                          m_factor;
+
+    /*! Messages which can be written now (negative when in debt) */
+    double                          m_messages_tokens;
+
+    /*! Bytes which can be written now (negative when in debt) */
+    double                          m_bytes_tokens;
+
+    /*! Time of the last refill */
+    time_point                      m_last_refill;
+};
+
+} // namespace networking
+} // namespace graphite_proxy
+
+#endif // GRAPHITE_PROXY_RATE_LIMITER_HPP
@@ -7,6 +7,7 @@ Iterations::Iterations( ulong sleep_time, const std::string &name )
   , m_name( name )
   , m_started( false )
   , m_valid( true )
+  , m_woken( false )
 {
 
 }
@@ -54,9 +55,26 @@ void Iterations::launch()
 {
   while (m_started)
   {
-    boost::this_thread::sleep( boost::posix_time::seconds( m_sleep_time ) ); // Sleep for the requested time
+    // Sleep for the requested time, unless woken up meanwhile (the wait is an interruption point for stop())
+    const long sleep_time = this->getNextSleep();
+    {
+      boost::mutex::scoped_lock lock( m_wake_mutex );
+      m_wake_condition.timed_wait( lock, boost::posix_time::milliseconds( sleep_time ), [this]() { return m_woken; } );
+      m_woken = false;
+    }
+
     this->iteration(); // Wake up, do what you have to do, and sleep again!
   }
 }
 
+void Iterations::wake()
+{
+  {
+    boost::mutex::scoped_lock lock( m_wake_mutex );
+    m_woken = true;
+  }
+
+  m_wake_condition.notify_one();
+}
+
 } // namespace graphite_proxy
@@ -52,11 +52,21 @@ class Iterations : public boost::enable_shared_from_this<Iterations>
      */
     void iterate() { this->iteration(); }
 
+    /*! Wake the timer up before the end of its sleep, the next iteration starts at once
+     *  \note may be called from any thread
+     */
+    void wake();
+
   protected:
 
     /*! Start a new iteration */
     void launch();
 
+    /*! Get the time to sleep before the next iteration
+     *  \return the time to sleep (in milliseconds), m_sleep_time seconds unless overridden
+     */
+    virtual long getNextSleep() const { return m_sleep_time * 1000; }
+
     /*! Function that will be called at each iteration
      *  \note Has to be ovveride in children
      */
@@ -78,6 +88,15 @@ class Iterations : public boost::enable_shared_from_this<Iterations>
 
     /*! Thread handling the iteration */
     boost::thread           m_thread;
+
+    /*! Mutex protecting the wake up flag */
+    boost::mutex            m_wake_mutex;
+
+    /*! Condition the thread sleeps on */
+    boost::condition_variable m_wake_condition;
+
+    /*! Has the timer been woken up during its sleep */
+    bool                    m_woken;
 };
 
 } // namespace graphite_proxy
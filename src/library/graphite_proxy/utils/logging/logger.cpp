@@ -7,6 +7,7 @@
 
 #include <boost/algorithm/string.hpp>
 
+#include <iostream>
 #include <sstream>
 
 namespace graphite_proxy {
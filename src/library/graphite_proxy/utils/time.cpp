@@ -16,6 +16,11 @@ ulong now()
   return boost::chrono::duration_cast<boost::chrono::seconds>( boost::chrono::system_clock::now().time_since_epoch() ).count();
 }
 
+ulong nowMilliseconds()
+{
+  return boost::chrono::duration_cast<boost::chrono::milliseconds>( boost::chrono::system_clock::now().time_since_epoch() ).count();
+}
+
 std::string humanDateTime()
 {
   return boost::posix_time::to_simple_string( boost::posix_time::microsec_clock::local_time() );
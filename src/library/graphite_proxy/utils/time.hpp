@@ -14,6 +14,11 @@ namespace time {
  */
 ulong now();
 
+/*! Get the current time with a better precision
+ *  \return a unsigned number representing a timestamp in milliseconds
+ */
+ulong nowMilliseconds();
+
 /*! Get the human readable current time
  *  \return a string representing a date
  */
@@ -29,9 +29,26 @@ void ConfigurationsLoader::inititialize( const std::vector<std::string> &params
   m_configs[server::props::PROPERTIES_SERVER_PORT]                   = server::props::PROPERTIES_SERVER_PORT_DEFAULT;
   m_configs[server::props::PROPERTIES_CLIENT_ADDRESS]                = "";
   m_configs[server::props::PROPERTIES_CLIENT_PORT]                   = "";
+  m_configs[server::props::PROPERTIES_CLIENT_DESTINATIONS]           = server::props::PROPERTIES_CLIENT_DESTINATIONS_DEFAULT;
+  m_configs[server::props::PROPERTIES_CLIENT_PROTOCOL]               = server::props::PROPERTIES_CLIENT_PROTOCOL_DEFAULT;
+  m_configs[server::props::PROPERTIES_CLIENT_COMPRESSION]            = server::props::PROPERTIES_CLIENT_COMPRESSION_DEFAULT;
+  m_configs[server::props::PROPERTIES_CLIENT_RECONNECT_MIN_DELAY]    = std::to_string( server::props::PROPERTIES_CLIENT_RECONNECT_MIN_DELAY_DEFAULT );
+  m_configs[server::props::PROPERTIES_CLIENT_RECONNECT_MAX_DELAY]    = std::to_string( server::props::PROPERTIES_CLIENT_RECONNECT_MAX_DELAY_DEFAULT );
+  m_configs[server::props::PROPERTIES_CLIENT_REPLICATION_FACTOR]     = std::to_string( server::props::PROPERTIES_CLIENT_REPLICATION_FACTOR_DEFAULT );
+  m_configs[server::props::PROPERTIES_CLIENT_HEALTH_CHECK_INTERVAL]  = std::to_string( server::props::PROPERTIES_CLIENT_HEALTH_CHECK_INTERVAL_DEFAULT );
+  m_configs[server::props::PROPERTIES_CLIENT_BREAKER_FAILURES]       = std::to_string( server::props::PROPERTIES_CLIENT_BREAKER_FAILURES_DEFAULT );
+  m_configs[server::props::PROPERTIES_CLIENT_BREAKER_COOLDOWN]       = std::to_string( server::props::PROPERTIES_CLIENT_BREAKER_COOLDOWN_DEFAULT );
+  m_configs[server::props::PROPERTIES_CLIENT_RATE_MESSAGES]          = std::to_string( server::props::PROPERTIES_CLIENT_RATE_MESSAGES_DEFAULT );
+  m_configs[server::props::PROPERTIES_CLIENT_RATE_BYTES]             = std::to_string( server::props::PROPERTIES_CLIENT_RATE_BYTES_DEFAULT );
+  m_configs[server::props::PROPERTIES_CLIENT_RATE_MAX_LATENCY]       = std::to_string( server::props::PROPERTIES_CLIENT_RATE_MAX_LATENCY_DEFAULT );
   m_configs[server::props::PROPERTIES_BUFFER_MAX_ITEMS]              = std::to_string( server::props::PROPERTIES_BUFFER_MAX_ITEMS_DEFAULT );
   m_configs[server::props::PROPERTIES_BUFFER_FLUSH_TIME]             = std::to_string( server::props::PROPERTIES_BUFFER_FLUSH_TIME_DEFAULT );
   m_configs[server::props::PROPERTIES_BUFFER_DROP_OLDER]             = std::to_string( server::props::PROPERTIES_BUFFER_DROP_OLDER_DEFAULT );
+  m_configs[server::props::PROPERTIES_BUFFER_FLUSH_THREADS]          = std::to_string( server::props::PROPERTIES_BUFFER_FLUSH_THREADS_DEFAULT );
+  m_configs[server::props::PROPERTIES_BUFFER_FLUSH_QUEUE_SIZE]       = std::to_string( server::props::PROPERTIES_BUFFER_FLUSH_QUEUE_SIZE_DEFAULT );
+  m_configs[server::props::PROPERTIES_BUFFER_FLUSH_CHUNK_SIZE]       = std::to_string( server::props::PROPERTIES_BUFFER_FLUSH_CHUNK_SIZE_DEFAULT );
+  m_configs[server::props::PROPERTIES_BUFFER_FLUSH_BYTES]            = std::to_string( server::props::PROPERTIES_BUFFER_FLUSH_BYTES_DEFAULT );
+  m_configs[server::props::PROPERTIES_BUFFER_FLUSH_MAX_AGE]          = std::to_string( server::props::PROPERTIES_BUFFER_FLUSH_MAX_AGE_DEFAULT );
   m_configs[server::props::PROPERTIES_LOGS_LEVEL]                    = server::props::PROPERTIES_LOGS_LEVEL_DEFAULT;
   m_configs[server::props::PROPERTIES_LOGS_COLOR]                    = std::to_string( server::props::PROPERTIES_LOGS_COLOR_DEFAULT );
   m_configs[server::props::PROPERTIES_LOGS_DESTINATION]              = server::props::PROPERTIES_LOGS_DESTINATION_DEFAULT;
@@ -43,8 +60,14 @@ void ConfigurationsLoader::inititialize( const std::vector<std::string> &params
   m_configs[server::props::PROPERTIES_ROUTER_SAVE_ON_CLOSE]          = std::to_string( server::props::PROPERTIES_ROUTER_SAVE_ON_CLOSE_DEFAULT );
   m_configs[server::props::PROPERTIES_ROUTER_PASSTHROUGH_SAVE_FILE]  = server::props::PROPERTIES_ROUTER_PASSTHROUGH_SAVE_FILE_DEFAULT;
   m_configs[server::props::PROPERTIES_ROUTER_MATHS_SAVE_FILE]        = server::props::PROPERTIES_ROUTER_MATHS_SAVE_FILE_DEFAULT;
+  m_configs[server::props::PROPERTIES_ROUTER_CACHE_SIZE]             = std::to_string( server::props::PROPERTIES_ROUTER_CACHE_SIZE_DEFAULT );
   m_configs[server::props::PROPERTIES_SIGNALS_CURRENT_STATE_FILE]    = server::props::PROPERTIES_SIGNALS_CURRENT_STATE_FILE_DEFAULT;
   m_configs[server::props::PROPERTIES_SERVER_UDP_PORT]               = server::props::PROPERTIES_SERVER_UDP_PORT_DEFAULT;
+  m_configs[server::props::PROPERTIES_SERVER_THREADS]                 = std::to_string( server::props::PROPERTIES_SERVER_THREADS_DEFAULT );
+  m_configs[server::props::PROPERTIES_SERVER_UDP_DATAGRAM_SIZE]       = std::to_string( server::props::PROPERTIES_SERVER_UDP_DATAGRAM_SIZE_DEFAULT );
+  m_configs[server::props::PROPERTIES_SERVER_UDP_BATCH_SIZE]          = std::to_string( server::props::PROPERTIES_SERVER_UDP_BATCH_SIZE_DEFAULT );
+  m_configs[server::props::PROPERTIES_SERVER_UDP_RECEIVE_BUFFER]      = std::to_string( server::props::PROPERTIES_SERVER_UDP_RECEIVE_BUFFER_DEFAULT );
+  m_configs[server::props::PROPERTIES_SERVER_COMPRESSION]             = server::props::PROPERTIES_SERVER_COMPRESSION_DEFAULT;
   m_configs[server::props::PROPERTIES_BUFFER_CLEANER_ACTIVATED]      = std::to_string( server::props::PROPERTIES_BUFFER_CLEANER_ACTIVATED_DEFAULT );
   m_configs[server::props::PROPERTIES_BUFFER_CLEANER_TIME]           = std::to_string( server::props::PROPERTIES_BUFFER_CLEANER_TIME_DEFAULT );
   m_configs[server::props::PROPERTIES_BUFFER_CLEANER_MAX_EMPTY_TIME] = std::to_string( server::props::PROPERTIES_BUFFER_CLEANER_MAX_EMPTY_TIME_DEFAULT );
@@ -10,6 +10,7 @@
 #include <string>
 #include <map>
 #include <istream>
+#include <iostream>
 
 namespace server {
 namespace utils {
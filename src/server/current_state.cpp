@@ -22,6 +22,10 @@ CurrentState::CurrentState( const std::string& filepath, const graphite_proxy::n
                                                        , const server::networking::udp_server_ptr udp_server )
   : m_filepath(filepath)
   , m_client_is_ready(false)
+  , m_client_is_connected(false)
+  , m_client_nbr_destinations(0)
+  , m_client_nbr_healthy(0)
+  , m_client_replication(0)
   , m_gbuffer_drop_oldest(false)
   , m_gbuffer_max_size(0)
   , m_timer_flush_time(0)
@@ -31,14 +35,21 @@ CurrentState::CurrentState( const std::string& filepath, const graphite_proxy::n
   // Retrieve client informations
   if( client )
   {
-    m_client_is_ready = client->isReady();
+    m_client_is_ready         = client->isReady();
+    m_client_is_connected     = client->isConnected();
+    m_client_nbr_destinations = client->getNbrDestinations();
+    m_client_nbr_healthy      = client->getNbrHealthyDestinations();
+    m_client_replication      = client->getReplicationFactor();
   }
 
   // Global buffer informations
   if( global_buffer )
   {
     m_gbuffer_drop_oldest  = global_buffer->isDropOldest();
-    m_gbuffer_buffer_sizes = global_buffer->getBufferSizes();
+    // Buffers are displayed sorted by name
+    const std::map<graphite_proxy::series_id, unsigned long> buffer_sizes = global_buffer->getBufferSizes();
+    for( auto it = buffer_sizes.begin(); it != buffer_sizes.end(); ++it )
+      m_gbuffer_buffer_sizes[graphite_proxy::SeriesTable::instance().name( it->first )] = it->second;
     m_gbuffer_max_size     = global_buffer->getBuffersMaxSize();
   }
 
@@ -136,6 +147,10 @@ std::string CurrentState::showClient() const
 
   result << this->writeHeader("CLIENT");
   result << "is ready: " << graphite_proxy::utils::cast::toString(m_client_is_ready, true) << std::endl;
+  result << "is connected: " << graphite_proxy::utils::cast::toString(m_client_is_connected, true) << std::endl;
+  result << "destinations: " << m_client_nbr_destinations << std::endl;
+  result << "healthy destinations: " << m_client_nbr_healthy << std::endl;
+  result << "replication factor: " << m_client_replication << std::endl;
 
   return result.str();
 }
@@ -281,14 +296,14 @@ std::string CurrentState::showMaths() const
     for( auto it = m_maths_buffers.begin(); it != m_maths_buffers.end(); ++it )
     {
       result << "\t" << vertical_separator << std::endl;
-      result << "\t" << this->addTableLine( it->first, max_buffer_name_length, header_current_state, current_state_length ) << std::endl;
+      result << "\t" << this->addTableLine( graphite_proxy::SeriesTable::instance().name( it->first ), max_buffer_name_length, header_current_state, current_state_length ) << std::endl;
       result << "\t" << vertical_separator << std::endl;
 
       const std::vector<graphite_proxy::maths::MathOperation*>& operations = it->second;
       for( size_t i = 0, size = operations.size(); i < size; i++ )
       {
         const graphite_proxy::MessageBuffer& buffer              = operations[i]->buffer;
-        unsigned long                        current_buffer_size = buffer.size();
+        unsigned long                        current_buffer_size = operations[i]->size();
         unsigned long                        buffer_max_size     = buffer.getBufferMaxSize();
         float                                percentage          = (buffer_max_size != 0) ? (current_buffer_size * 100.0 / buffer_max_size) : -1;
 
@@ -11,6 +11,7 @@
 
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <list>
 #include <vector>
 
@@ -83,6 +84,14 @@ class CurrentState
 
     bool                                                                       m_client_is_ready;
 
+    bool                                                                       m_client_is_connected;
+
+    size_t                                                                     m_client_nbr_destinations;
+
+    size_t                                                                     m_client_nbr_healthy;
+
+    size_t                                                                     m_client_replication;
+
     bool                                                                       m_gbuffer_drop_oldest;
 
     unsigned long                                                              m_gbuffer_max_size;
@@ -97,7 +106,7 @@ class CurrentState
 
     std::list<graphite_proxy::maths::MathsCategory*>                           m_maths_categories;
 
-    std::map<std::string, std::vector<graphite_proxy::maths::MathOperation*>>  m_maths_buffers;
+    std::unordered_map<graphite_proxy::series_id, std::vector<graphite_proxy::maths::MathOperation*>>  m_maths_buffers;
 
     ServerInformation                                                          m_tcp_server_info;
 
@@ -24,6 +24,7 @@
 
 #include <boost/lexical_cast.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
 
 #include <iostream>
 #include <csignal>
@@ -70,18 +71,10 @@ void signalsHandler( int signal_type )
     if( !is_quitting )
     {
       is_quitting = true;
-      LOG_INFO( "Exit with signal: " + boost::lexical_cast<int>(signal_type), utils::logging::LOG_HEADER_MAIN );
+      LOG_INFO( "Exit with signal: " + std::to_string(signal_type), utils::logging::LOG_HEADER_MAIN );
 
+      // The servers stop receiving messages, pending ones are taken care of once all service threads have returned
       g_service.stop();
-
-      // Save pending messages if requested
-      if( g_configs_loader->getProperty<bool>( server::props::PROPERTIES_ROUTER_SAVE_ON_CLOSE, server::props::PROPERTIES_ROUTER_SAVE_ON_CLOSE_DEFAULT ) )
-      {
-        const std::string& conf_dir_path                 = g_configs_loader->getConfFilesDir();
-        const std::string pass_through_messages_filepath = conf_dir_path + g_configs_loader->getProperty<std::string>( server::props::PROPERTIES_ROUTER_PASSTHROUGH_SAVE_FILE, server::props::PROPERTIES_ROUTER_PASSTHROUGH_SAVE_FILE_DEFAULT );
-        const std::string maths_messages_filepath        = conf_dir_path + g_configs_loader->getProperty<std::string>( server::props::PROPERTIES_ROUTER_MATHS_SAVE_FILE, server::props::PROPERTIES_ROUTER_MATHS_SAVE_FILE_DEFAULT );
-        g_router->serialize( pass_through_messages_filepath, maths_messages_filepath );
-      }
     }
     else
     {
@@ -91,6 +84,28 @@ void signalsHandler( int signal_type )
   }
 }
 
+/*! Wait for the next operating system signal
+ *  \param signals is the set of signals to wait for
+ *  \note signals are treated by a service thread, never in the context of the interrupted thread
+ */
+void waitSignals( boost::asio::signal_set &signals )
+{
+  signals.async_wait( [&signals]( const boost::system::error_code &error, int signal_type )
+  {
+    if( error )
+      return;
+
+    signalsHandler( signal_type );
+    waitSignals( signals );
+  });
+}
+
+/*! Function run by each thread receiving incoming messages */
+void runService()
+{
+  g_service.run();
+}
+
 int main( int argc, char **argv )
 {
   {
@@ -142,8 +157,52 @@ int main( int argc, char **argv )
   LOG_DEBUG( std::string("Starting Graphite Proxy (PID ") + std::to_string(server::utils::SystemHelper::getProcessID()) + ")", utils::logging::LOG_HEADER_MAIN );
 
   // Client creation
-  g_client = boost::make_shared<networking::Client>( g_configs_loader->getProperty<std::string>( server::props::PROPERTIES_CLIENT_ADDRESS, "127.0.0.1" ),
-                                                     g_configs_loader->getProperty<std::string>( server::props::PROPERTIES_CLIENT_PORT, server::props::PROPERTIES_CLIENT_PORT_DEFAULT ) );
+  const unsigned long reconnect_min_delay = g_configs_loader->getProperty<unsigned long>( server::props::PROPERTIES_CLIENT_RECONNECT_MIN_DELAY, server::props::PROPERTIES_CLIENT_RECONNECT_MIN_DELAY_DEFAULT );
+  const unsigned long reconnect_max_delay = g_configs_loader->getProperty<unsigned long>( server::props::PROPERTIES_CLIENT_RECONNECT_MAX_DELAY, server::props::PROPERTIES_CLIENT_RECONNECT_MAX_DELAY_DEFAULT );
+  const unsigned long health_check_interval = g_configs_loader->getProperty<unsigned long>( server::props::PROPERTIES_CLIENT_HEALTH_CHECK_INTERVAL, server::props::PROPERTIES_CLIENT_HEALTH_CHECK_INTERVAL_DEFAULT );
+  const std::string   destinations        = g_configs_loader->getProperty<std::string>( server::props::PROPERTIES_CLIENT_DESTINATIONS, server::props::PROPERTIES_CLIENT_DESTINATIONS_DEFAULT );
+
+  networking::Protocol protocol;
+  if( !networking::encoder::parseProtocol( g_configs_loader->getProperty<std::string>( server::props::PROPERTIES_CLIENT_PROTOCOL, server::props::PROPERTIES_CLIENT_PROTOCOL_DEFAULT ), protocol ) )
+  {
+    LOG_ERROR( "Unable to read client protocol property", utils::logging::LOG_HEADER_MAIN );
+    return EXIT_BAD_CONFIGURATION;
+  }
+
+  networking::Compression compression;
+  if( !networking::Compressor::parse( g_configs_loader->getProperty<std::string>( server::props::PROPERTIES_CLIENT_COMPRESSION, server::props::PROPERTIES_CLIENT_COMPRESSION_DEFAULT ), compression ) )
+  {
+    LOG_ERROR( "Unable to read client compression property", utils::logging::LOG_HEADER_MAIN );
+    return EXIT_BAD_CONFIGURATION;
+  }
+
+  // Without destinations, the only Graphite Server is client.address:client.port
+  std::vector<networking::Destination> parsed_destinations;
+  if( destinations.empty() )
+  {
+    networking::Destination destination;
+    destination.host     = g_configs_loader->getProperty<std::string>( server::props::PROPERTIES_CLIENT_ADDRESS, "127.0.0.1" );
+    destination.port     = g_configs_loader->getProperty<std::string>( server::props::PROPERTIES_CLIENT_PORT, server::props::PROPERTIES_CLIENT_PORT_DEFAULT );
+    destination.protocol    = protocol;
+    destination.compression = compression;
+    parsed_destinations.push_back( destination );
+  }
+  else if( !networking::Client::parseDestinations( destinations, parsed_destinations, protocol, compression ) )
+  {
+    LOG_ERROR( "Unable to read client destinations property", utils::logging::LOG_HEADER_MAIN );
+    return EXIT_BAD_CONFIGURATION;
+  }
+
+  g_client = boost::make_shared<networking::Client>( parsed_destinations,
+                                                     g_configs_loader->getProperty<size_t>( server::props::PROPERTIES_CLIENT_REPLICATION_FACTOR, server::props::PROPERTIES_CLIENT_REPLICATION_FACTOR_DEFAULT ),
+                                                     reconnect_min_delay, reconnect_max_delay, networking::CLIENT_DEFAULT_MAX_PENDING_BATCHES, health_check_interval );
+
+  g_client->setCircuitBreaker( g_configs_loader->getProperty<unsigned int>( server::props::PROPERTIES_CLIENT_BREAKER_FAILURES, server::props::PROPERTIES_CLIENT_BREAKER_FAILURES_DEFAULT ),
+                               g_configs_loader->getProperty<unsigned long>( server::props::PROPERTIES_CLIENT_BREAKER_COOLDOWN, server::props::PROPERTIES_CLIENT_BREAKER_COOLDOWN_DEFAULT ) );
+
+  g_client->setRateLimit( g_configs_loader->getProperty<unsigned long>( server::props::PROPERTIES_CLIENT_RATE_MESSAGES, server::props::PROPERTIES_CLIENT_RATE_MESSAGES_DEFAULT ),
+                          g_configs_loader->getProperty<unsigned long>( server::props::PROPERTIES_CLIENT_RATE_BYTES, server::props::PROPERTIES_CLIENT_RATE_BYTES_DEFAULT ),
+                          g_configs_loader->getProperty<unsigned long>( server::props::PROPERTIES_CLIENT_RATE_MAX_LATENCY, server::props::PROPERTIES_CLIENT_RATE_MAX_LATENCY_DEFAULT ) );
 
   if(!g_client->isReady())
   {
@@ -156,6 +215,14 @@ int main( int argc, char **argv )
                                                g_configs_loader->getProperty<bool>( server::props::PROPERTIES_BUFFER_DROP_OLDER, server::props::PROPERTIES_BUFFER_DROP_OLDER_DEFAULT ),
                                                g_client );
 
+  // Full buffers are sent by dedicated threads, off the reception path
+  const unsigned int flush_threads = g_configs_loader->getProperty<unsigned int>( server::props::PROPERTIES_BUFFER_FLUSH_THREADS, server::props::PROPERTIES_BUFFER_FLUSH_THREADS_DEFAULT );
+  if( flush_threads > 0 )
+  {
+    g_buffer->startFlushQueue( flush_threads, g_configs_loader->getProperty<size_t>( server::props::PROPERTIES_BUFFER_FLUSH_QUEUE_SIZE, server::props::PROPERTIES_BUFFER_FLUSH_QUEUE_SIZE_DEFAULT ) );
+    LOG_INFO( "Sending full buffers with " + std::to_string( flush_threads ) + " threads", utils::logging::LOG_HEADER_GLOBALBUFFER );
+  }
+
   const std::string& config_dir = g_configs_loader->getConfFilesDir();
 
   // Maths creation
@@ -168,12 +235,18 @@ int main( int argc, char **argv )
   else LOG_INFO( "Maths module disabled", utils::logging::LOG_HEADER_MATHS );
 
   // Router creation
-  g_router = boost::make_shared<Router>( g_buffer, g_maths );
+  g_router = boost::make_shared<Router>( g_buffer, g_maths, g_configs_loader->getProperty<ulong>( server::props::PROPERTIES_ROUTER_CACHE_SIZE, server::props::PROPERTIES_ROUTER_CACHE_SIZE_DEFAULT ) );
 
   // Server creation
   std::string address = g_configs_loader->getProperty<std::string>( server::props::PROPERTIES_SERVER_ADDRESS, "127.0.0.1" );
   std::string port = g_configs_loader->getProperty<std::string>( server::props::PROPERTIES_SERVER_PORT, server::props::PROPERTIES_SERVER_PORT_DEFAULT );
-  g_tcp_server = boost::make_shared<server::networking::Server>( &g_service, g_router, address, port);
+  networking::Compression server_compression;
+  if( !networking::Compressor::parse( g_configs_loader->getProperty<std::string>( server::props::PROPERTIES_SERVER_COMPRESSION, server::props::PROPERTIES_SERVER_COMPRESSION_DEFAULT ), server_compression ) )
+  {
+    LOG_ERROR( "Unable to read server compression property", utils::logging::LOG_HEADER_MAIN );
+    return EXIT_BAD_CONFIGURATION;
+  }
+  g_tcp_server = boost::make_shared<server::networking::Server>( &g_service, g_router, address, port, server_compression );
 
   // UDP server creation
   unsigned short udp_port;
@@ -183,12 +256,30 @@ int main( int argc, char **argv )
     LOG_ERROR("Unable to read udp port property", utils::logging::LOG_HEADER_MAIN);
     return EXIT_BAD_CONFIGURATION;
   }
-  g_udp_server = boost::make_shared<server::networking::UDPServer>(g_service, g_router, udp_port);
+
+  // Number of threads receiving incoming messages
+  unsigned int nbr_threads = g_configs_loader->getProperty<unsigned int>( server::props::PROPERTIES_SERVER_THREADS, server::props::PROPERTIES_SERVER_THREADS_DEFAULT );
+  if( nbr_threads == 0 )
+    nbr_threads = 1;
+
+  // UDP reception buffers
+  const size_t udp_datagram_size  = g_configs_loader->getProperty<size_t>( server::props::PROPERTIES_SERVER_UDP_DATAGRAM_SIZE, server::props::PROPERTIES_SERVER_UDP_DATAGRAM_SIZE_DEFAULT );
+  const size_t udp_batch_size     = g_configs_loader->getProperty<size_t>( server::props::PROPERTIES_SERVER_UDP_BATCH_SIZE, server::props::PROPERTIES_SERVER_UDP_BATCH_SIZE_DEFAULT );
+  const int    udp_receive_buffer = g_configs_loader->getProperty<int>( server::props::PROPERTIES_SERVER_UDP_RECEIVE_BUFFER, server::props::PROPERTIES_SERVER_UDP_RECEIVE_BUFFER_DEFAULT );
+
+  g_udp_server = boost::make_shared<server::networking::UDPServer>(g_service, g_router, udp_port, nbr_threads, udp_datagram_size, udp_batch_size, udp_receive_buffer);
 
   // Timer creation
-  g_timer = boost::make_shared<Timer>( g_buffer, g_client, g_configs_loader->getProperty<long>( server::props::PROPERTIES_BUFFER_FLUSH_TIME, server::props::PROPERTIES_BUFFER_FLUSH_TIME_DEFAULT ) );
+  g_timer = boost::make_shared<Timer>( g_buffer, g_client, g_configs_loader->getProperty<long>( server::props::PROPERTIES_BUFFER_FLUSH_TIME, server::props::PROPERTIES_BUFFER_FLUSH_TIME_DEFAULT ),
+                                       g_configs_loader->getProperty<size_t>( server::props::PROPERTIES_BUFFER_FLUSH_CHUNK_SIZE, server::props::PROPERTIES_BUFFER_FLUSH_CHUNK_SIZE_DEFAULT ) );
   LOG_INFO( "Flushing pass through messages every " + std::to_string( g_timer->getSleepTime() ) + " seconds", utils::logging::LOG_HEADER_TIMER );
 
+  const size_t        flush_bytes   = g_configs_loader->getProperty<size_t>( server::props::PROPERTIES_BUFFER_FLUSH_BYTES, server::props::PROPERTIES_BUFFER_FLUSH_BYTES_DEFAULT );
+  const unsigned long flush_max_age = g_configs_loader->getProperty<unsigned long>( server::props::PROPERTIES_BUFFER_FLUSH_MAX_AGE, server::props::PROPERTIES_BUFFER_FLUSH_MAX_AGE_DEFAULT );
+  g_timer->setFlushPolicy( flush_bytes, flush_max_age );
+  if( flush_bytes > 0 || flush_max_age > 0 )
+    LOG_INFO( "Flushing pass through messages as soon as they reach " + std::to_string( flush_bytes ) + " bytes or " + std::to_string( flush_max_age ) + " ms (0 is ignored)", utils::logging::LOG_HEADER_TIMER );
+
   // Cleaner creation
   if(g_configs_loader->getProperty<bool>( server::props::PROPERTIES_BUFFER_CLEANER_ACTIVATED, server::props::PROPERTIES_BUFFER_CLEANER_ACTIVATED_DEFAULT ))
     g_cleaner = boost::make_shared<Cleaner>( g_buffer, g_maths
@@ -202,11 +293,13 @@ int main( int argc, char **argv )
   else LOG_INFO( "Statistics module disabled", utils::logging::LOG_HEADER_STATISTICS );
 
   // Signals
-  signal( SIGINT,  signalsHandler ); // Signal to quit application
-  signal( SIGTERM, signalsHandler ); // Signal to quit application
-  signal( SIGQUIT, signalsHandler ); // Signal to quit application
-  signal( SIGUSR1, signalsHandler ); // Signal to reload configurations
-  signal( SIGUSR2, signalsHandler ); // Signal to dump current state in a file
+  boost::asio::signal_set signals( g_service );
+  signals.add( SIGINT );  // Signal to quit application
+  signals.add( SIGTERM ); // Signal to quit application
+  signals.add( SIGQUIT ); // Signal to quit application
+  signals.add( SIGUSR1 ); // Signal to reload configurations
+  signals.add( SIGUSR2 ); // Signal to dump current state in a file
+  waitSignals( signals );
 
   // Start the main timer
   g_timer->start();
@@ -233,7 +326,29 @@ int main( int argc, char **argv )
   // Start the servers
   g_tcp_server->start();
   g_udp_server->start();
+
+  // Run the servers on a pool of threads, the main thread being one of them
+  LOG_INFO( "Receiving messages with " + std::to_string( nbr_threads ) + " threads", utils::logging::LOG_HEADER_MAIN );
+  boost::thread_group service_threads;
+  for( unsigned int i = 1; i < nbr_threads; i++ )
+    service_threads.create_thread( runService );
   g_service.run();
+  service_threads.join_all();
+
+  // Default signal actions are back, so another signal quits without waiting for pending messages
+  signals.clear();
+
+  // Take back the full buffers and the batches which are not sent yet
+  g_buffer->stopFlushQueue();
+  g_client->stop();
+
+  // Save pending messages if requested
+  if( g_configs_loader->getProperty<bool>( server::props::PROPERTIES_ROUTER_SAVE_ON_CLOSE, server::props::PROPERTIES_ROUTER_SAVE_ON_CLOSE_DEFAULT ) )
+  {
+    const std::string pass_through_messages_filepath = config_dir + g_configs_loader->getProperty<std::string>( server::props::PROPERTIES_ROUTER_PASSTHROUGH_SAVE_FILE, server::props::PROPERTIES_ROUTER_PASSTHROUGH_SAVE_FILE_DEFAULT );
+    const std::string maths_messages_filepath        = config_dir + g_configs_loader->getProperty<std::string>( server::props::PROPERTIES_ROUTER_MATHS_SAVE_FILE, server::props::PROPERTIES_ROUTER_MATHS_SAVE_FILE_DEFAULT );
+    g_router->serialize( pass_through_messages_filepath, maths_messages_filepath );
+  }
 
   return EXIT_SUCCESS;
 }
@@ -3,14 +3,16 @@
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/bind.hpp>
 
-#include <sstream>
+#include <string.h>
 
 namespace graphite_proxy {
 namespace networking {
 
-Request::Request( boost::asio::io_service &io_service, router_ptr router )
+Request::Request( boost::asio::io_service &io_service, router_ptr router, Compression compression )
   : m_socket( io_service )
+  , m_is_discarding( false )
   , m_router( router )
+  , m_decompressor( ( compression == Compression::ZLIB ) ? new Decompressor() : nullptr )
 {
   // Nothing
 }
@@ -30,29 +32,105 @@ void Request::asyncRead()
 {
   STATS_INCREMENT( stats::STATS_REQUESTS_INCOMING );
 
-  boost::asio::async_read_until( m_socket, m_data_buffer, "\0",
-          boost::bind( &Request::handleRead, shared_from_this(), boost::asio::placeholders::error ) );
+  this->read();
 }
 
-void Request::handleRead( const boost::system::error_code &error )
+void Request::read()
+{
+  m_socket.async_read_some( boost::asio::buffer( m_data_buffer ),
+          boost::bind( &Request::handleRead, shared_from_this(), boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred ) );
+}
+
+void Request::handleRead( const boost::system::error_code &error, size_t bytes_transferred )
 {
   if (error)
   {
-    LOG_ERROR( "Handler read error: " + error.message(), utils::logging::LOG_HEADER_REQUEST );
+    // The peer closed the connection, the last line may not be terminated by '\n'
+    if( error == boost::asio::error::eof )
+    {
+      if( !m_pending_line.empty() && !m_is_discarding )
+      {
+        this->routeLine( m_pending_line );
+        m_pending_line.clear();
+      }
+    }
+    else if( error != boost::asio::error::operation_aborted )
+    {
+      LOG_ERROR( "Handler read error: " + error.message(), utils::logging::LOG_HEADER_REQUEST );
+    }
+
     return;
   }
 
   // Finish networking stuff, store informations into buffer
-  this->store();
+  if( m_decompressor )
+  {
+    m_decompressed.clear();
+    if( !m_decompressor->decompress( m_data_buffer.data(), bytes_transferred, m_decompressed ) )
+    {
+      LOG_ERROR( "Invalid compressed data, close the connection", utils::logging::LOG_HEADER_REQUEST );
+      STATS_INCREMENT( stats::STATS_REQUESTS_DROPPED );
+      return;
+    }
+
+    this->store( m_decompressed.data(), m_decompressed.size() );
+  }
+  else this->store( m_data_buffer.data(), bytes_transferred );
+
+  // Keep the session alive
+  this->read();
 }
 
-void Request::store()
+void Request::store( const char* data, size_t size )
 {
-  STATS_INCREMENT( stats::STATS_REQUESTS_ACCEPTED );
+  const char* data_end  = data + size;
+  const char* line_end;
+
+  // Route each complete line
+  while( (line_end = static_cast<const char*>( memchr( data, '\n', data_end - data ) )) != nullptr )
+  {
+    if( m_is_discarding )
+    {
+      // End of a line already dropped because too long
+      m_is_discarding = false;
+    }
+    else if( m_pending_line.empty() )
+    {
+      this->routeLine( std::string_view( data, line_end - data ) );
+    }
+    else
+    {
+      // Complete the line started during a previous read
+      m_pending_line.append( data, line_end );
+      this->routeLine( m_pending_line );
+      m_pending_line.clear();
+    }
+
+    data = line_end + 1;
+  }
+
+  // Keep the partial line for the next read, unless it is being dropped
+  if( m_is_discarding )
+    return;
+
+  m_pending_line.append( data, data_end );
+
+  if( m_pending_line.size() > MAX_MESSAGE_LENGTH )
+  {
+    LOG_WARNING( "Line too long, drop it", utils::logging::LOG_HEADER_REQUEST );
+    STATS_INCREMENT( stats::STATS_REQUESTS_DROPPED );
+    m_pending_line.clear();
+    m_is_discarding = true;
+  }
+}
+
+void Request::routeLine( std::string_view line )
+{
+  if( line.empty() )
+    return;
 
-  std::ostringstream message_content;
-  message_content << &m_data_buffer;
-  m_router->routeMessage( message_content.str() );
+  STATS_INCREMENT( stats::STATS_REQUESTS_ACCEPTED );
+  m_router->routeMessage( line );
 }
 
 } // namespace networking
@@ -2,6 +2,7 @@
 #define GRAPHITE_PROXY_REQUEST_HPP
 
 #include <graphite_proxy/models/router.hpp>
+#include <graphite_proxy/networking/compression.hpp>
 
 #include <graphite_proxy/models/statistics/statistics_metrics.hpp>
 #include <graphite_proxy/models/statistics/statistics.hpp>
@@ -10,17 +11,23 @@
 #include <graphite_proxy/utils/logging/log_headers.hpp>
 
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/array.hpp>
 #include <boost/asio.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
 #include <vector>
 #include <string>
+#include <string_view>
 
 namespace graphite_proxy {
 namespace networking {
 
 /*! Incoming network request
  *  This class has two goals: (1) read the request content (2) parse the request content to create only valid messages
+ *  \note a request is a long lived session: it keeps reading until the peer closes the connection.
+ *        Incoming data is split on '\n', each complete line is routed and a partial line is carried over to the next read.
+ *  \note with compression, the incoming data is a zlib stream decompressed before being split.
  */
 class Request : public boost::enable_shared_from_this<Request>
 {
@@ -29,8 +36,9 @@ class Request : public boost::enable_shared_from_this<Request>
     /*! Constructor
      *  \param io_service is an Input / Output service
      *  \param router is a Router instance to route the created message
+     *  \param compression is the compression of the incoming data
      */
-    Request( boost::asio::io_service &io_service, router_ptr router );
+    Request( boost::asio::io_service &io_service, router_ptr router, Compression compression = Compression::NONE );
 
     ~Request();
 
@@ -39,29 +47,57 @@ class Request : public boost::enable_shared_from_this<Request>
      */
     boost::asio::ip::tcp::socket& socket() { return m_socket; }
 
-    /*! Asyncronously read the incoming data  */
+    /*! Asyncronously read the incoming data until the connection is closed */
     void asyncRead();
 
   protected:
 
+    /*! Post a new read on the socket */
+    void read();
+
     /*! Read handler
      *  \param error is the possible errors which can occured
+     *  \param bytes_transferred is the number of bytes read into m_data_buffer
      */
-    void handleRead( const boost::system::error_code &error );
+    void handleRead( const boost::system::error_code &error, size_t bytes_transferred );
 
-    /*! Send the message to the router to store it */
-    void store();
+    /*! Split the received data into lines and send each complete line to the router
+     *  \param data is the received data
+     *  \param size is the number of received bytes
+     *  \note the remaining partial line is kept into m_pending_line, a line longer than MAX_MESSAGE_LENGTH is dropped as a whole
+     */
+    void store( const char* data, size_t size );
+
+    /*! Send a complete line to the router
+     *  \param line is the line to route
+     */
+    void routeLine( std::string_view line );
 
   private:
 
+    /*! Size of the reception buffer (in bytes) */
+    static const size_t                  m_buffer_size = 8192;
+
     /*! Socket used to send/receive data */
-    boost::asio::ip::tcp::socket  m_socket;
+    boost::asio::ip::tcp::socket         m_socket;
 
     /*! Buffer to store incoming data */
-    boost::asio::streambuf        m_data_buffer;
+    boost::array<char, m_buffer_size>    m_data_buffer;
+
+    /*! Beginning of a line not yet terminated by '\n' at the end of the previous read */
+    std::string                          m_pending_line;
+
+    /*! Is the rest of a too long line skipped until its '\n' */
+    bool                                 m_is_discarding;
 
     /*! Router to route the created message */
-    router_ptr                    m_router;
+    router_ptr                           m_router;
+
+    /*! Decompressor of the incoming data (null without compression) */
+    boost::scoped_ptr<Decompressor>      m_decompressor;
+
+    /*! Decompressed data */
+    std::string                          m_decompressed;
 };
 
 typedef boost::shared_ptr<graphite_proxy::networking::Request> request_ptr;
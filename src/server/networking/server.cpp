@@ -6,9 +6,10 @@
 namespace server {
 namespace networking {
 
-Server::Server(boost::asio::io_service* io_service, const graphite_proxy::router_ptr router, const std::string &ip_address, const std::string &port)
+Server::Server(boost::asio::io_service* io_service, const graphite_proxy::router_ptr router, const std::string &ip_address, const std::string &port, graphite_proxy::networking::Compression compression)
   : m_io_service(io_service)
   , m_router(router)
+  , m_compression(compression)
 {
   this->setIPAddress(ip_address, port);
 }
@@ -65,7 +66,7 @@ unsigned short Server::getPort() const
 
 void Server::startAccept()
 {
-  boost::shared_ptr<graphite_proxy::networking::Request> request(new graphite_proxy::networking::Request(*m_io_service, m_router));
+  boost::shared_ptr<graphite_proxy::networking::Request> request(new graphite_proxy::networking::Request(*m_io_service, m_router, m_compression));
   m_acceptor->async_accept(request->socket(), boost::bind(&Server::handlerAccept, shared_from_this(), request, boost::asio::placeholders::error));
 }
 
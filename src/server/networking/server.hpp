@@ -30,8 +30,10 @@ class Server : public boost::enable_shared_from_this<Server>
    *  \param router is the a Router instance. It dispatches requests to those which want them (Global Buffer or Maths Pipeline).
    *  \param ip_address is the server ip address
    *  \param port is the server port
+   *  \param compression is the compression of the incoming streams (when the peers are other proxies)
    */
-  Server(boost::asio::io_service* io_service, const graphite_proxy::router_ptr router, const std::string &ip_address, const std::string &port);
+  Server(boost::asio::io_service* io_service, const graphite_proxy::router_ptr router, const std::string &ip_address, const std::string &port,
+         graphite_proxy::networking::Compression compression = graphite_proxy::networking::Compression::NONE);
 
   /*! Destructor */
   virtual ~Server();
@@ -73,6 +75,7 @@ class Server : public boost::enable_shared_from_this<Server>
   boost::asio::io_service*                          m_io_service; ///< Boost I/O service object that will manage server socket I/O
   const graphite_proxy::router_ptr                  m_router;     ///< Router instance to route incoming requests
   boost::shared_ptr<boost::asio::ip::tcp::acceptor> m_acceptor;   ///< TCP acceptor to handle incoming TCP requests
+  const graphite_proxy::networking::Compression     m_compression; ///< Compression of the incoming streams
 };
 
 typedef boost::shared_ptr<Server> tcp_server_ptr;
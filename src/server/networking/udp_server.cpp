@@ -1,23 +1,69 @@
 #include "udp_server.hpp"
 
+#include <graphite_proxy/models/statistics/statistics_metrics.hpp>
+#include <graphite_proxy/models/statistics/statistics.hpp>
 #include <graphite_proxy/utils/logging/logger.hpp>
 
 #include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
 
+#include <cerrno>
+#include <cstring>
 #include <sstream>
 #include <string>
+#include <string_view>
 
 namespace server {
 namespace networking {
 
 using boost::asio::ip::udp;
+using namespace graphite_proxy;
 
-UDPServer::UDPServer(boost::asio::io_service& io_service, const graphite_proxy::router_ptr& router, unsigned short port)
-  : m_socket(io_service, udp::endpoint(udp::v4(), port))
-  , m_router(router)
+/*! SO_REUSEPORT socket option, not provided by boost::asio */
+typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+
+/*! Maximum number of batches read each time a socket becomes readable, so that a flooded socket can't starve the others */
+static const unsigned int UDP_MAX_BATCHES_PER_WAKEUP = 16;
+
+UDPServer::Receiver::Receiver(boost::asio::io_service& io_service, size_t datagram_size, size_t batch_size)
+  : socket(io_service)
+  , buffers(datagram_size * batch_size)
+  , iovecs(batch_size)
+  , headers(batch_size)
+{
+  for(size_t i = 0; i < batch_size; i++)
+  {
+    iovecs[i].iov_base = &buffers[i * datagram_size];
+    iovecs[i].iov_len  = datagram_size;
+  }
+}
+
+UDPServer::UDPServer(boost::asio::io_service& io_service, const graphite_proxy::router_ptr& router, unsigned short port, unsigned int nbr_sockets,
+                     size_t datagram_size, size_t batch_size, int receive_buffer_size)
+  : m_router(router)
   , m_port(port)
+  , m_datagram_size(datagram_size > 0 ? datagram_size : server::props::PROPERTIES_SERVER_UDP_DATAGRAM_SIZE_DEFAULT)
+  , m_batch_size(batch_size > 0 ? batch_size : 1)
 {
-  LOG_INFO(std::string("Create UDP Server on port: ") + std::to_string(port), LOG_HEADER_UDPSERVER);
+  if(nbr_sockets == 0)
+    nbr_sockets = 1;
+
+  const udp::endpoint endpoint(udp::v4(), port);
+  for(unsigned int i = 0; i < nbr_sockets; i++)
+  {
+    receiver_ptr receiver = boost::make_shared<Receiver>(io_service, m_datagram_size, m_batch_size);
+    receiver->socket.open(endpoint.protocol());
+    if(nbr_sockets > 1)
+      receiver->socket.set_option(reuse_port(true));
+    if(receive_buffer_size > 0)
+      receiver->socket.set_option(boost::asio::socket_base::receive_buffer_size(receive_buffer_size));
+    receiver->socket.bind(endpoint);
+    receiver->socket.non_blocking(true);
+    m_receivers.push_back(receiver);
+  }
+
+  LOG_INFO(std::string("Create UDP Server on port: ") + std::to_string(port) + " (" + std::to_string(nbr_sockets) + " sockets, "
+           + std::to_string(m_batch_size) + " datagrams of " + std::to_string(m_datagram_size) + " bytes per read)", LOG_HEADER_UDPSERVER);
 }
 
 UDPServer::~UDPServer()
@@ -27,31 +73,98 @@ UDPServer::~UDPServer()
 
 void UDPServer::start()
 {
-  // Post buffer
-  start_receive();
+  // Wait for incoming data on each socket
+  for(size_t i = 0; i < m_receivers.size(); i++)
+    start_receive(m_receivers[i]);
 }
 
-void UDPServer::start_receive()
+void UDPServer::start_receive(receiver_ptr receiver)
 {
-  m_socket.async_receive(boost::asio::buffer(m_buffer), 0, boost::bind(&UDPServer::handle_receive, shared_from_this(), boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred));
+  receiver->socket.async_wait(udp::socket::wait_read, boost::bind(&UDPServer::handle_receive, shared_from_this(), receiver, boost::asio::placeholders::error));
 }
 
-void UDPServer::handle_receive(const boost::system::error_code& error, size_t bytes_received)
+void UDPServer::handle_receive(receiver_ptr receiver, const boost::system::error_code& error)
 {
-  if(!error)
+  if(error)
+  {
+    // The socket has been closed
+    if(error == boost::asio::error::operation_aborted)
+      return;
+
+    LOG_ERROR(std::string("An error occurred while waiting for data: ") + error.message(), LOG_HEADER_UDPSERVER);
+    start_receive(receiver);
+    return;
+  }
+
+  const int fd = receiver->socket.native_handle();
+  for(unsigned int batch = 0; batch < UDP_MAX_BATCHES_PER_WAKEUP; batch++)
   {
+    for(size_t i = 0; i < m_batch_size; i++)
+    {
+      std::memset(&receiver->headers[i], 0, sizeof(datagram_header));
+      receiver->headers[i].msg_hdr.msg_iov    = &receiver->iovecs[i];
+      receiver->headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+#ifdef __linux__
+    // Read as many datagrams as possible with one system call
+    const int nbr_datagrams = recvmmsg(fd, &receiver->headers[0], m_batch_size, MSG_DONTWAIT, NULL);
+#else
+    // Read datagrams one by one, recvmsg sets MSG_TRUNC into msg_flags when a datagram doesn't fit
+    int nbr_datagrams = 0;
+    for(; static_cast<size_t>(nbr_datagrams) < m_batch_size; nbr_datagrams++)
+    {
+      const ssize_t received = recvmsg(fd, &receiver->headers[nbr_datagrams].msg_hdr, MSG_DONTWAIT);
+      if(received < 0)
+        break;
+      receiver->headers[nbr_datagrams].msg_len = static_cast<unsigned int>(received);
+    }
+    if(nbr_datagrams == 0)
+      nbr_datagrams = -1;
+#endif
+
+    if(nbr_datagrams < 0)
+    {
+      if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        LOG_ERROR(std::string("An error occurred while receiving data: ") + std::strerror(errno), LOG_HEADER_UDPSERVER);
+      break;
+    }
+
+    STATS_RAISE(stats::STATS_REQUESTS_INCOMING, nbr_datagrams);
+
     // Send the data to the router
-    m_router->routeMessage(std::string(m_buffer.data(), bytes_received));
+    for(int i = 0; i < nbr_datagrams; i++)
+    {
+      const datagram_header& header = receiver->headers[i];
+      const size_t length          = std::min<size_t>(header.msg_len, m_datagram_size);
+      route(static_cast<const char*>(receiver->iovecs[i].iov_base), length, (header.msg_hdr.msg_flags & MSG_TRUNC) != 0);
+    }
+
+    // The socket queue is empty
+    if(static_cast<size_t>(nbr_datagrams) < m_batch_size)
+      break;
   }
-  else
+
+  // Wait for data again
+  start_receive(receiver);
+}
+
+void UDPServer::route(const char* data, size_t length, bool truncated)
+{
+  if(truncated)
   {
-    LOG_ERROR(std::string("An error occurred while receiving data: ") + error.message(), LOG_HEADER_UDPSERVER);
+    // The last line is incomplete: only route the complete ones
+    STATS_INCREMENT(stats::STATS_REQUESTS_UDP_TRUNCATED);
+    LOG_WARNING("Datagram bigger than " + std::to_string(m_datagram_size) + " bytes truncated", LOG_HEADER_UDPSERVER);
+
+    const size_t last_line_end = std::string_view(data, length).rfind('\n');
+    if(last_line_end == std::string_view::npos)
+      return;
+    length = last_line_end;
   }
 
-  // Post buffer again
-  start_receive();
+  m_router->routeMessages(data, length);
 }
 
 } // namespace networking
 } // namespace server
-
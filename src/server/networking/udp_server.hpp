@@ -1,10 +1,15 @@
 #ifndef GRAPHITE_PROXY_UDP_SERVER_HPP
 #define GRAPHITE_PROXY_UDP_SERVER_HPP
 
+#include <properties.hpp>
+
 #include <graphite_proxy/models/router.hpp>
 #include <boost/enable_shared_from_this.hpp>
-#include <boost/array.hpp>
 #include <boost/asio.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <sys/socket.h>
+#include <vector>
 
 namespace server {
 namespace networking {
@@ -12,25 +17,48 @@ namespace networking {
 /*! UDPServer log header */
 static const std::string LOG_HEADER_UDPSERVER = "UDP_SERVER";
 
+#ifdef __linux__
+/*! Description of a received datagram, filled by recvmmsg */
+typedef struct mmsghdr datagram_header;
+#else
+/*! Description of a received datagram, with the layout of the Linux struct mmsghdr (filled by recvmsg, one datagram at a time) */
+struct datagram_header
+{
+  struct msghdr msg_hdr;  ///< Reception description, msg_flags tells whether the datagram was truncated
+  unsigned int  msg_len;  ///< Number of bytes of the datagram
+};
+#endif
+
 /*! UDPServer class defines a server that is listening to incoming Graphite packets on a specific UDP address and port.
  *  When a packet is received, the server just put it in the router queue.
  *  In order to run the UDPServer, the start method must be called before calling run() on the underlying io_service.
+ *  \note with more than one socket, each socket is bound to the same port with SO_REUSEPORT so the kernel spreads
+ *        incoming packets among them and they can be handled concurrently by the threads running the io_service.
+ *  \note when a socket becomes readable, all pending datagrams are read by batches (one recvmmsg call per batch,
+ *        one recvmsg call per datagram where recvmmsg doesn't exist) and each line of each datagram is routed as a message.
  */
 class UDPServer : public boost::enable_shared_from_this<UDPServer>
 {
   public:
 
     /*! Constructor
-     *  \param io_service The underlying boost io_service
-     *  \param router     A pointer to the router object where the incoming packets will be pushed
-     *  \param port       The UDP port on which the server is listening on (the server listens on all interfaces)
+     *  \param io_service          The underlying boost io_service
+     *  \param router              A pointer to the router object where the incoming packets will be pushed
+     *  \param port                The UDP port on which the server is listening on (the server listens on all interfaces)
+     *  \param nbr_sockets         The number of sockets listening on the port (usually one per thread running the io_service)
+     *  \param datagram_size       The maximum size of a datagram (in bytes), bigger datagrams are truncated
+     *  \param batch_size          The maximum number of datagrams read with one system call
+     *  \param receive_buffer_size The socket receive buffer size (SO_RCVBUF in bytes), 0 keeps the operating system default
      */
-    UDPServer(boost::asio::io_service& io_service, const graphite_proxy::router_ptr& router, unsigned short port);
+    UDPServer(boost::asio::io_service& io_service, const graphite_proxy::router_ptr& router, unsigned short port, unsigned int nbr_sockets = 1,
+              size_t datagram_size       = server::props::PROPERTIES_SERVER_UDP_DATAGRAM_SIZE_DEFAULT,
+              size_t batch_size          = server::props::PROPERTIES_SERVER_UDP_BATCH_SIZE_DEFAULT,
+              int    receive_buffer_size = server::props::PROPERTIES_SERVER_UDP_RECEIVE_BUFFER_DEFAULT);
 
     /*! Destructor */
     virtual ~UDPServer();
 
-    /*! Starts server listening process (by posting a buffer to receive data)
+    /*! Starts server listening process (by waiting for incoming data on each socket)
      * \note  To actually start the server listening loop the run() method must be called on the underlying io_service.
      */
     void start();
@@ -40,24 +68,51 @@ class UDPServer : public boost::enable_shared_from_this<UDPServer>
      */
     unsigned short getPort() const { return m_port; }
 
+    /*! Getter for the number of sockets listening on the port
+     *  \return the number of sockets
+     */
+    size_t getNbrSockets() const { return m_receivers.size(); }
+
   protected:
 
-    /*! Posts a buffer for incoming messages */
-    void start_receive();
+    /*! A socket listening on the server port with its own pool of reception buffers */
+    struct Receiver
+    {
+      Receiver(boost::asio::io_service& io_service, size_t datagram_size, size_t batch_size);
+
+      boost::asio::ip::udp::socket socket;   ///< UDP server socket
+      std::vector<char>            buffers;  ///< Reception buffers, one of datagram_size bytes per datagram of a batch
+      std::vector<struct iovec>    iovecs;   ///< Scatter description of each reception buffer
+      std::vector<datagram_header> headers;  ///< Received datagrams description
+    };
+
+    typedef boost::shared_ptr<Receiver> receiver_ptr;
+
+    /*! Wait for incoming data on a socket
+     *  \param receiver is the socket to wait for
+     */
+    void start_receive(receiver_ptr receiver);
+
+    /*! Reception handler, read all pending datagrams
+     *  \param  receiver The socket which has incoming data
+     *  \param  error    The error code associated with the wait operation
+     */
+    void handle_receive(receiver_ptr receiver, const boost::system::error_code& error);
 
-    /*! Packet reception handler
-     *  \param  error          The error code associated with the receive operation
-     *  \param  bytes_received The number of bytes contained in the received packet
+    /*! Route each line of a received datagram
+     *  \param data      is the datagram content
+     *  \param length    is the datagram length
+     *  \param truncated is true if the datagram was bigger than the reception buffer
      */
-    void handle_receive(const boost::system::error_code& error, size_t bytes_received);
+    void route(const char* data, size_t length, bool truncated);
 
   private:
 
-    static const size_t               m_buffer_size = 1024; ///< Size of the reception buffer (in bytes)
-    boost::array<char, m_buffer_size> m_buffer;             ///< Reception buffer
-    boost::asio::ip::udp::socket      m_socket;             ///< UDP server socket
+    std::vector<receiver_ptr>         m_receivers;          ///< UDP server sockets
     graphite_proxy::router_ptr        m_router;             ///< Pointer to the message router
     unsigned short                    m_port;               ///< Port to connect to
+    size_t                            m_datagram_size;      ///< Maximum size of a datagram (in bytes)
+    size_t                            m_batch_size;         ///< Maximum number of datagrams read at once
 };
 
 typedef boost::shared_ptr<UDPServer> udp_server_ptr;
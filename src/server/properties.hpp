@@ -22,11 +22,45 @@ static const std::string PROPERTIES_SERVER_PORT                           = "ser
 static const std::string PROPERTIES_SERVER_PORT_DEFAULT                   = "8090";
 static const std::string PROPERTIES_SERVER_UDP_PORT                       = "server.udp_port";
 static const std::string PROPERTIES_SERVER_UDP_PORT_DEFAULT               = "8091";
+static const std::string PROPERTIES_SERVER_THREADS                        = "server.threads";
+static const unsigned int PROPERTIES_SERVER_THREADS_DEFAULT               = 1; // number of threads receiving and parsing incoming messages
+static const std::string PROPERTIES_SERVER_UDP_DATAGRAM_SIZE              = "server.udp_datagram_size";
+static const unsigned int PROPERTIES_SERVER_UDP_DATAGRAM_SIZE_DEFAULT     = 8192; // in bytes, bigger datagrams are truncated
+static const std::string PROPERTIES_SERVER_UDP_BATCH_SIZE                 = "server.udp_batch_size";
+static const unsigned int PROPERTIES_SERVER_UDP_BATCH_SIZE_DEFAULT        = 64; // maximum number of datagrams read with one system call
+static const std::string PROPERTIES_SERVER_UDP_RECEIVE_BUFFER             = "server.udp_receive_buffer";
+static const unsigned int PROPERTIES_SERVER_UDP_RECEIVE_BUFFER_DEFAULT    = 0; // SO_RCVBUF in bytes, 0 keeps the operating system default
+static const std::string PROPERTIES_SERVER_COMPRESSION                    = "server.compression";
+static const std::string PROPERTIES_SERVER_COMPRESSION_DEFAULT            = "none"; // none or zlib (TCP streams sent by other proxies)
 
 // Client properties
 static const std::string PROPERTIES_CLIENT_ADDRESS                        = "client.address";
 static const std::string PROPERTIES_CLIENT_PORT                           = "client.port";
 static const std::string PROPERTIES_CLIENT_PORT_DEFAULT                   = "2003";
+static const std::string PROPERTIES_CLIENT_DESTINATIONS                   = "client.destinations";
+static const std::string PROPERTIES_CLIENT_DESTINATIONS_DEFAULT           = ""; // host:port[:instance] list, empty uses client.address and client.port
+static const std::string PROPERTIES_CLIENT_PROTOCOL                       = "client.protocol";
+static const std::string PROPERTIES_CLIENT_PROTOCOL_DEFAULT               = "plaintext"; // plaintext or pickle
+static const std::string PROPERTIES_CLIENT_COMPRESSION                    = "client.compression";
+static const std::string PROPERTIES_CLIENT_COMPRESSION_DEFAULT            = "none"; // none or zlib (the destination must decompress)
+static const std::string PROPERTIES_CLIENT_RECONNECT_MIN_DELAY            = "client.reconnect.min-delay";
+static const unsigned long PROPERTIES_CLIENT_RECONNECT_MIN_DELAY_DEFAULT  = 100; // in milliseconds
+static const std::string PROPERTIES_CLIENT_RECONNECT_MAX_DELAY            = "client.reconnect.max-delay";
+static const unsigned long PROPERTIES_CLIENT_RECONNECT_MAX_DELAY_DEFAULT  = 30000; // in milliseconds
+static const std::string PROPERTIES_CLIENT_REPLICATION_FACTOR             = "client.replication-factor";
+static const size_t PROPERTIES_CLIENT_REPLICATION_FACTOR_DEFAULT          = 1; // Number of destinations receiving each series
+static const std::string PROPERTIES_CLIENT_HEALTH_CHECK_INTERVAL          = "client.health-check.interval";
+static const unsigned long PROPERTIES_CLIENT_HEALTH_CHECK_INTERVAL_DEFAULT = 1000; // in milliseconds, 0 disables the health checks
+static const std::string PROPERTIES_CLIENT_BREAKER_FAILURES               = "client.circuit-breaker.failures";
+static const unsigned int PROPERTIES_CLIENT_BREAKER_FAILURES_DEFAULT      = 5; // Consecutive failures opening the circuit, 0 disables it
+static const std::string PROPERTIES_CLIENT_BREAKER_COOLDOWN               = "client.circuit-breaker.cooldown";
+static const unsigned long PROPERTIES_CLIENT_BREAKER_COOLDOWN_DEFAULT     = 10000; // in milliseconds
+static const std::string PROPERTIES_CLIENT_RATE_MESSAGES                  = "client.rate.messages";
+static const unsigned long PROPERTIES_CLIENT_RATE_MESSAGES_DEFAULT        = 0; // Messages per second to each destination, 0 means no limit
+static const std::string PROPERTIES_CLIENT_RATE_BYTES                     = "client.rate.bytes";
+static const unsigned long PROPERTIES_CLIENT_RATE_BYTES_DEFAULT           = 0; // Bytes per second to each destination, 0 means no limit
+static const std::string PROPERTIES_CLIENT_RATE_MAX_LATENCY               = "client.rate.max-latency";
+static const unsigned long PROPERTIES_CLIENT_RATE_MAX_LATENCY_DEFAULT     = 200; // in milliseconds, slower writes lower the rate, 0 keeps it fixed
 
 // Buffer properties
 static const std::string PROPERTIES_BUFFER_MAX_ITEMS                      = "buffer.flush.size";
@@ -35,6 +69,16 @@ static const std::string PROPERTIES_BUFFER_FLUSH_TIME                     = "buf
 static const unsigned int PROPERTIES_BUFFER_FLUSH_TIME_DEFAULT            = 5; // in seconds
 static const std::string PROPERTIES_BUFFER_DROP_OLDER                     = "buffer.drop.oldest";
 static const bool PROPERTIES_BUFFER_DROP_OLDER_DEFAULT                    = true;
+static const std::string PROPERTIES_BUFFER_FLUSH_THREADS                  = "buffer.flush.threads";
+static const unsigned int PROPERTIES_BUFFER_FLUSH_THREADS_DEFAULT         = 1; // 0 sends full buffers from the receiving threads
+static const std::string PROPERTIES_BUFFER_FLUSH_QUEUE_SIZE               = "buffer.flush.queue-size";
+static const unsigned int PROPERTIES_BUFFER_FLUSH_QUEUE_SIZE_DEFAULT      = 1024; // in full buffers
+static const std::string PROPERTIES_BUFFER_FLUSH_CHUNK_SIZE               = "buffer.flush.chunk-size";
+static const size_t PROPERTIES_BUFFER_FLUSH_CHUNK_SIZE_DEFAULT            = 1000; // Messages per batch given to the client on each flush, 0 gives all of them at once
+static const std::string PROPERTIES_BUFFER_FLUSH_BYTES                    = "buffer.flush.bytes";
+static const size_t PROPERTIES_BUFFER_FLUSH_BYTES_DEFAULT                 = 65536; // Estimated serialized size of the buffered messages triggering a flush, 0 ignores it
+static const std::string PROPERTIES_BUFFER_FLUSH_MAX_AGE                  = "buffer.flush.max-age";
+static const unsigned long PROPERTIES_BUFFER_FLUSH_MAX_AGE_DEFAULT        = 500; // in milliseconds, age of the oldest message triggering a flush, 0 ignores it
 static const std::string PROPERTIES_BUFFER_CLEANER_ACTIVATED              = "buffer.cleaning.activated";
 static const bool PROPERTIES_BUFFER_CLEANER_ACTIVATED_DEFAULT             = true;
 static const std::string PROPERTIES_BUFFER_CLEANER_TIME                   = "buffer.cleaning.time";
@@ -74,6 +118,8 @@ static const std::string PROPERTIES_ROUTER_PASSTHROUGH_SAVE_FILE          = "rou
 static const std::string PROPERTIES_ROUTER_PASSTHROUGH_SAVE_FILE_DEFAULT  = "pass_through_messages.gp";
 static const std::string PROPERTIES_ROUTER_MATHS_SAVE_FILE                = "router.maths";
 static const std::string PROPERTIES_ROUTER_MATHS_SAVE_FILE_DEFAULT        = "maths_messages.gp";
+static const std::string PROPERTIES_ROUTER_CACHE_SIZE                     = "router.cache-size";
+static const unsigned long PROPERTIES_ROUTER_CACHE_SIZE_DEFAULT           = 65536; // Number of routing decisions kept, 0 to disable the cache
 
 // Signals properties
 static const std::string PROPERTIES_SIGNALS_CURRENT_STATE_FILE            = "signals.current-state.file";
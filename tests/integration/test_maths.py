@@ -46,24 +46,24 @@ class TestServer( unittest.TestCase ):
 		logs = logs_file.read()
 
 		# Check received math message for rule 1 (by number of received messages)
-		self.assertNotEqual( logs.find("Message added: test.integration.maths.1 10.0"), -1 )
-		self.assertNotEqual( logs.find("Message added: test.integration.maths.1 2.0"), -1 )
-		self.assertNotEqual( logs.find("Message added: test.integration.maths.1 5.0"), -1 )
+		self.assertNotEqual( logs.find("Message added: test.integration.maths.1 10 "), -1 )
+		self.assertNotEqual( logs.find("Message added: test.integration.maths.1 2 "), -1 )
+		self.assertNotEqual( logs.find("Message added: test.integration.maths.1 5 "), -1 )
 		self.assertNotEqual( logs.find("Message added: test.integration.maths.1 3.3"), -1 )
-		self.assertNotEqual( logs.find("Message added: test.integration.maths.1 3.0"), -1 )
+		self.assertNotEqual( logs.find("Message added: test.integration.maths.1 3 "), -1 )
 		self.assertNotEqual( logs.find("Message added: test.integration.maths.1 1.5"), -1 )
 		self.assertNotEqual( logs.find("Message added: test.integration.maths.1 1.2"), -1 )
-		self.assertNotEqual( logs.find("Message added: test.integration.maths.1 100.0"), -1 )
+		self.assertNotEqual( logs.find("Message added: test.integration.maths.1 100 "), -1 )
 
 		# Check received math message for rule 2 (by number of spend time)
-		self.assertNotEqual( logs.find("Message added: test.integration.maths.2 10.0"), -1 )
-		self.assertNotEqual( logs.find("Message added: test.integration.maths.2 2.0"), -1 )
-		self.assertNotEqual( logs.find("Message added: test.integration.maths.2 5.0"), -1 )
+		self.assertNotEqual( logs.find("Message added: test.integration.maths.2 10 "), -1 )
+		self.assertNotEqual( logs.find("Message added: test.integration.maths.2 2 "), -1 )
+		self.assertNotEqual( logs.find("Message added: test.integration.maths.2 5 "), -1 )
 		self.assertNotEqual( logs.find("Message added: test.integration.maths.2 3.3"), -1 )
-		self.assertNotEqual( logs.find("Message added: test.integration.maths.2 3.0"), -1 )
+		self.assertNotEqual( logs.find("Message added: test.integration.maths.2 3 "), -1 )
 		self.assertNotEqual( logs.find("Message added: test.integration.maths.2 1.5"), -1 )
 		self.assertNotEqual( logs.find("Message added: test.integration.maths.2 1.2"), -1 )
-		self.assertNotEqual( logs.find("Message added: test.integration.maths.2 100.0"), -1 )
+		self.assertNotEqual( logs.find("Message added: test.integration.maths.2 100 "), -1 )
 
 		# Remove created logs file
 		os.remove(log_file_name)
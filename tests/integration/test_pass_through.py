@@ -36,7 +36,7 @@ def run_test(tester, proxy_port, is_udp):
 	receiver.stop() # Stop the server thread to be able to quit the programm properly
 
 	# Receive normal messages
-	tester.assertNotEqual( receiver.getReceivedMEssage().find("Integration.test.1 0.000000 0\nIntegration.test.1 50.000000 0\nIntegration.test.2 100.000000 0\nIntegration.test.3 9999.000000 0\n"), -1 )
+	tester.assertNotEqual( receiver.getReceivedMEssage().find("Integration.test.1 0 0\nIntegration.test.1 50 0\nIntegration.test.2 100 0\nIntegration.test.3 9999 0\n"), -1 )
 
 class TestServer( unittest.TestCase ):
 
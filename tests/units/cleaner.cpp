@@ -56,12 +56,13 @@ BOOST_AUTO_TEST_CASE( cleaner_clean_global_buffer )
   BOOST_CHECK(buffer->add( Message::createMessage("test.2 0 0") ));
 
   // Check the adding was correct
-  std::map<std::string, unsigned long> buffer_sizes = buffer->getBufferSizes();
-  BOOST_CHECK_EQUAL( buffer_sizes.at("test.2"), 2 );
+  const series_id series = SeriesTable::instance().find("test.2");
+  std::map<series_id, unsigned long> buffer_sizes = buffer->getBufferSizes();
+  BOOST_CHECK_EQUAL( buffer_sizes.at(series), 2 );
 
   // Remove messages from the buffer
-  std::vector<message_ptr> storage;
-  buffer->get("test.2", storage);
+  std::vector<Message> storage;
+  buffer->get(series, storage);
   BOOST_CHECK_EQUAL( storage.size(), 2 );
 
   // Launch some iterations
@@ -96,9 +97,9 @@ BOOST_AUTO_TEST_CASE( cleaner_clean_math_pipeline )
   cleaner.iterate();
 
   // Get remaining messages from the math pipeline. It should remain only one message the "ads_server.nani.1" one.
-  std::vector<message_ptr> target_container;
+  std::vector<Message> target_container;
   pipeline.get(target_container);
   BOOST_REQUIRE(!target_container.empty());
   BOOST_CHECK_EQUAL(target_container.size(), 1);
-  BOOST_CHECK_EQUAL(target_container[0]->getType(), "nani");
+  BOOST_CHECK_EQUAL(target_container[0].getType(), "nani");
 }
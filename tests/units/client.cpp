@@ -0,0 +1,451 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphite_proxy/models/message.hpp>
+#include <graphite_proxy/networking/client.hpp>
+#include <graphite_proxy/utils/logging/logger.hpp>
+
+#include <boost/asio.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace graphite_proxy;
+using boost::asio::ip::tcp;
+
+namespace {
+
+/*! Read a line sent by the client */
+std::string readLine( tcp::socket &socket, boost::asio::streambuf &buffer )
+{
+  boost::asio::read_until( socket, buffer, '\n' );
+  std::istream stream( &buffer );
+  std::string line;
+  std::getline( stream, line );
+  return line;
+}
+
+/*! Wait for a condition to become true
+ *  \return false if it is still false after a second
+ */
+bool waitFor( const std::function<bool ()> &condition )
+{
+  for( int i = 0; i < 100 && !condition(); i++ )
+    boost::this_thread::sleep( boost::posix_time::milliseconds( 10 ) );
+  return condition();
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE( client_persistent_connection )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  boost::asio::io_service io_service;
+  tcp::acceptor acceptor( io_service, tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+  networking::Client client( "127.0.0.1", std::to_string( acceptor.local_endpoint().port() ) );
+
+  BOOST_CHECK_EQUAL( client.isReady(), true );
+  BOOST_CHECK_EQUAL( client.isConnected(), false );
+
+  BOOST_CHECK_EQUAL( client.send( std::vector<Message>( 1, Message( "client.test", 1, 10 ) ) ), true );
+  BOOST_CHECK_EQUAL( client.isConnected(), true );
+
+  tcp::socket server_socket( io_service );
+  boost::asio::streambuf buffer;
+  acceptor.accept( server_socket );
+  BOOST_CHECK_EQUAL( readLine( server_socket, buffer ), "client.test 1 10" );
+
+  // The same connection is used by the next send
+  BOOST_CHECK_EQUAL( client.send( std::vector<Message>( 1, Message( "client.test", 2, 20 ) ) ), true );
+  BOOST_CHECK_EQUAL( readLine( server_socket, buffer ), "client.test 2 20" );
+
+  // The server closes the connection, the client connects again
+  server_socket.close();
+  boost::this_thread::sleep( boost::posix_time::milliseconds( 50 ) );
+
+  BOOST_CHECK_EQUAL( client.send( std::vector<Message>( 1, Message( "client.test", 3, 30 ) ) ), true );
+  BOOST_CHECK_EQUAL( client.isConnected(), true );
+
+  tcp::socket new_server_socket( io_service );
+  boost::asio::streambuf new_buffer;
+  acceptor.accept( new_server_socket );
+  BOOST_CHECK_EQUAL( readLine( new_server_socket, new_buffer ), "client.test 3 30" );
+}
+
+BOOST_AUTO_TEST_CASE( client_reconnection_delay )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  boost::asio::io_service io_service;
+  tcp::acceptor acceptor( io_service, tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+  const unsigned short port = acceptor.local_endpoint().port();
+  acceptor.close();
+
+  // Nothing is listening anymore, the connection fails
+  networking::Client client( "127.0.0.1", std::to_string( port ), 200, 1000 );
+  BOOST_CHECK_EQUAL( client.send( std::vector<Message>( 1, Message( "client.test", 1, 10 ) ) ), false );
+  BOOST_CHECK_EQUAL( client.isConnected(), false );
+
+  // The server is back, but the client waits for the reconnection delay
+  tcp::acceptor new_acceptor( io_service, tcp::endpoint( boost::asio::ip::address_v4::loopback(), port ) );
+  BOOST_CHECK_EQUAL( client.send( std::vector<Message>( 1, Message( "client.test", 2, 20 ) ) ), false );
+
+  boost::this_thread::sleep( boost::posix_time::milliseconds( 250 ) );
+  BOOST_CHECK_EQUAL( client.send( std::vector<Message>( 1, Message( "client.test", 3, 30 ) ) ), true );
+  BOOST_CHECK_EQUAL( client.isConnected(), true );
+}
+
+BOOST_AUTO_TEST_CASE( client_asynchronous_send )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  boost::asio::io_service io_service;
+  tcp::acceptor acceptor( io_service, tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+  networking::Client client( "127.0.0.1", std::to_string( acceptor.local_endpoint().port() ) );
+
+  // Queue several batches, they are written in order
+  boost::mutex mutex;
+  size_t sent_messages = 0;
+  for( int i = 0; i < 10; i++ )
+  {
+    std::vector<Message> messages( 2, Message( "client.async", i, 10 ) );
+    BOOST_CHECK_EQUAL( client.sendAsync( messages, [&]( bool sent, std::vector<Message> &batch )
+    {
+      boost::mutex::scoped_lock lock( mutex );
+      if( sent )
+        sent_messages += batch.size();
+    } ), true );
+    BOOST_CHECK_EQUAL( messages.empty(), true );
+  }
+
+  tcp::socket server_socket( io_service );
+  boost::asio::streambuf buffer;
+  acceptor.accept( server_socket );
+  for( int i = 0; i < 10; i++ )
+  {
+    BOOST_CHECK_EQUAL( readLine( server_socket, buffer ), "client.async " + std::to_string( i ) + " 10" );
+    BOOST_CHECK_EQUAL( readLine( server_socket, buffer ), "client.async " + std::to_string( i ) + " 10" );
+  }
+
+  client.stop();
+  BOOST_CHECK_EQUAL( sent_messages, 20 );
+
+  // A stopped client doesn't take messages anymore
+  std::vector<Message> messages( 1, Message( "client.async", 1, 10 ) );
+  BOOST_CHECK_EQUAL( client.sendAsync( messages, networking::Client::completion_handler() ), false );
+  BOOST_CHECK_EQUAL( messages.size(), 1 );
+}
+
+BOOST_AUTO_TEST_CASE( client_parse_destinations )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  std::vector<networking::Destination> destinations;
+  BOOST_CHECK_EQUAL( networking::Client::parseDestinations( "127.0.0.1:2003:a, 10.0.0.2:2103", destinations ), true );
+  BOOST_CHECK_EQUAL( destinations.size(), 2 );
+  BOOST_CHECK_EQUAL( destinations[0].host, "127.0.0.1" );
+  BOOST_CHECK_EQUAL( destinations[0].port, "2003" );
+  BOOST_CHECK_EQUAL( destinations[0].instance, "a" );
+  BOOST_CHECK_EQUAL( destinations[1].host, "10.0.0.2" );
+  BOOST_CHECK_EQUAL( destinations[1].port, "2103" );
+  BOOST_CHECK_EQUAL( destinations[1].instance, "" );
+
+  // The protocol is given before the address, or is the default one
+  destinations.clear();
+  BOOST_CHECK_EQUAL( networking::Client::parseDestinations( "pickle://127.0.0.1:2004:a 10.0.0.2:2003", destinations, networking::Protocol::PLAINTEXT ), true );
+  BOOST_CHECK_EQUAL( destinations.size(), 2 );
+  BOOST_CHECK_EQUAL( destinations[0].host, "127.0.0.1" );
+  BOOST_CHECK_EQUAL( destinations[0].instance, "a" );
+  BOOST_CHECK( destinations[0].protocol == networking::Protocol::PICKLE );
+  BOOST_CHECK( destinations[1].protocol == networking::Protocol::PLAINTEXT );
+
+  destinations.clear();
+  BOOST_CHECK_EQUAL( networking::Client::parseDestinations( "json://127.0.0.1:2004", destinations ), false );
+
+  destinations.clear();
+  BOOST_CHECK_EQUAL( networking::Client::parseDestinations( "127.0.0.1", destinations ), false );
+  BOOST_CHECK_EQUAL( networking::Client::parseDestinations( "", destinations ), false );
+}
+
+BOOST_AUTO_TEST_CASE( client_several_destinations )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  boost::asio::io_service io_service;
+  tcp::acceptor acceptor_a( io_service, tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+  tcp::acceptor acceptor_b( io_service, tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+
+  std::vector<networking::Destination> destinations( 2 );
+  destinations[0].host = "127.0.0.1"; destinations[0].port = std::to_string( acceptor_a.local_endpoint().port() ); destinations[0].instance = "a";
+  destinations[1].host = "127.0.0.1"; destinations[1].port = std::to_string( acceptor_b.local_endpoint().port() ); destinations[1].instance = "b";
+  networking::Client client( destinations );
+  BOOST_CHECK_EQUAL( client.getNbrDestinations(), 2 );
+
+  // "servers.web1.load" belongs to the instance a and "servers.web2.load" to the instance b (see the hash ring tests)
+  std::vector<Message> messages;
+  messages.push_back( Message( "servers.web1.load", 1, 10 ) );
+  messages.push_back( Message( "servers.web2.load", 2, 10 ) );
+  messages.push_back( Message( "servers.web1.load", 3, 20 ) );
+  BOOST_CHECK_EQUAL( client.getDestination( messages[0].getSeries() ), 0 );
+  BOOST_CHECK_EQUAL( client.getDestination( messages[1].getSeries() ), 1 );
+  BOOST_CHECK_EQUAL( client.send( messages ), true );
+
+  tcp::socket socket_a( io_service ), socket_b( io_service );
+  boost::asio::streambuf buffer_a, buffer_b;
+  acceptor_a.accept( socket_a );
+  acceptor_b.accept( socket_b );
+  BOOST_CHECK_EQUAL( readLine( socket_a, buffer_a ), "servers.web1.load 1 10" );
+  BOOST_CHECK_EQUAL( readLine( socket_a, buffer_a ), "servers.web1.load 3 20" );
+  BOOST_CHECK_EQUAL( readLine( socket_b, buffer_b ), "servers.web2.load 2 10" );
+}
+
+BOOST_AUTO_TEST_CASE( client_replication_and_failover )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  boost::asio::io_service io_service;
+  tcp::acceptor acceptor_a( io_service, tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+  tcp::acceptor acceptor_b( io_service, tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+  const unsigned short port_b = acceptor_b.local_endpoint().port();
+  acceptor_b.close();
+
+  std::vector<networking::Destination> destinations( 2 );
+  destinations[0].host = "127.0.0.1"; destinations[0].port = std::to_string( acceptor_a.local_endpoint().port() ); destinations[0].instance = "a";
+  destinations[1].host = "127.0.0.1"; destinations[1].port = std::to_string( port_b ); destinations[1].instance = "b";
+  networking::Client client( destinations, 2, 100, 1000, networking::CLIENT_DEFAULT_MAX_PENDING_BATCHES, 50 );
+  BOOST_CHECK_EQUAL( client.getReplicationFactor(), 2 );
+  BOOST_CHECK_EQUAL( client.getNbrHealthyDestinations(), 2 );
+
+  // "servers.web1.load" goes to a, its copy to b fails
+  BOOST_CHECK_EQUAL( client.send( std::vector<Message>( 1, Message( "servers.web1.load", 1, 10 ) ) ), true );
+  boost::this_thread::sleep( boost::posix_time::milliseconds( 50 ) );
+  BOOST_CHECK_EQUAL( client.getNbrHealthyDestinations(), 1 );
+
+  // b is unhealthy, "servers.web2.load" goes to a instead
+  std::vector<Message> messages( 1, Message( "servers.web2.load", 2, 10 ) );
+  BOOST_CHECK_EQUAL( client.getDestination( messages[0].getSeries() ), 0 );
+  BOOST_CHECK_EQUAL( client.send( messages ), true );
+
+  tcp::socket socket_a( io_service );
+  boost::asio::streambuf buffer_a;
+  acceptor_a.accept( socket_a );
+  BOOST_CHECK_EQUAL( readLine( socket_a, buffer_a ), "servers.web1.load 1 10" );
+  BOOST_CHECK_EQUAL( readLine( socket_a, buffer_a ), "servers.web2.load 2 10" );
+
+  // b is back, the health checks find it without sending anything
+  tcp::acceptor new_acceptor_b( io_service, tcp::endpoint( boost::asio::ip::address_v4::loopback(), port_b ) );
+  boost::this_thread::sleep( boost::posix_time::milliseconds( 400 ) );
+  BOOST_CHECK_EQUAL( client.getNbrHealthyDestinations(), 2 );
+  BOOST_CHECK_EQUAL( client.getDestination( messages[0].getSeries() ), 1 );
+
+  // "servers.web2.load" goes to b again, and its copy to a
+  BOOST_CHECK_EQUAL( client.send( messages ), true );
+
+  tcp::socket socket_b( io_service );
+  boost::asio::streambuf buffer_b;
+  new_acceptor_b.accept( socket_b );
+  BOOST_CHECK_EQUAL( readLine( socket_b, buffer_b ), "servers.web2.load 2 10" );
+  BOOST_CHECK_EQUAL( readLine( socket_a, buffer_a ), "servers.web2.load 2 10" );
+}
+
+BOOST_AUTO_TEST_CASE( client_replica_reroute )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  boost::asio::io_service io_service;
+  std::vector<boost::shared_ptr<tcp::acceptor>> acceptors;
+  std::vector<networking::Destination> destinations( 3 );
+  for( size_t i = 0; i < destinations.size(); i++ )
+  {
+    acceptors.push_back( boost::make_shared<tcp::acceptor>( io_service, tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) ) );
+    destinations[i].host     = "127.0.0.1";
+    destinations[i].port     = std::to_string( acceptors[i]->local_endpoint().port() );
+    destinations[i].instance = std::string( 1, 'a' + i );
+  }
+  networking::Client client( destinations, 2, 100, 1000, networking::CLIENT_DEFAULT_MAX_PENDING_BATCHES, 50 );
+
+  std::vector<Message> messages( 1, Message( "servers.web1.load", 1, 10 ) );
+  std::vector<size_t> nodes;
+  client.getDestinations( messages[0].getSeries(), nodes );
+  BOOST_REQUIRE_EQUAL( nodes.size(), 2 );
+  const size_t spare = 3 - nodes[0] - nodes[1];
+
+  // The replica is down, its copy goes to the third node instead of being lost
+  acceptors[nodes[1]]->close();
+  BOOST_CHECK_EQUAL( client.send( messages ), true );
+
+  tcp::socket socket_primary( io_service ), socket_spare( io_service );
+  boost::asio::streambuf buffer_primary, buffer_spare;
+  acceptors[nodes[0]]->accept( socket_primary );
+  acceptors[spare]->accept( socket_spare );
+  BOOST_CHECK_EQUAL( readLine( socket_primary, buffer_primary ), "servers.web1.load 1 10" );
+  BOOST_CHECK_EQUAL( readLine( socket_spare, buffer_spare ), "servers.web1.load 1 10" );
+}
+
+BOOST_AUTO_TEST_CASE( client_destroyed_with_pending_replicas )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  boost::asio::io_service io_service;
+  std::vector<boost::shared_ptr<tcp::acceptor>> acceptors;
+  std::vector<networking::Destination> destinations( 2 );
+  for( size_t i = 0; i < destinations.size(); i++ )
+  {
+    acceptors.push_back( boost::make_shared<tcp::acceptor>( io_service, tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) ) );
+    destinations[i].host     = "127.0.0.1";
+    destinations[i].port     = std::to_string( acceptors[i]->local_endpoint().port() );
+    destinations[i].instance = std::string( 1, 'a' + i );
+  }
+
+  // The rate keeps the batches waiting, the client is destroyed without being stopped
+  size_t failed = 0;
+  {
+    networking::Client client( destinations, 2 );
+    client.setRateLimit( 1, 0, 0 );
+    for( int i = 0; i < 3; i++ )
+    {
+      std::vector<Message> messages( 1, Message( "client.pending", i, 10 ) );
+      BOOST_CHECK( client.sendAsync( messages, [&failed]( bool sent, std::vector<Message> &messages ) { if( !sent ) failed += messages.size(); } ) );
+    }
+  }
+
+  // The pending batches are completed as failed, their copies are not rerouted by the destroyed client
+  BOOST_CHECK_GE( failed, 1 );
+}
+
+BOOST_AUTO_TEST_CASE( connection_buffer_pool )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  boost::asio::io_service io_service;
+  tcp::acceptor acceptor( io_service, tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+  networking::Connection connection( "127.0.0.1", std::to_string( acceptor.local_endpoint().port() ), 100, 1000, 1, 0 );
+  BOOST_CHECK_EQUAL( connection.getFreeBuffers(), 0 );
+
+  // A written batch gives back its buffer with its capacity, the next batch reuses it once cleared
+  BOOST_CHECK( connection.send( std::vector<Message>( 1, Message( "pool.first", 1, 10 ) ) ) );
+  BOOST_REQUIRE( waitFor( [&connection]() { return connection.getFreeBuffers() == 1; } ) );
+  BOOST_CHECK_GE( connection.getFreeBuffersBytes(), std::string( "pool.first 1 10\n" ).size() );
+  BOOST_CHECK( connection.send( std::vector<Message>( 1, Message( "pool.second", 2, 10 ) ) ) );
+  BOOST_REQUIRE( waitFor( [&connection]() { return connection.getFreeBuffers() == 1; } ) );
+
+  tcp::socket server_socket( io_service );
+  boost::asio::streambuf buffer;
+  acceptor.accept( server_socket );
+  BOOST_CHECK_EQUAL( readLine( server_socket, buffer ), "pool.first 1 10" );
+  BOOST_CHECK_EQUAL( readLine( server_socket, buffer ), "pool.second 2 10" );
+
+  // The rate keeps the next batch waiting with the buffer, the queue is then full
+  connection.setRateLimit( 1, 0, 0 );
+  BOOST_CHECK( connection.send( std::vector<Message>( 10, Message( "pool.third", 3, 10 ) ) ) );
+  BOOST_REQUIRE( waitFor( [&connection]() { return connection.getFreeBuffers() == 1; } ) );
+  std::vector<Message> waiting( 1, Message( "pool.waiting", 4, 10 ) );
+  BOOST_CHECK( connection.sendAsync( waiting, networking::Connection::completion_handler() ) );
+  BOOST_CHECK_EQUAL( connection.getFreeBuffers(), 0 );
+
+  // A refused batch gives back its buffer
+  std::vector<Message> refused( 1, Message( "pool.refused", 5, 10 ) );
+  BOOST_CHECK( !connection.sendAsync( refused, networking::Connection::completion_handler() ) );
+  BOOST_CHECK_EQUAL( refused.size(), 1 );
+  BOOST_CHECK_EQUAL( connection.getFreeBuffers(), 1 );
+}
+
+BOOST_AUTO_TEST_CASE( connection_buffer_pool_bounds )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  // The server reads everything
+  boost::asio::io_service io_service;
+  tcp::acceptor acceptor( io_service, tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+  boost::thread reader( [&acceptor, &io_service]()
+  {
+    tcp::socket socket( io_service );
+    acceptor.accept( socket );
+    char data[65536];
+    boost::system::error_code error;
+    while( !error )
+      socket.read_some( boost::asio::buffer( data ), error );
+  } );
+  networking::Connection connection( "127.0.0.1", std::to_string( acceptor.local_endpoint().port() ) );
+
+  // A batch bigger than the memory kept is freed once written
+  const std::vector<Message> big( 100000, Message( std::string( 100, 'x' ), 1, 10 ) );
+  BOOST_CHECK( connection.send( big ) );
+  boost::this_thread::sleep( boost::posix_time::milliseconds( 50 ) );
+  BOOST_CHECK_EQUAL( connection.getFreeBuffers(), 0 );
+  BOOST_CHECK_EQUAL( connection.getFreeBuffersBytes(), 0 );
+
+  // A burst of batches keeps a bounded number of buffers
+  for( int i = 0; i < 300; i++ )
+  {
+    std::vector<Message> messages( 100, Message( "pool.burst", i, 10 ) );
+    BOOST_CHECK( connection.sendAsync( messages, networking::Connection::completion_handler() ) );
+  }
+  BOOST_REQUIRE( waitFor( [&connection]() { return connection.getPendingBatches() == 0; } ) );
+  boost::this_thread::sleep( boost::posix_time::milliseconds( 50 ) );
+  BOOST_CHECK_GT( connection.getFreeBuffers(), 0 );
+  BOOST_CHECK_LE( connection.getFreeBuffers(), networking::CONNECTION_MAX_FREE_BUFFERS );
+  BOOST_CHECK_LE( connection.getFreeBuffersBytes(), networking::CONNECTION_MAX_FREE_BUFFERS_BYTES );
+
+  connection.stop();
+  reader.join();
+}
+
+BOOST_AUTO_TEST_CASE( client_circuit_breaker )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  boost::asio::io_service io_service;
+  tcp::acceptor acceptor( io_service, tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+  const unsigned short port = acceptor.local_endpoint().port();
+  acceptor.close();
+
+  // No reconnection delay, each send attempts a connection until the circuit opens
+  networking::Client client( "127.0.0.1", std::to_string( port ), 0, 0, networking::CLIENT_DEFAULT_MAX_PENDING_BATCHES, 0 );
+  client.setCircuitBreaker( 3, 300 );
+  for( int i = 0; i < 3; i++ )
+    BOOST_CHECK_EQUAL( client.send( std::vector<Message>( 1, Message( "client.test", i, 10 ) ) ), false );
+  BOOST_CHECK_EQUAL( client.getNbrHealthyDestinations(), 0 );
+
+  // The circuit is open, messages are refused even if the server is back
+  tcp::acceptor new_acceptor( io_service, tcp::endpoint( boost::asio::ip::address_v4::loopback(), port ) );
+  std::vector<Message> messages( 1, Message( "client.test", 3, 10 ) );
+  BOOST_CHECK_EQUAL( client.sendAsync( messages, networking::Client::completion_handler() ), false );
+  BOOST_CHECK_EQUAL( messages.size(), 1 );
+
+  // Once the cooldown is elapsed, messages are sent again
+  boost::this_thread::sleep( boost::posix_time::milliseconds( 350 ) );
+  BOOST_CHECK_EQUAL( client.send( messages ), true );
+  BOOST_CHECK_EQUAL( client.getNbrHealthyDestinations(), 1 );
+}
+
+BOOST_AUTO_TEST_CASE( client_rate_limit )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  boost::asio::io_service io_service;
+  tcp::acceptor acceptor( io_service, tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+  networking::Client client( "127.0.0.1", std::to_string( acceptor.local_endpoint().port() ) );
+
+  // 100 messages per second: the bucket holds 10 messages, once in debt each batch of 10 waits 100 ms
+  client.setRateLimit( 100, 0, 0 );
+  const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  for( int i = 0; i < 5; i++ )
+  {
+    std::vector<Message> messages( 10, Message( "client.rate", i, 10 ) );
+    BOOST_CHECK_EQUAL( client.sendAsync( messages, networking::Client::completion_handler() ), true );
+  }
+
+  tcp::socket server_socket( io_service );
+  boost::asio::streambuf buffer;
+  acceptor.accept( server_socket );
+  for( int i = 0; i < 50; i++ )
+    BOOST_CHECK_EQUAL( readLine( server_socket, buffer ), "client.rate " + std::to_string( i / 10 ) + " 10" );
+
+  const long elapsed = ( boost::posix_time::microsec_clock::universal_time() - start ).total_milliseconds();
+  BOOST_CHECK_GE( elapsed, 250 );
+  client.stop();
+}
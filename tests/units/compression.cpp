@@ -0,0 +1,61 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphite_proxy/networking/compression.hpp>
+
+#include <string>
+
+using namespace graphite_proxy;
+
+BOOST_AUTO_TEST_CASE( compression_names )
+{
+  networking::Compression compression;
+  BOOST_CHECK_EQUAL( networking::Compressor::parse( "zlib", compression ), true );
+  BOOST_CHECK( compression == networking::Compression::ZLIB );
+  BOOST_CHECK_EQUAL( networking::Compressor::parse( "none", compression ), true );
+  BOOST_CHECK( compression == networking::Compression::NONE );
+  BOOST_CHECK_EQUAL( networking::Compressor::parse( "lz4", compression ), false );
+}
+
+BOOST_AUTO_TEST_CASE( compression_stream )
+{
+  std::string batch;
+  for( int i = 0; i < 1000; i++ )
+    batch += "servers.web" + std::to_string( i % 10 ) + ".cpu.load " + std::to_string( i ) + " 1500000000\n";
+
+  // Each flushed write is decompressed as soon as it is received
+  networking::Compressor compressor;
+  networking::Decompressor decompressor;
+  std::string compressed, decompressed;
+  BOOST_CHECK_EQUAL( compressor.compress( batch, compressed ), true );
+  BOOST_CHECK_EQUAL( compressor.flush( compressed ), true );
+  BOOST_CHECK( compressed.size() * 5 < batch.size() );
+  BOOST_CHECK_EQUAL( decompressor.decompress( compressed.data(), compressed.size(), decompressed ), true );
+  BOOST_CHECK( decompressed == batch );
+
+  // The dictionary is kept from one write to the other, received data may be split anywhere
+  const size_t first_size = compressed.size();
+  compressed.clear();
+  decompressed.clear();
+  BOOST_CHECK_EQUAL( compressor.compress( batch, compressed ), true );
+  BOOST_CHECK_EQUAL( compressor.flush( compressed ), true );
+  BOOST_CHECK( compressed.size() < first_size );
+  BOOST_CHECK_EQUAL( decompressor.decompress( compressed.data(), 10, decompressed ), true );
+  BOOST_CHECK_EQUAL( decompressor.decompress( compressed.data() + 10, compressed.size() - 10, decompressed ), true );
+  BOOST_CHECK( decompressed == batch );
+
+  // A reset compressor starts a new stream, only a new decompressor can read it
+  compressor.reset();
+  compressed.clear();
+  decompressed.clear();
+  BOOST_CHECK_EQUAL( compressor.compress( batch, compressed ), true );
+  BOOST_CHECK_EQUAL( compressor.flush( compressed ), true );
+
+  networking::Decompressor new_decompressor;
+  BOOST_CHECK_EQUAL( new_decompressor.decompress( compressed.data(), compressed.size(), decompressed ), true );
+  BOOST_CHECK( decompressed == batch );
+
+  // Not a zlib stream
+  networking::Decompressor bad_decompressor;
+  decompressed.clear();
+  BOOST_CHECK_EQUAL( bad_decompressor.decompress( batch.data(), batch.size(), decompressed ), false );
+}
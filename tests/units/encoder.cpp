@@ -0,0 +1,65 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphite_proxy/models/message.hpp>
+#include <graphite_proxy/networking/encoder.hpp>
+#include <graphite_proxy/utils/logging/logger.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace graphite_proxy;
+
+BOOST_AUTO_TEST_CASE( encoder_protocols )
+{
+  networking::Protocol protocol;
+  BOOST_CHECK_EQUAL( networking::encoder::parseProtocol( "pickle", protocol ), true );
+  BOOST_CHECK( protocol == networking::Protocol::PICKLE );
+  BOOST_CHECK_EQUAL( networking::encoder::parseProtocol( "plaintext", protocol ), true );
+  BOOST_CHECK( protocol == networking::Protocol::PLAINTEXT );
+  BOOST_CHECK_EQUAL( networking::encoder::parseProtocol( "json", protocol ), false );
+
+  BOOST_CHECK_EQUAL( networking::encoder::toString( networking::Protocol::PICKLE ), "pickle" );
+}
+
+BOOST_AUTO_TEST_CASE( encoder_plaintext )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  std::vector<Message> messages;
+  messages.push_back( Message( "encoder.a", 1.5, 100 ) );
+  messages.push_back( Message( "encoder.b", 2, 200 ) );
+
+  std::string output;
+  networking::encoder::encode( networking::Protocol::PLAINTEXT, messages, output );
+  BOOST_CHECK_EQUAL( output, "encoder.a 1.5 100\nencoder.b 2 200\n" );
+}
+
+BOOST_AUTO_TEST_CASE( encoder_pickle )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  std::string output;
+  networking::encoder::encode( networking::Protocol::PICKLE, std::vector<Message>( 1, Message( "a.b", 1.5, 100 ) ), output );
+
+  // pickle.loads() gives [('a.b', (100, 1.5))]
+  const std::string expected( "\x00\x00\x00\x1e"                  // Payload length
+                              "\x80\x02]("                        // Protocol 2, list, mark
+                              "X\x03\x00\x00\x00" "a.b"           // Name
+                              "J\x64\x00\x00\x00"                 // Timestamp
+                              "G\x3f\xf8\x00\x00\x00\x00\x00\x00" // Value
+                              "\x86\x86"                          // Tuples
+                              "e.", 34 );                         // Appends, stop
+  BOOST_CHECK_EQUAL( output.size(), expected.size() );
+  BOOST_CHECK( output == expected );
+
+  // Big batches are split into several payloads
+  output.clear();
+  networking::encoder::encodePickle( std::vector<Message>( networking::encoder::PICKLE_MAX_MESSAGES_PER_PAYLOAD + 1, Message( "a.b", 1.5, 100 ) ), output );
+
+  const size_t message_size = 24;
+  const size_t first_length = 6 + networking::encoder::PICKLE_MAX_MESSAGES_PER_PAYLOAD * message_size;
+  BOOST_CHECK_EQUAL( output.size(), 4 + first_length + 4 + 6 + message_size );
+  BOOST_CHECK_EQUAL( static_cast<unsigned char>( output[2] ), ( first_length >> 8 ) & 0xFF );
+  BOOST_CHECK_EQUAL( static_cast<unsigned char>( output[3] ), first_length & 0xFF );
+  BOOST_CHECK_EQUAL( static_cast<unsigned char>( output[4 + first_length + 3] ), 6 + message_size );
+}
@@ -0,0 +1,137 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphite_proxy/models/message.hpp>
+#include <graphite_proxy/models/buffers/flush_queue.hpp>
+#include <graphite_proxy/models/buffers/global_buffer.hpp>
+
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <vector>
+
+using namespace graphite_proxy;
+
+namespace {
+
+/*! Keep the messages given back by a flush queue */
+struct FailedMessages
+{
+  void add( series_id, std::vector<Message> &messages )
+  {
+    boost::mutex::scoped_lock lock( mutex );
+    result.insert( result.end(), messages.begin(), messages.end() );
+  }
+
+  size_t size()
+  {
+    boost::mutex::scoped_lock lock( mutex );
+    return result.size();
+  }
+
+  std::vector<Message> result;
+  boost::mutex         mutex;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE( flush_queue_bounded )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  networking::client_ptr client = boost::make_shared<networking::Client>( "127.0.0.1", "1" );
+  FailedMessages failed;
+  FlushQueue queue( client, 2, boost::bind( &FailedMessages::add, &failed, _1, _2 ) );
+  const series_id series = SeriesTable::instance().intern( "flush.queue.1" );
+
+  std::vector<Message> messages( 3, Message( series, 1, 10 ) );
+  BOOST_CHECK_EQUAL( queue.push( series, messages ), true );
+  BOOST_CHECK_EQUAL( messages.size(), 0 );
+
+  messages.assign( 3, Message( series, 2, 20 ) );
+  BOOST_CHECK_EQUAL( queue.push( series, messages ), true );
+  BOOST_CHECK_EQUAL( queue.size(), 2 );
+
+  // The queue is full, the messages are left to the caller
+  messages.assign( 3, Message( series, 3, 30 ) );
+  BOOST_CHECK_EQUAL( queue.push( series, messages ), false );
+  BOOST_CHECK_EQUAL( messages.size(), 3 );
+  BOOST_CHECK_EQUAL( queue.size(), 2 );
+
+  // Batches not sent are given back when the queue stops
+  queue.stop();
+  BOOST_CHECK_EQUAL( queue.size(), 0 );
+  BOOST_CHECK_EQUAL( failed.size(), 6 );
+  BOOST_CHECK_EQUAL( failed.result[0].getValue(), 1 );
+  BOOST_CHECK_EQUAL( failed.result[5].getValue(), 2 );
+
+  BOOST_CHECK_EQUAL( queue.push( series, messages ), false );
+}
+
+BOOST_AUTO_TEST_CASE( flush_queue_send_failure )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  // Nothing is listening on this port, the sender threads can't send anything
+  networking::client_ptr client = boost::make_shared<networking::Client>( "127.0.0.1", "1" );
+  FailedMessages failed;
+  FlushQueue queue( client, 10, boost::bind( &FailedMessages::add, &failed, _1, _2 ) );
+  const series_id series = SeriesTable::instance().intern( "flush.queue.2" );
+
+  queue.start( 2 );
+  BOOST_CHECK_EQUAL( queue.getNbrThreads(), 2 );
+
+  for( int i = 0; i < 4; i++ )
+  {
+    std::vector<Message> messages( 2, Message( series, i, 10 ) );
+    BOOST_CHECK_EQUAL( queue.push( series, messages ), true );
+  }
+
+  for( int i = 0; i < 500 && failed.size() < 8; i++ )
+    boost::this_thread::sleep( boost::posix_time::milliseconds( 10 ) );
+
+  queue.stop();
+  BOOST_CHECK_EQUAL( failed.size(), 8 );
+  BOOST_CHECK_EQUAL( queue.size(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( global_buffer_flush_queue )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  networking::client_ptr client = boost::make_shared<networking::Client>( "127.0.0.1", "1" );
+  global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 3, true, client );
+  buffer->startFlushQueue( 1 );
+
+  BOOST_CHECK_EQUAL( buffer->add( Message("flush.queue.3", 1, 10) ), true );
+  BOOST_CHECK_EQUAL( buffer->add( Message("flush.queue.3", 2, 20) ), true );
+  BOOST_CHECK_EQUAL( buffer->add( Message("flush.queue.3", 3, 30) ), true );
+
+  // The full buffer is handed to the flush queue, its messages come back once the queue and the client are stopped
+  buffer->stopFlushQueue();
+  client->stop();
+  BOOST_CHECK_EQUAL( buffer->getFlushQueueDepth(), 0 );
+
+  std::vector<Message> messages;
+  buffer->get( SeriesTable::instance().find( "flush.queue.3" ), messages );
+  BOOST_CHECK_EQUAL( messages.size(), 3 );
+}
+
+BOOST_AUTO_TEST_CASE( global_buffer_without_flush_queue )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  networking::client_ptr client = boost::make_shared<networking::Client>( "127.0.0.1", "1" );
+  global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 2, true, client );
+
+  // The full buffer is queued to the client, its messages come back into the buffer once their write has failed
+  BOOST_CHECK_EQUAL( buffer->add( Message("flush.direct.2", 1, 10) ), true );
+  BOOST_CHECK_EQUAL( buffer->add( Message("flush.direct.2", 2, 20) ), true );
+  client->stop();
+
+  std::vector<Message> messages;
+  buffer->get( SeriesTable::instance().find( "flush.direct.2" ), messages );
+  BOOST_REQUIRE_EQUAL( messages.size(), 2 );
+  BOOST_CHECK_EQUAL( messages[0].getValue(), 1 );
+  BOOST_CHECK_EQUAL( messages[1].getValue(), 2 );
+}
@@ -0,0 +1,63 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphite_proxy/networking/hash_ring.hpp>
+
+using namespace graphite_proxy;
+
+BOOST_AUTO_TEST_CASE( hash_ring_position )
+{
+  // First 4 hexadecimal digits of md5("abc") = 900150983cd24fb0d6963f7d28e17f72
+  BOOST_CHECK_EQUAL( networking::HashRing::position( "abc" ), 0x9001 );
+}
+
+BOOST_AUTO_TEST_CASE( hash_ring_carbon_compatibility )
+{
+  networking::HashRing ring;
+  BOOST_CHECK_EQUAL( ring.getNode( "any.metric" ), 0 );
+
+  ring.addNode( "127.0.0.1", "a", 0 );
+  ring.addNode( "127.0.0.1", "b", 1 );
+  ring.addNode( "10.0.0.2", "", 2 );
+  BOOST_CHECK_EQUAL( ring.size(), 300 );
+
+  // Nodes chosen by carbon-relay for the destinations 127.0.0.1:2004:a, 127.0.0.1:2104:b and 10.0.0.2:2004
+  BOOST_CHECK_EQUAL( ring.getNode( "carbon.agents.a.cpuUsage" ), 0 );
+  BOOST_CHECK_EQUAL( ring.getNode( "servers.web1.load" ), 0 );
+  BOOST_CHECK_EQUAL( ring.getNode( "servers.web2.load" ), 1 );
+  BOOST_CHECK_EQUAL( ring.getNode( "test.1" ), 1 );
+  BOOST_CHECK_EQUAL( ring.getNode( "a.b.c" ), 2 );
+  BOOST_CHECK_EQUAL( ring.getNode( "foo" ), 0 );
+  BOOST_CHECK_EQUAL( ring.getNode( "bar.baz" ), 0 );
+  BOOST_CHECK_EQUAL( ring.getNode( "x" ), 2 );
+}
+
+BOOST_AUTO_TEST_CASE( hash_ring_replication )
+{
+  networking::HashRing ring;
+  ring.addNode( "127.0.0.1", "a", 0 );
+  ring.addNode( "127.0.0.1", "b", 1 );
+  ring.addNode( "10.0.0.2", "", 2 );
+  BOOST_CHECK_EQUAL( ring.getNbrNodes(), 3 );
+
+  // Same order as carbon-relay get_nodes()
+  std::vector<size_t> nodes;
+  ring.getNodes( "servers.web2.load", 3, nodes );
+  BOOST_CHECK_EQUAL( nodes.size(), 3 );
+  BOOST_CHECK_EQUAL( nodes[0], 1 );
+  BOOST_CHECK_EQUAL( nodes[1], 0 );
+  BOOST_CHECK_EQUAL( nodes[2], 2 );
+
+  nodes.clear();
+  ring.getNodes( "test.1", 2, nodes );
+  BOOST_CHECK_EQUAL( nodes.size(), 2 );
+  BOOST_CHECK_EQUAL( nodes[0], 1 );
+  BOOST_CHECK_EQUAL( nodes[1], 2 );
+
+  // Never more nodes than the ring has
+  nodes.clear();
+  ring.getNodes( "a.b.c", 5, nodes );
+  BOOST_CHECK_EQUAL( nodes.size(), 3 );
+  BOOST_CHECK_EQUAL( nodes[0], 2 );
+  BOOST_CHECK_EQUAL( nodes[1], 0 );
+  BOOST_CHECK_EQUAL( nodes[2], 1 );
+}
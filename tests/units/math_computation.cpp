@@ -55,7 +55,8 @@ BOOST_AUTO_TEST_CASE( computation_enum )
   BOOST_CHECK_EQUAL( maths::TILES, 5 );
   BOOST_CHECK_EQUAL( maths::VARIANCE, 6 );
   BOOST_CHECK_EQUAL( maths::DEVIATION, 7 );
-  BOOST_CHECK_EQUAL( maths::UNKNOWN, 8 );
+  BOOST_CHECK_EQUAL( maths::PERCENTILE, 8 );
+  BOOST_CHECK_EQUAL( maths::UNKNOWN, 9 );
 }
 
 BOOST_AUTO_TEST_CASE( maths_average )
@@ -65,16 +66,16 @@ BOOST_AUTO_TEST_CASE( maths_average )
   global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 3, true, client );
   maths::MathsPipeline pipeline( "conf/maths.xml", buffer, 1, 500 );
 
-  std::vector<message_ptr> messages;
-  messages.push_back( boost::make_shared<Message>( "test.1", 10.0, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 3.0, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 0.5, 10 ) );
+  std::vector<Message> messages;
+  messages.push_back( Message( "test.1", 10.0, 10 ) );
+  messages.push_back( Message( "test.1", 3.0, 10 ) );
+  messages.push_back( Message( "test.1", 0.5, 10 ) );
 
-  message_ptr result = pipeline.average( messages );
+  Message result = pipeline.average( messages );
 
-  BOOST_CHECK_EQUAL( result->isValid(), true );
-  BOOST_CHECK_EQUAL( result->getType(), "test.1" );
-  BOOST_CHECK_EQUAL( result->getValue(), 4.5 );
+  BOOST_CHECK_EQUAL( result.isValid(), true );
+  BOOST_CHECK_EQUAL( result.getType(), "test.1" );
+  BOOST_CHECK_EQUAL( result.getValue(), 4.5 );
 }
 
 BOOST_AUTO_TEST_CASE( maths_sum )
@@ -84,16 +85,16 @@ BOOST_AUTO_TEST_CASE( maths_sum )
   global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 3, true, client );
   maths::MathsPipeline pipeline( "conf/maths.xml", buffer, 1, 500 );
 
-  std::vector<message_ptr> messages;
-  messages.push_back( boost::make_shared<Message>( "test.1", 1.0, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 2.0, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 3.0, 10 ) );
+  std::vector<Message> messages;
+  messages.push_back( Message( "test.1", 1.0, 10 ) );
+  messages.push_back( Message( "test.1", 2.0, 10 ) );
+  messages.push_back( Message( "test.1", 3.0, 10 ) );
 
-  message_ptr result = pipeline.sum( messages );
+  Message result = pipeline.sum( messages );
 
-  BOOST_CHECK_EQUAL( result->isValid(), true );
-  BOOST_CHECK_EQUAL( result->getType(), "test.1" );
-  BOOST_CHECK_EQUAL( result->getValue(), 6 );
+  BOOST_CHECK_EQUAL( result.isValid(), true );
+  BOOST_CHECK_EQUAL( result.getType(), "test.1" );
+  BOOST_CHECK_EQUAL( result.getValue(), 6 );
 }
 
 BOOST_AUTO_TEST_CASE( maths_variance )
@@ -103,16 +104,16 @@ BOOST_AUTO_TEST_CASE( maths_variance )
   global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 3, true, client );
   maths::MathsPipeline pipeline( "conf/maths.xml", buffer, 1, 500 );
 
-  std::vector<message_ptr> messages;
-  messages.push_back( boost::make_shared<Message>( "test.1", 1, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 2, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 3, 10 ) );
+  std::vector<Message> messages;
+  messages.push_back( Message( "test.1", 1, 10 ) );
+  messages.push_back( Message( "test.1", 2, 10 ) );
+  messages.push_back( Message( "test.1", 3, 10 ) );
 
-  message_ptr result = pipeline.variance( messages );
+  Message result = pipeline.variance( messages );
 
-  BOOST_CHECK_EQUAL( result->isValid(), true );
-  BOOST_CHECK_EQUAL( result->getType(), "test.1" );
-  BOOST_CHECK_CLOSE( result->getValue(), 0.667, 0.06 );
+  BOOST_CHECK_EQUAL( result.isValid(), true );
+  BOOST_CHECK_EQUAL( result.getType(), "test.1" );
+  BOOST_CHECK_CLOSE( result.getValue(), 0.667, 0.06 );
 }
 
 BOOST_AUTO_TEST_CASE( maths_deviation )
@@ -122,16 +123,16 @@ BOOST_AUTO_TEST_CASE( maths_deviation )
   global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 3, true, client );
   maths::MathsPipeline pipeline( "conf/maths.xml", buffer, 1, 500 );
 
-  std::vector<message_ptr> messages;
-  messages.push_back( boost::make_shared<Message>( "test.1", 1, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 2, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 3, 10 ) );
+  std::vector<Message> messages;
+  messages.push_back( Message( "test.1", 1, 10 ) );
+  messages.push_back( Message( "test.1", 2, 10 ) );
+  messages.push_back( Message( "test.1", 3, 10 ) );
 
-  message_ptr result = pipeline.deviation( messages );
+  Message result = pipeline.deviation( messages );
 
-  BOOST_CHECK_EQUAL( result->isValid(), true );
-  BOOST_CHECK_EQUAL( result->getType(), "test.1" );
-  BOOST_CHECK_CLOSE( result->getValue(), 0.816, 0.07 );
+  BOOST_CHECK_EQUAL( result.isValid(), true );
+  BOOST_CHECK_EQUAL( result.getType(), "test.1" );
+  BOOST_CHECK_CLOSE( result.getValue(), 0.816, 0.07 );
 }
 
 BOOST_AUTO_TEST_CASE( maths_max )
@@ -141,16 +142,16 @@ BOOST_AUTO_TEST_CASE( maths_max )
   global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 3, true, client );
   maths::MathsPipeline pipeline( "conf/maths.xml", buffer, 1, 500 );
 
-  std::vector<message_ptr> messages;
-  messages.push_back( boost::make_shared<Message>( "test.1", 1.0, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 2.0, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 3.0, 10 ) );
+  std::vector<Message> messages;
+  messages.push_back( Message( "test.1", 1.0, 10 ) );
+  messages.push_back( Message( "test.1", 2.0, 10 ) );
+  messages.push_back( Message( "test.1", 3.0, 10 ) );
 
-  message_ptr result = pipeline.max( messages );
+  Message result = pipeline.max( messages );
 
-  BOOST_CHECK_EQUAL( result->isValid(), true );
-  BOOST_CHECK_EQUAL( result->getType(), "test.1" );
-  BOOST_CHECK_EQUAL( result->getValue(), 3 );
+  BOOST_CHECK_EQUAL( result.isValid(), true );
+  BOOST_CHECK_EQUAL( result.getType(), "test.1" );
+  BOOST_CHECK_EQUAL( result.getValue(), 3 );
 }
 
 BOOST_AUTO_TEST_CASE( maths_min )
@@ -160,16 +161,16 @@ BOOST_AUTO_TEST_CASE( maths_min )
   global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 3, true, client );
   maths::MathsPipeline pipeline( "conf/maths.xml", buffer, 1, 500 );
 
-  std::vector<message_ptr> messages;
-  messages.push_back( boost::make_shared<Message>( "test.1", 1.0, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 2.0, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 3.0, 10 ) );
+  std::vector<Message> messages;
+  messages.push_back( Message( "test.1", 1.0, 10 ) );
+  messages.push_back( Message( "test.1", 2.0, 10 ) );
+  messages.push_back( Message( "test.1", 3.0, 10 ) );
 
-  message_ptr result = pipeline.min( messages );
+  Message result = pipeline.min( messages );
 
-  BOOST_CHECK_EQUAL( result->isValid(), true );
-  BOOST_CHECK_EQUAL( result->getType(), "test.1" );
-  BOOST_CHECK_EQUAL( result->getValue(), 1 );
+  BOOST_CHECK_EQUAL( result.isValid(), true );
+  BOOST_CHECK_EQUAL( result.getType(), "test.1" );
+  BOOST_CHECK_EQUAL( result.getValue(), 1 );
 }
 
 BOOST_AUTO_TEST_CASE( maths_median_odd )
@@ -179,16 +180,16 @@ BOOST_AUTO_TEST_CASE( maths_median_odd )
   global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 3, true, client );
   maths::MathsPipeline pipeline( "conf/maths.xml", buffer, 1, 500 );
 
-  std::vector<message_ptr> messages;
-  messages.push_back( boost::make_shared<Message>( "test.1", 3.0, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 1.0, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 2.0, 10 ) );
+  std::vector<Message> messages;
+  messages.push_back( Message( "test.1", 3.0, 10 ) );
+  messages.push_back( Message( "test.1", 1.0, 10 ) );
+  messages.push_back( Message( "test.1", 2.0, 10 ) );
 
-  message_ptr result = pipeline.median( messages );
+  Message result = pipeline.median( messages );
 
-  BOOST_CHECK_EQUAL( result->isValid(), true );
-  BOOST_CHECK_EQUAL( result->getType(), "test.1" );
-  BOOST_CHECK_EQUAL( result->getValue(), 2 );
+  BOOST_CHECK_EQUAL( result.isValid(), true );
+  BOOST_CHECK_EQUAL( result.getType(), "test.1" );
+  BOOST_CHECK_EQUAL( result.getValue(), 2 );
 }
 
 BOOST_AUTO_TEST_CASE( maths_median_even )
@@ -198,17 +199,17 @@ BOOST_AUTO_TEST_CASE( maths_median_even )
   global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 3, true, client );
   maths::MathsPipeline pipeline( "conf/maths.xml", buffer, 1, 500 );
 
-  std::vector<message_ptr> messages;
-  messages.push_back( boost::make_shared<Message>( "test.1", 1.0, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 4.0, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 3.0, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 2.0, 10 ) );
+  std::vector<Message> messages;
+  messages.push_back( Message( "test.1", 1.0, 10 ) );
+  messages.push_back( Message( "test.1", 4.0, 10 ) );
+  messages.push_back( Message( "test.1", 3.0, 10 ) );
+  messages.push_back( Message( "test.1", 2.0, 10 ) );
 
-  message_ptr result = pipeline.median( messages );
+  Message result = pipeline.median( messages );
 
-  BOOST_CHECK_EQUAL( result->isValid(), true );
-  BOOST_CHECK_EQUAL( result->getType(), "test.1" );
-  BOOST_CHECK_EQUAL( result->getValue(), 2.5 );
+  BOOST_CHECK_EQUAL( result.isValid(), true );
+  BOOST_CHECK_EQUAL( result.getType(), "test.1" );
+  BOOST_CHECK_EQUAL( result.getValue(), 2.5 );
 }
 
 BOOST_AUTO_TEST_CASE( maths_tiles )
@@ -218,29 +219,133 @@ BOOST_AUTO_TEST_CASE( maths_tiles )
   global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 3, true, client );
   maths::MathsPipeline pipeline( "conf/maths.xml", buffer, 1, 500 );
 
-  std::vector<message_ptr> messages;
-  messages.push_back( boost::make_shared<Message>( "test.1", 4.0, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 4.7, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 3.6, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 2.0, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 6.4, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 8.2, 10 ) );
-  messages.push_back( boost::make_shared<Message>( "test.1", 5.0, 10 ) );
+  std::vector<Message> messages;
+  messages.push_back( Message( "test.1", 4.0, 10 ) );
+  messages.push_back( Message( "test.1", 4.7, 10 ) );
+  messages.push_back( Message( "test.1", 3.6, 10 ) );
+  messages.push_back( Message( "test.1", 2.0, 10 ) );
+  messages.push_back( Message( "test.1", 6.4, 10 ) );
+  messages.push_back( Message( "test.1", 8.2, 10 ) );
+  messages.push_back( Message( "test.1", 5.0, 10 ) );
 
-  message_ptr result = pipeline.tiles( messages, 6.4, true, 100 );
-  BOOST_CHECK_EQUAL( result->isValid(), true );
-  BOOST_CHECK_EQUAL( result->getType(), "test.1" );
-  BOOST_CHECK_EQUAL( (int)result->getValue(), 71 );
+  Message result = pipeline.tiles( messages, 6.4, true, 100 );
+  BOOST_CHECK_EQUAL( result.isValid(), true );
+  BOOST_CHECK_EQUAL( result.getType(), "test.1" );
+  BOOST_CHECK_EQUAL( (int)result.getValue(), 71 );
 
   result = pipeline.tiles( messages, 6.4, false, 100 );
-  BOOST_CHECK_EQUAL( (int)result->getValue(), 78 );
+  BOOST_CHECK_EQUAL( (int)result.getValue(), 78 );
 
   result = pipeline.tiles( messages, 100, false, 100 );
-  BOOST_CHECK_EQUAL( (int)result->getValue(), 100 );
+  BOOST_CHECK_EQUAL( (int)result.getValue(), 100 );
 
   result = pipeline.tiles( messages, 0, false, 100 );
-  BOOST_CHECK_EQUAL( (int)result->getValue(), 0 );
+  BOOST_CHECK_EQUAL( (int)result.getValue(), 0 );
 
   result = pipeline.tiles( messages, 6, false, 100 );
-  BOOST_CHECK_EQUAL( (int)result->getValue(), 71 );
+  BOOST_CHECK_EQUAL( (int)result.getValue(), 71 );
+}
+
+BOOST_AUTO_TEST_CASE( maths_aggregator )
+{
+  // Large and close values, the variance stays exact
+  maths::Aggregator aggregator;
+  BOOST_CHECK_EQUAL( aggregator.empty(), true );
+  const double values[] = { 1e9 + 4, 1e9 + 7, 1e9 + 13, 1e9 + 16 };
+  for( double value : values )
+    aggregator.add( value, 10 );
+
+  BOOST_CHECK_EQUAL( aggregator.getCount(), 4 );
+  BOOST_CHECK_EQUAL( aggregator.getSum(), 4e9 + 40 );
+  BOOST_CHECK_EQUAL( aggregator.getMean(), 1e9 + 10 );
+  BOOST_CHECK_CLOSE( aggregator.getVariance(), 22.5, 1e-6 );
+  BOOST_CHECK_EQUAL( aggregator.getMin(), 1e9 + 4 );
+  BOOST_CHECK_EQUAL( aggregator.getMax(), 1e9 + 16 );
+  BOOST_CHECK_EQUAL( aggregator.getTimestamp(), 10 );
+
+  // Exported values give back the same statistics
+  std::vector<double> exported;
+  aggregator.getValues( exported );
+  BOOST_REQUIRE_EQUAL( exported.size(), 4 );
+  maths::Aggregator copy;
+  for( double value : exported )
+    copy.add( value, 10 );
+  BOOST_CHECK_EQUAL( copy.getMin(), 1e9 + 4 );
+  BOOST_CHECK_EQUAL( copy.getMax(), 1e9 + 16 );
+  BOOST_CHECK_CLOSE( copy.getMean(), 1e9 + 10, 1e-9 );
+  BOOST_CHECK_CLOSE( copy.getVariance(), 22.5, 1e-3 );
+
+  aggregator.reset();
+  BOOST_CHECK_EQUAL( aggregator.empty(), true );
+  BOOST_CHECK_EQUAL( aggregator.getVariance(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( maths_sketch )
+{
+  maths::Sketch sketch;
+  BOOST_CHECK_EQUAL( sketch.getQuantile( 0.5 ), 0 );
+
+  // 1 to 10000 (and their opposites in a second sketch): the percentiles are within the accuracy (1% of the exact value)
+  maths::Sketch negatives;
+  for( int i = 1; i <= 10000; i++ )
+  {
+    sketch.add( i );
+    negatives.add( -i );
+  }
+
+  BOOST_CHECK_EQUAL( sketch.getCount(), 10000 );
+  BOOST_CHECK_EQUAL( sketch.getQuantile( 0 ), 1 );
+  BOOST_CHECK_EQUAL( sketch.getQuantile( 1 ), 10000 );
+  BOOST_CHECK_CLOSE( sketch.getQuantile( 0.5 ), 5000, 1.1 );
+  BOOST_CHECK_CLOSE( sketch.getQuantile( 0.99 ), 9900, 1.1 );
+  BOOST_CHECK_CLOSE( negatives.getQuantile( 0.01 ), -9900, 1.1 );
+  BOOST_CHECK_EQUAL( negatives.getQuantile( 1 ), -1 );
+
+  // Positive and negative values are counted apart, zeros included
+  for( int i = 1; i <= 10000; i++ )
+    sketch.add( -i );
+  sketch.add( 0, 3 );
+  BOOST_CHECK_EQUAL( sketch.getCount(), 20003 );
+  BOOST_CHECK_EQUAL( sketch.getQuantile( 0.5 ), 0 );
+  BOOST_CHECK_CLOSE( sketch.getQuantile( 0.75 ), 5000, 1.1 );
+
+  // Exported values fill the same buckets
+  std::vector<double> values;
+  sketch.getValues( values );
+  BOOST_REQUIRE_EQUAL( values.size(), 20003 );
+  BOOST_CHECK_EQUAL( values.front(), -10000 );
+  BOOST_CHECK_EQUAL( values.back(), 10000 );
+  maths::Sketch copy;
+  for( double value : values )
+    copy.add( value );
+  BOOST_CHECK_EQUAL( copy.getQuantile( 0.9 ), sketch.getQuantile( 0.9 ) );
+  BOOST_CHECK_EQUAL( copy.getNbrBuckets(), sketch.getNbrBuckets() );
+
+  // Memory is bounded, the lowest values are collapsed
+  maths::Sketch bounded( 0.01, 100 );
+  for( int i = 1; i <= 10000; i++ )
+    bounded.add( i );
+  BOOST_CHECK_EQUAL( bounded.getNbrBuckets(), 100 );
+  BOOST_CHECK_CLOSE( bounded.getQuantile( 0.99 ), 9900, 1.1 );
+
+  sketch.reset();
+  BOOST_CHECK( sketch.empty() );
+}
+
+BOOST_AUTO_TEST_CASE( maths_percentiles_option )
+{
+  maths::MathComputation computation( maths::PERCENTILE, true, 10 );
+  BOOST_CHECK( computation.isStreamable() );
+  BOOST_CHECK( computation.setPercentiles( "50, 90,99.9" ) );
+  BOOST_REQUIRE_EQUAL( computation.getPercentiles().size(), 3 );
+  BOOST_CHECK_EQUAL( computation.getPercentiles()[2], 99.9 );
+
+  BOOST_CHECK( !computation.setPercentiles( "" ) );
+  BOOST_CHECK( !computation.setPercentiles( "50,nani" ) );
+  BOOST_CHECK( !computation.setPercentiles( "101" ) );
+  BOOST_CHECK_EQUAL( computation.getPercentiles().size(), 3 );
+
+  BOOST_CHECK_EQUAL( maths::MathComputation::percentileSuffix( 99 ), ".p99" );
+  BOOST_CHECK_EQUAL( maths::MathComputation::percentileSuffix( 99.9 ), ".p99_9" );
+  BOOST_CHECK_EQUAL( maths::MathComputation::stringToComputationType( "Percentile" ), maths::PERCENTILE );
 }
@@ -12,6 +12,8 @@
 #include <boost/make_shared.hpp>
 #include <boost/algorithm/string.hpp>
 
+#include <cmath>
+
 using namespace graphite_proxy;
 
 BOOST_AUTO_TEST_CASE( configuration_file_good_load )
@@ -63,14 +65,14 @@ BOOST_AUTO_TEST_CASE( regex_category )
   BOOST_CHECK( !pipeline.isWanted("ads_server..elapsed_time") );
 
   // Add messages
-  BOOST_CHECK( pipeline.add( boost::make_shared<Message>("ads_server.1.nbr", 1) ) );
-  BOOST_CHECK( pipeline.add( boost::make_shared<Message>("ads_server.1.nbr", 1) ) );
-  BOOST_CHECK( pipeline.add( boost::make_shared<Message>("ads_server.2.nbr", 1) ) );
-  BOOST_CHECK( pipeline.add( boost::make_shared<Message>("ads_server.2.nbr", 1) ) );
-  BOOST_CHECK( pipeline.add( boost::make_shared<Message>("ads_server.1.elapsed_time", 1) ) );
-  BOOST_CHECK( pipeline.add( boost::make_shared<Message>("ads_server.1.elapsed_time", 3) ) );
-  BOOST_CHECK( pipeline.add( boost::make_shared<Message>("ads_server.2.elapsed_time", 1) ) );
-  BOOST_CHECK( pipeline.add( boost::make_shared<Message>("ads_server.2.elapsed_time", 3) ) );
+  BOOST_CHECK( pipeline.add( Message("ads_server.1.nbr", 1) ) );
+  BOOST_CHECK( pipeline.add( Message("ads_server.1.nbr", 1) ) );
+  BOOST_CHECK( pipeline.add( Message("ads_server.2.nbr", 1) ) );
+  BOOST_CHECK( pipeline.add( Message("ads_server.2.nbr", 1) ) );
+  BOOST_CHECK( pipeline.add( Message("ads_server.1.elapsed_time", 1) ) );
+  BOOST_CHECK( pipeline.add( Message("ads_server.1.elapsed_time", 3) ) );
+  BOOST_CHECK( pipeline.add( Message("ads_server.2.elapsed_time", 1) ) );
+  BOOST_CHECK( pipeline.add( Message("ads_server.2.elapsed_time", 3) ) );
 
   // Check right number of buffers
   BOOST_CHECK_EQUAL( pipeline.getNbrBuffers(), 4 );
@@ -79,10 +81,10 @@ BOOST_AUTO_TEST_CASE( regex_category )
   pipeline.iteration();
 
   // Messages should be computed and stored into the global buffer now
-  std::vector<message_ptr> maths_messages;
+  std::vector<Message> maths_messages;
   pipeline.get(maths_messages);
   BOOST_CHECK_EQUAL( maths_messages.size(), 0 );
-  std::vector<message_ptr> result_messages;
+  std::vector<Message> result_messages;
   buffer->get( result_messages );
   BOOST_CHECK_EQUAL( result_messages.size(), 4 );
 
@@ -91,7 +93,7 @@ BOOST_AUTO_TEST_CASE( regex_category )
   check_message_1 = check_message_2 = check_message_3 = check_message_4 = false;
   for( size_t i = 0, size = result_messages.size(); i < size; i++ )
   {
-    std::string message = result_messages[i]->serialize();
+    std::string message = result_messages[i].serialize();
     if( boost::algorithm::starts_with(message, "ads_server.1.nbr 2") )
         check_message_1 = true;
     else if( boost::algorithm::starts_with(message, "ads_server.2.nbr 2") )
@@ -118,11 +120,11 @@ BOOST_AUTO_TEST_CASE( maths_pipeline_get_messages )
   BOOST_CHECK( pipeline.add( Message::createMessage("maths.2 0 0") ) );
   BOOST_CHECK( pipeline.add( Message::createMessage("maths.3 0 0") ) );
 
-  std::vector<message_ptr> messages;
+  std::vector<Message> messages;
   pipeline.get( messages );
   BOOST_CHECK_EQUAL( messages.size(), 3 );
 
-  std::vector<message_ptr> messages_2;
+  std::vector<Message> messages_2;
   pipeline.get( messages_2 );
   BOOST_CHECK( messages_2.empty() );
 }
@@ -136,6 +138,156 @@ BOOST_AUTO_TEST_CASE( maths_pipeline_reload_configurations )
 
   BOOST_CHECK( !pipeline.isWanted("maths.load_2") );
 
-  pipeline.reloadConfigurations( "conf/maths_load_2.xml" );
+  // The categories are replaced at once
+  const unsigned int generation = pipeline.getGeneration();
+  BOOST_CHECK( pipeline.reloadConfigurations( "conf/maths_load_2.xml" ) );
   BOOST_CHECK( pipeline.isWanted("maths.load_2") );
+  BOOST_CHECK_EQUAL( pipeline.getGeneration(), generation + 1 );
+
+  // A file which can't be loaded leaves no category
+  BOOST_CHECK( !pipeline.reloadConfigurations( "conf/maths_missing.xml" ) );
+  BOOST_CHECK( !pipeline.isWanted("maths.load_2") );
+
+  // The existing buffers are kept until the cleaner removes them, only a new series needs a category
+  maths::MathsPipeline pipeline_2( "conf/maths_load_2.xml", buffer, 99, 99 );
+  BOOST_CHECK( pipeline_2.add( Message( "maths.load_2", 1, 10 ) ) );
+  BOOST_CHECK( !pipeline_2.reloadConfigurations( "conf/maths_missing.xml" ) );
+  BOOST_CHECK( pipeline_2.add( Message( "maths.load_2", 2, 10 ) ) );
+  BOOST_CHECK( !pipeline_2.add( Message( "maths.load_1", 3, 10 ) ) );
+}
+
+BOOST_AUTO_TEST_CASE( maths_pipeline_streaming )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+  networking::client_ptr client = boost::make_shared<networking::Client>( "localhost", "2003" );
+  global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 99, true, client );
+  maths::MathsPipeline pipeline( "conf/maths_streaming.xml", buffer, 99, 99 );
+
+  // An on count window is computed as soon as it is full, without an iteration
+  BOOST_CHECK( pipeline.add( Message( "stream.min", 5, 10 ) ) );
+  BOOST_CHECK( pipeline.add( Message( "stream.min", 2, 10 ) ) );
+  BOOST_CHECK( pipeline.add( Message( "stream.min", 7, 10 ) ) );
+  std::vector<Message> result_messages;
+  buffer->get( result_messages );
+  BOOST_REQUIRE_EQUAL( result_messages.size(), 1 );
+  BOOST_CHECK_EQUAL( result_messages[0].getValue(), 2 );
+
+  // The statistics keep the number of values of the window, even if they are not stored
+  BOOST_CHECK_EQUAL( pipeline.getBuffersMaxMessages(), 3 );
+
+  // The values of an incomplete window are saved as messages giving back the same statistics
+  BOOST_CHECK( pipeline.add( Message( "stream.variance", 1, 10 ) ) );
+  BOOST_CHECK( pipeline.add( Message( "stream.variance", 2, 10 ) ) );
+  BOOST_CHECK( pipeline.add( Message( "stream.variance", 3, 10 ) ) );
+  std::vector<Message> saved_messages;
+  pipeline.get( saved_messages );
+  BOOST_CHECK_EQUAL( saved_messages.size(), 3 );
+
+  for( const Message &message : saved_messages )
+    BOOST_CHECK( pipeline.loadMessage( message, "variance" ) );
+  BOOST_CHECK( pipeline.add( Message( "stream.variance", 4, 10 ) ) );
+
+  result_messages.clear();
+  buffer->get( result_messages );
+  BOOST_REQUIRE_EQUAL( result_messages.size(), 1 );
+  BOOST_CHECK_CLOSE( result_messages[0].getValue(), 1.25, 1e-6 );
+}
+
+BOOST_AUTO_TEST_CASE( maths_pipeline_percentile )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+  networking::client_ptr client = boost::make_shared<networking::Client>( "localhost", "2003" );
+  global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 99, true, client );
+  maths::MathsPipeline pipeline( "conf/maths_streaming.xml", buffer, 99, 99 );
+
+  // Half the values are saved and loaded back, the result is the same
+  for( int i = 1; i <= 50; i++ )
+    BOOST_CHECK( pipeline.add( Message( "stream.percentile", i, 10 ) ) );
+
+  std::vector<Message> saved_messages;
+  pipeline.get( saved_messages );
+  BOOST_CHECK_EQUAL( saved_messages.size(), 50 );
+  for( const Message &message : saved_messages )
+    BOOST_CHECK( pipeline.loadMessage( message, "percentile" ) );
+
+  for( int i = 51; i <= 100; i++ )
+    BOOST_CHECK( pipeline.add( Message( "stream.percentile", i, 10 ) ) );
+
+  // Each percentile goes to its own series
+  std::vector<Message> result_messages;
+  buffer->get( result_messages );
+  BOOST_REQUIRE_EQUAL( result_messages.size(), 2 );
+  for( const Message &message : result_messages )
+  {
+    if( message.getType() == "stream.percentile.p50" )
+      BOOST_CHECK_CLOSE( message.getValue(), 50, 1.5 );
+    else
+    {
+      BOOST_CHECK_EQUAL( message.getType(), "stream.percentile.p99" );
+      BOOST_CHECK_CLOSE( message.getValue(), 99, 1.5 );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( maths_pipeline_shared_window )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+  networking::client_ptr client = boost::make_shared<networking::Client>( "localhost", "2003" );
+  global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 99, true, client );
+  maths::MathsPipeline pipeline( "conf/maths_streaming.xml", buffer, 99, 99 );
+
+  const double values[] = { 4, 1, 3, 8 };
+  for( double value : values )
+    BOOST_CHECK( pipeline.add( Message( "stream.shared", value, 10 ) ) );
+
+  // The computations on 4 messages share a buffer, each message is stored once
+  BOOST_REQUIRE_EQUAL( pipeline.getNbrBuffers(), 1 );
+  const std::vector<maths::MathOperation*> &operations = pipeline.getBuffers().begin()->second;
+  BOOST_REQUIRE_EQUAL( operations.size(), 2 );
+  BOOST_CHECK_EQUAL( operations[0]->computations.size(), 3 );
+  BOOST_CHECK( !operations[0]->streamable );
+  BOOST_CHECK_EQUAL( operations[0]->buffer.getName(), "stream.shared sum,median,deviation" );
+  BOOST_CHECK_EQUAL( operations[0]->size(), 4 );
+  BOOST_CHECK( operations[1]->streamable );
+
+  // One iteration computes the three of them
+  pipeline.iteration();
+  std::vector<Message> result_messages;
+  buffer->get( result_messages );
+  BOOST_REQUIRE_EQUAL( result_messages.size(), 3 );
+  BOOST_CHECK_EQUAL( result_messages[0].getValue(), 16 );
+  BOOST_CHECK_EQUAL( result_messages[1].getValue(), 3.5 );
+  BOOST_CHECK_CLOSE( result_messages[2].getValue(), sqrt( 6.5 ), 1e-6 );
+  BOOST_CHECK_EQUAL( operations[0]->size(), 0 );
+  BOOST_CHECK_EQUAL( operations[1]->size(), 4 );
+}
+
+BOOST_AUTO_TEST_CASE( maths_category_matcher )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  // The first category matching the whole type wins, groups inside the filters don't shift the next ones
+  std::list<maths::MathsCategory*> categories;
+  categories.push_back( new maths::MathsCategory( "test\\.(a|b)\\.[0-9]+" ) );
+  categories.push_back( new maths::MathsCategory( "test\\.a\\.[0-9a-z]+" ) );
+  categories.push_back( new maths::MathsCategory( "test\\..*" ) );
+  const std::vector<maths::MathsCategory*> ordered( categories.begin(), categories.end() );
+  maths::CategoryMatcher matcher( categories );
+
+  BOOST_CHECK_EQUAL( matcher.find( "test.a.12" ), ordered[0] );
+  BOOST_CHECK_EQUAL( matcher.find( "test.b.12" ), ordered[0] );
+  BOOST_CHECK_EQUAL( matcher.find( "test.a.12x" ), ordered[1] );
+  BOOST_CHECK_EQUAL( matcher.find( "test.b.12x" ), ordered[2] );
+  BOOST_CHECK( !matcher.find( "other.a.12" ) );
+  BOOST_CHECK( !matcher.find( "xtest.a.12" ) );
+
+  // A back reference can't be combined, the filters are then matched one by one
+  std::list<maths::MathsCategory*> sequential_categories;
+  sequential_categories.push_back( new maths::MathsCategory( "([a-z])\\.\\1" ) );
+  sequential_categories.push_back( new maths::MathsCategory( "[a-z]\\.[a-z]" ) );
+  const std::vector<maths::MathsCategory*> sequential_ordered( sequential_categories.begin(), sequential_categories.end() );
+  maths::CategoryMatcher sequential_matcher( sequential_categories );
+
+  BOOST_CHECK_EQUAL( sequential_matcher.find( "a.a" ), sequential_ordered[0] );
+  BOOST_CHECK_EQUAL( sequential_matcher.find( "a.b" ), sequential_ordered[1] );
 }
@@ -11,44 +11,76 @@ BOOST_AUTO_TEST_CASE( message_static_creation )
   utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
 
   // Normal message
-  message_ptr message_1 = Message::createMessage("type.1 10 123456789");
-  BOOST_CHECK( message_1->isValid() );
-  BOOST_CHECK_EQUAL( message_1->getTimestamp(), 123456789 );
-  BOOST_CHECK_EQUAL( message_1->getValue(), 10 );
-  BOOST_CHECK_EQUAL( message_1->getType(), "type.1" );
+  Message message_1 = Message::createMessage("type.1 10 123456789");
+  BOOST_CHECK( message_1.isValid() );
+  BOOST_CHECK_EQUAL( message_1.getTimestamp(), 123456789 );
+  BOOST_CHECK_EQUAL( message_1.getValue(), 10 );
+  BOOST_CHECK_EQUAL( message_1.getType(), "type.1" );
 
   // Miss value
-  message_ptr message_2 = Message::createMessage("type.1");
-  BOOST_CHECK( !message_2 );
+  Message message_2 = Message::createMessage("type.1");
+  BOOST_CHECK( !message_2.isValid() );
 
   // Weird syntaxes but have to work
-  message_ptr message_4 = Message::createMessage("   type.1 0 1657   ");
-  BOOST_CHECK( message_4 );
-  BOOST_CHECK_EQUAL( message_4->getTimestamp(), 1657 );
-  message_ptr message_6 = Message::createMessage("   type.1 0 0");
-  BOOST_CHECK( message_6 );
-  BOOST_CHECK_EQUAL( message_6->getTimestamp(), 0 );
-  message_ptr message_8 = Message::createMessage("type.1 0 6574  ");
-  BOOST_CHECK( message_8 );
-  BOOST_CHECK_EQUAL( message_8->getTimestamp(), 6574 );
+  Message message_4 = Message::createMessage("   type.1 0 1657   ");
+  BOOST_CHECK( message_4.isValid() );
+  BOOST_CHECK_EQUAL( message_4.getTimestamp(), 1657 );
+  Message message_6 = Message::createMessage("   type.1 0 0");
+  BOOST_CHECK( message_6.isValid() );
+  BOOST_CHECK_EQUAL( message_6.getTimestamp(), 0 );
+  Message message_8 = Message::createMessage("type.1 0 6574  ");
+  BOOST_CHECK( message_8.isValid() );
+  BOOST_CHECK_EQUAL( message_8.getTimestamp(), 6574 );
+  Message message_9 = Message::createMessage("type.1  \t 1.5e2\t6574\r");
+  BOOST_CHECK( message_9.isValid() );
+  BOOST_CHECK_EQUAL( message_9.getValue(), 150 );
+  BOOST_CHECK_EQUAL( message_9.getTimestamp(), 6574 );
+
+  // Bad values
+  BOOST_CHECK( !Message::createMessage("type.1 nani 6574").isValid() );
+  BOOST_CHECK( !Message::createMessage("type.1 10 -6574").isValid() );
+  BOOST_CHECK( !Message::createMessage("type.1 10 65.74").isValid() );
+  BOOST_CHECK( !Message::createMessage("type.1 10 6574 extra").isValid() );
+}
+
+BOOST_AUTO_TEST_CASE( message_parsing )
+{
+  std::string_view type;
+  double           value;
+  ulong            timestamp;
+
+  BOOST_CHECK( Message::parse( "type.1 +10.5 123", type, value, timestamp ) == Message::ParseStatus::OK );
+  BOOST_CHECK_EQUAL( type, "type.1" );
+  BOOST_CHECK_EQUAL( value, 10.5 );
+  BOOST_CHECK_EQUAL( timestamp, 123 );
+
+  BOOST_CHECK( Message::parse( "type.1 -3 0", type, value, timestamp ) == Message::ParseStatus::OK );
+  BOOST_CHECK_EQUAL( value, -3 );
+
+  BOOST_CHECK( Message::parse( " \t ", type, value, timestamp ) == Message::ParseStatus::EMPTY );
+  BOOST_CHECK( Message::parse( "type.1 10", type, value, timestamp ) == Message::ParseStatus::BAD_SYNTAX );
+  BOOST_CHECK( Message::parse( "type.1 10 0 0", type, value, timestamp ) == Message::ParseStatus::BAD_SYNTAX );
+  BOOST_CHECK( Message::parse( "type.1 10a 0", type, value, timestamp ) == Message::ParseStatus::BAD_VALUE );
+  BOOST_CHECK( Message::parse( "type.1 +-1 0", type, value, timestamp ) == Message::ParseStatus::BAD_VALUE );
+  BOOST_CHECK( Message::parse( "type.1 10 1e3", type, value, timestamp ) == Message::ParseStatus::BAD_TIMESTAMP );
 }
 
 BOOST_AUTO_TEST_CASE( messages_static_creation )
 {
   utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
 
-  std::vector<message_ptr> messages;
+  std::vector<Message> messages;
   BOOST_CHECK( Message::createMessages("type.1 0 0\ntype.2 0 0\ntype.3 0 0\n", messages) );
   BOOST_CHECK_EQUAL( messages.size(), 3 );
-  BOOST_CHECK_EQUAL( messages[0]->serialize(), "type.1 0.000000 0" );
-  BOOST_CHECK_EQUAL( messages[1]->serialize(), "type.2 0.000000 0" );
-  BOOST_CHECK_EQUAL( messages[2]->serialize(), "type.3 0.000000 0" );
+  BOOST_CHECK_EQUAL( messages[0].serialize(), "type.1 0 0" );
+  BOOST_CHECK_EQUAL( messages[1].serialize(), "type.2 0 0" );
+  BOOST_CHECK_EQUAL( messages[2].serialize(), "type.3 0 0" );
 
-  std::vector<message_ptr> messages_2;
+  std::vector<Message> messages_2;
   BOOST_CHECK_EQUAL( Message::createMessages("some para\nnani\nagain and again\n", messages_2), false );
   BOOST_CHECK( messages_2.empty() );
 
-  std::vector<message_ptr> messages_3;
+  std::vector<Message> messages_3;
   BOOST_CHECK( Message::createMessages("some para\nsomething.correct 0 4657\nagain and again\nsomething.correct 10 4657  ", messages_3) );
   BOOST_CHECK_EQUAL( messages_3.size(), 2 );
 }
@@ -70,8 +102,30 @@ BOOST_AUTO_TEST_CASE( message_public_behavior )
   BOOST_CHECK_EQUAL( message_2.getValue(), 55.12 );
   BOOST_CHECK_EQUAL( message_2.getTimestamp(), 123456789 );
   BOOST_CHECK_EQUAL( message_2.getReceivedTimestamp(), 987654321 );
-  BOOST_CHECK_EQUAL( message_2.serialize(), "type.1 55.120000 123456789" );
-  BOOST_CHECK_EQUAL( message_2.length(), 26 );
+  BOOST_CHECK_EQUAL( message_2.serialize(), "type.1 55.12 123456789" );
+  BOOST_CHECK_EQUAL( message_2.length(), 22 );
   BOOST_CHECK_EQUAL( message_2.isValid(), true );
 }
 
+BOOST_AUTO_TEST_CASE( message_serialization )
+{
+  // Shortest representation which keeps the precision
+  BOOST_CHECK_EQUAL( Message( "type.1", 0.000123, 5 ).serialize(), "type.1 0.000123 5" );
+  BOOST_CHECK_EQUAL( Message( "type.1", 1e-9, 5 ).serialize(), "type.1 1e-09 5" );
+  BOOST_CHECK_EQUAL( Message( "type.1", -2.5, 5 ).serialize(), "type.1 -2.5 5" );
+  BOOST_CHECK_EQUAL( Message( "type.1", 0.1 + 0.2, 5 ).serialize(), "type.1 0.30000000000000004 5" );
+
+  // Serialization into a caller provided buffer
+  char output[32];
+  Message message( "type.1", 10, 123 );
+  const size_t written = message.serialize( output, sizeof(output) );
+  BOOST_CHECK_EQUAL( std::string( output, written ), "type.1 10 123" );
+  BOOST_CHECK_EQUAL( message.serialize( output, 10 ), 0 );
+  BOOST_CHECK_EQUAL( Message().serialize( output, sizeof(output) ), 0 );
+
+  // Append to an existing content
+  std::string batch = "first\n";
+  message.appendTo( batch );
+  BOOST_CHECK_EQUAL( batch, "first\ntype.1 10 123" );
+}
+
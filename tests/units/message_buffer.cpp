@@ -17,16 +17,16 @@ BOOST_AUTO_TEST_CASE( buffer_get_items )
   networking::client_ptr client = boost::make_shared<networking::Client>( "localhost", "2003" );
   global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 3, true, client );
 
-  BOOST_CHECK_EQUAL( buffer->add( boost::make_shared<Message>("test.1", 10, 40) ), true );
-  BOOST_CHECK_EQUAL( buffer->add( boost::make_shared<Message>("test.1", 40, 60) ), true );
+  BOOST_CHECK_EQUAL( buffer->add( Message("test.1", 10, 40) ), true );
+  BOOST_CHECK_EQUAL( buffer->add( Message("test.1", 40, 60) ), true );
 
   // Get all messages of type "test.1"
-  std::vector<message_ptr> messages;
-  buffer->get( "test.1", messages );
+  std::vector<Message> messages;
+  buffer->get( SeriesTable::instance().find( "test.1" ), messages );
 
   BOOST_CHECK_EQUAL( messages.size(), 2 );
-  BOOST_CHECK_EQUAL( messages[0]->getValue(), 10 ); BOOST_CHECK_EQUAL( messages[0]->getTimestamp(), 40 );
-  BOOST_CHECK_EQUAL( messages[1]->getValue(), 40 ); BOOST_CHECK_EQUAL( messages[1]->getTimestamp(), 60 );
+  BOOST_CHECK_EQUAL( messages[0].getValue(), 10 ); BOOST_CHECK_EQUAL( messages[0].getTimestamp(), 40 );
+  BOOST_CHECK_EQUAL( messages[1].getValue(), 40 ); BOOST_CHECK_EQUAL( messages[1].getTimestamp(), 60 );
 
   messages.clear();
   BOOST_CHECK_EQUAL( messages.size(), 0 );
@@ -42,13 +42,13 @@ BOOST_AUTO_TEST_CASE( message_buffer_get_nbr_of_items )
   BOOST_CHECK_EQUAL( buffer.empty(), true );
   BOOST_CHECK_EQUAL( buffer.size(), 0 );
 
-  buffer.add( boost::make_shared<Message>( "type.1", 0.0 ) );
-  buffer.add( boost::make_shared<Message>( "type.1", 1.0 ) );
+  buffer.add( Message( "type.1", 0.0 ) );
+  buffer.add( Message( "type.1", 1.0 ) );
 
   BOOST_CHECK_EQUAL( buffer.empty(), false );
   BOOST_CHECK_EQUAL( buffer.size(), 2 );
 
-  std::vector<message_ptr> messages;
+  std::vector<Message> messages;
   buffer.get( messages, 1 ); // Retrieve only one message
 
   BOOST_CHECK_EQUAL( buffer.empty(), false );
@@ -69,13 +69,13 @@ BOOST_AUTO_TEST_CASE( message_buffer_get_older_than )
 
   MessageBuffer buffer( "buffer name", 5, true );
 
-  buffer.add( boost::make_shared<Message>( "type.1", 0, 10 ) );
-  buffer.add( boost::make_shared<Message>( "type.1", 1, 20 ) );
-  buffer.add( boost::make_shared<Message>( "type.1", 2, 30 ) );
-  buffer.add( boost::make_shared<Message>( "type.1", 3, 40 ) );
-  buffer.add( boost::make_shared<Message>( "type.1", 4, 50 ) );
+  buffer.add( Message( "type.1", 0, 10 ) );
+  buffer.add( Message( "type.1", 1, 20 ) );
+  buffer.add( Message( "type.1", 2, 30 ) );
+  buffer.add( Message( "type.1", 3, 40 ) );
+  buffer.add( Message( "type.1", 4, 50 ) );
 
-  std::vector<message_ptr> messages;
+  std::vector<Message> messages;
 
   // Nothing to take
   buffer.getOlderThan( messages, 0 );
@@ -86,17 +86,17 @@ BOOST_AUTO_TEST_CASE( message_buffer_get_older_than )
   buffer.getOlderThan( messages, 50 );
   BOOST_CHECK_EQUAL( messages.size(), 5 );
   BOOST_CHECK_EQUAL( buffer.size(), 0 );
-  BOOST_CHECK_EQUAL( messages[0]->getTimestamp(), 10 );
-  BOOST_CHECK_EQUAL( messages[1]->getTimestamp(), 20 );
-  BOOST_CHECK_EQUAL( messages[2]->getTimestamp(), 30 );
-  BOOST_CHECK_EQUAL( messages[3]->getTimestamp(), 40 );
-  BOOST_CHECK_EQUAL( messages[4]->getTimestamp(), 50 );
-
-  buffer.add( boost::make_shared<Message>( "type.1", 4, 50 ) );
-  buffer.add( boost::make_shared<Message>( "type.1", 0, 10 ) );
-  buffer.add( boost::make_shared<Message>( "type.1", 2, 30 ) );
-  buffer.add( boost::make_shared<Message>( "type.1", 1, 20 ) );
-  buffer.add( boost::make_shared<Message>( "type.1", 3, 40 ) );
+  BOOST_CHECK_EQUAL( messages[0].getTimestamp(), 10 );
+  BOOST_CHECK_EQUAL( messages[1].getTimestamp(), 20 );
+  BOOST_CHECK_EQUAL( messages[2].getTimestamp(), 30 );
+  BOOST_CHECK_EQUAL( messages[3].getTimestamp(), 40 );
+  BOOST_CHECK_EQUAL( messages[4].getTimestamp(), 50 );
+
+  buffer.add( Message( "type.1", 4, 50 ) );
+  buffer.add( Message( "type.1", 0, 10 ) );
+  buffer.add( Message( "type.1", 2, 30 ) );
+  buffer.add( Message( "type.1", 1, 20 ) );
+  buffer.add( Message( "type.1", 3, 40 ) );
 
   messages.clear();
 
@@ -104,8 +104,8 @@ BOOST_AUTO_TEST_CASE( message_buffer_get_older_than )
   buffer.getOlderThan( messages, 20 );
   BOOST_CHECK_EQUAL( messages.size(), 2 );
   BOOST_CHECK_EQUAL( buffer.size(), 3 );
-  BOOST_CHECK_EQUAL( messages[0]->getTimestamp(), 10 );
-  BOOST_CHECK_EQUAL( messages[1]->getTimestamp(), 20 );
+  BOOST_CHECK_EQUAL( messages[0].getTimestamp(), 10 );
+  BOOST_CHECK_EQUAL( messages[1].getTimestamp(), 20 );
 
   messages.clear();
 
@@ -113,9 +113,9 @@ BOOST_AUTO_TEST_CASE( message_buffer_get_older_than )
   buffer.getOlderThan( messages, 100 );
   BOOST_CHECK_EQUAL( messages.size(), 3 );
   BOOST_CHECK_EQUAL( buffer.size(), 0 );
-  BOOST_CHECK_EQUAL( messages[0]->getTimestamp(), 50 );
-  BOOST_CHECK_EQUAL( messages[1]->getTimestamp(), 30 );
-  BOOST_CHECK_EQUAL( messages[2]->getTimestamp(), 40 );
+  BOOST_CHECK_EQUAL( messages[0].getTimestamp(), 50 );
+  BOOST_CHECK_EQUAL( messages[1].getTimestamp(), 30 );
+  BOOST_CHECK_EQUAL( messages[2].getTimestamp(), 40 );
 }
 
 BOOST_AUTO_TEST_CASE( buffer_override_oldest )
@@ -125,18 +125,21 @@ BOOST_AUTO_TEST_CASE( buffer_override_oldest )
   networking::client_ptr client = boost::make_shared<networking::Client>( "localhost", "2003" );
   global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 3, true, client );
 
-  buffer->add( boost::make_shared<Message>("test.2", 10, 40) );
-  buffer->add( boost::make_shared<Message>("test.2", 40, 60) );
-  buffer->add( boost::make_shared<Message>("test.2", 50, 70) );
-  buffer->add( boost::make_shared<Message>("test.2", 99, 80) );
+  buffer->add( Message("test.2", 10, 40) );
+  buffer->add( Message("test.2", 40, 60) );
+  buffer->add( Message("test.2", 50, 70) );
+  buffer->add( Message("test.2", 99, 80) );
 
-  std::vector<message_ptr> messages;
-  buffer->get( "test.2", messages );
+  // The full buffer is queued to the client, its messages come back once their write has failed
+  client->stop();
+
+  std::vector<Message> messages;
+  buffer->get( SeriesTable::instance().find( "test.2" ), messages );
 
   BOOST_CHECK_EQUAL( messages.size(), 3 );
-  BOOST_CHECK_EQUAL( messages[0]->getValue(), 40 );
-  BOOST_CHECK_EQUAL( messages[1]->getValue(), 50 );
-  BOOST_CHECK_EQUAL( messages[2]->getValue(), 99 );
+  BOOST_CHECK_EQUAL( messages[0].getValue(), 40 );
+  BOOST_CHECK_EQUAL( messages[1].getValue(), 50 );
+  BOOST_CHECK_EQUAL( messages[2].getValue(), 99 );
 }
 
 BOOST_AUTO_TEST_CASE( buffer_drop_new )
@@ -146,16 +149,103 @@ BOOST_AUTO_TEST_CASE( buffer_drop_new )
   networking::client_ptr client = boost::make_shared<networking::Client>( "localhost", "2003" );
   global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 3, false, client );
 
-  buffer->add( boost::make_shared<Message>("test.3", 10, 40) );
-  buffer->add( boost::make_shared<Message>("test.3", 40, 60) );
-  buffer->add( boost::make_shared<Message>("test.3", 50, 70) );
-  buffer->add( boost::make_shared<Message>("test.3", 99, 80) ); // This message has to be dropped (no more free space available and drop_oldest == false)
+  buffer->add( Message("test.3", 10, 40) );
+  buffer->add( Message("test.3", 40, 60) );
+  buffer->add( Message("test.3", 50, 70) );
+
+  // The full buffer is queued to the client, its messages come back once their write has failed
+  client->stop();
+
+  buffer->add( Message("test.3", 99, 80) ); // This message has to be dropped (no more free space available and drop_oldest == false)
 
-  std::vector<message_ptr> messages;
-  buffer->get( "test.3", messages );
+  std::vector<Message> messages;
+  buffer->get( SeriesTable::instance().find( "test.3" ), messages );
 
   BOOST_CHECK_EQUAL( messages.size(), 3 );
-  BOOST_CHECK_EQUAL( messages[0]->getValue(), 10 ); BOOST_CHECK_EQUAL( messages[0]->getTimestamp(), 40 );
-  BOOST_CHECK_EQUAL( messages[1]->getValue(), 40 ); BOOST_CHECK_EQUAL( messages[1]->getTimestamp(), 60 );
-  BOOST_CHECK_EQUAL( messages[2]->getValue(), 50 ); BOOST_CHECK_EQUAL( messages[2]->getTimestamp(), 70 );
+  BOOST_CHECK_EQUAL( messages[0].getValue(), 10 ); BOOST_CHECK_EQUAL( messages[0].getTimestamp(), 40 );
+  BOOST_CHECK_EQUAL( messages[1].getValue(), 40 ); BOOST_CHECK_EQUAL( messages[1].getTimestamp(), 60 );
+  BOOST_CHECK_EQUAL( messages[2].getValue(), 50 ); BOOST_CHECK_EQUAL( messages[2].getTimestamp(), 70 );
+}
+
+BOOST_AUTO_TEST_CASE( message_buffer_wrap_around )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  MessageBuffer buffer( "buffer name", 20, true );
+
+  // Fill the buffer beyond its capacity, the oldest messages are overridden
+  for( int i = 0; i < 25; i++ )
+    BOOST_CHECK_EQUAL( buffer.add( Message( "type.1", i, i ) ), true );
+  BOOST_CHECK_EQUAL( buffer.size(), 20 );
+  BOOST_CHECK_EQUAL( buffer.getMaxMessages(), 20 );
+
+  // Retrieve messages across the end of the storage
+  std::vector<Message> messages;
+  buffer.get( messages, 18 );
+  BOOST_CHECK_EQUAL( messages.size(), 18 );
+  BOOST_CHECK_EQUAL( messages[0].getValue(), 5 );
+  BOOST_CHECK_EQUAL( messages[17].getValue(), 22 );
+
+  for( int i = 25; i < 30; i++ )
+    buffer.add( Message( "type.1", i, i ) );
+
+  messages.clear();
+  buffer.getOlderThan( messages, 24 );
+  BOOST_CHECK_EQUAL( messages.size(), 2 );
+  BOOST_CHECK_EQUAL( buffer.size(), 5 );
+
+  messages.clear();
+  buffer.get( messages );
+  BOOST_CHECK_EQUAL( messages.size(), 5 );
+  for( size_t i = 0; i < messages.size(); i++ )
+    BOOST_CHECK_EQUAL( messages[i].getValue(), 25 + i );
+  BOOST_CHECK_EQUAL( buffer.empty(), true );
+}
+
+BOOST_AUTO_TEST_CASE( message_buffer_requeue )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  std::vector<Message> failed;
+  for( int i = 0; i < 6; i++ )
+    failed.push_back( Message( "type.1", i, i ) );
+
+  // The messages put back come before the ones already stored, in the same order
+  MessageBuffer buffer( "buffer name", 20, true );
+  buffer.add( Message( "type.1", 10, 10 ) );
+  buffer.add( Message( "type.1", 11, 11 ) );
+  BOOST_CHECK_EQUAL( buffer.requeue( failed.begin(), failed.begin() + 3 ), 3 );
+
+  std::vector<Message> messages;
+  buffer.get( messages );
+  BOOST_CHECK_EQUAL( messages.size(), 5 );
+  BOOST_CHECK_EQUAL( messages[0].getValue(), 0 );
+  BOOST_CHECK_EQUAL( messages[2].getValue(), 2 );
+  BOOST_CHECK_EQUAL( messages[3].getValue(), 10 );
+  BOOST_CHECK_EQUAL( messages[4].getValue(), 11 );
+
+  // Not enough space, the oldest messages put back are dropped
+  MessageBuffer drop_oldest( "buffer name", 5, true );
+  drop_oldest.add( Message( "type.1", 10, 10 ) );
+  BOOST_CHECK_EQUAL( drop_oldest.requeue( failed.begin(), failed.end() ), 4 );
+  BOOST_CHECK_EQUAL( drop_oldest.requeue( failed.begin(), failed.end() ), 0 );
+
+  messages.clear();
+  drop_oldest.get( messages );
+  BOOST_CHECK_EQUAL( messages.size(), 5 );
+  BOOST_CHECK_EQUAL( messages[0].getValue(), 2 );
+  BOOST_CHECK_EQUAL( messages[3].getValue(), 5 );
+  BOOST_CHECK_EQUAL( messages[4].getValue(), 10 );
+
+  // Not enough space, the newest messages put back are dropped
+  MessageBuffer drop_new( "buffer name", 5, false );
+  drop_new.add( Message( "type.1", 10, 10 ) );
+  BOOST_CHECK_EQUAL( drop_new.requeue( failed.begin(), failed.end() ), 4 );
+
+  messages.clear();
+  drop_new.get( messages );
+  BOOST_CHECK_EQUAL( messages.size(), 5 );
+  BOOST_CHECK_EQUAL( messages[0].getValue(), 0 );
+  BOOST_CHECK_EQUAL( messages[3].getValue(), 3 );
+  BOOST_CHECK_EQUAL( messages[4].getValue(), 10 );
 }
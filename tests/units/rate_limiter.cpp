@@ -0,0 +1,69 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphite_proxy/networking/rate_limiter.hpp>
+
+#include <chrono>
+
+using namespace graphite_proxy;
+
+BOOST_AUTO_TEST_CASE( rate_limiter_buckets )
+{
+  const networking::RateLimiter::time_point start = std::chrono::steady_clock::now();
+
+  // No limit, nothing ever waits
+  networking::RateLimiter unlimited;
+  BOOST_CHECK_EQUAL( unlimited.isLimited(), false );
+  unlimited.consume( 1000000, 1000000, start );
+  BOOST_CHECK_EQUAL( unlimited.delay( start ).count(), 0 );
+
+  // 1000 messages per second, the bucket holds 100 messages
+  networking::RateLimiter limiter( 1000, 0, 0 );
+  const networking::RateLimiter::time_point now = std::chrono::steady_clock::now();
+  BOOST_CHECK_EQUAL( limiter.isLimited(), true );
+  BOOST_CHECK_EQUAL( limiter.delay( start ).count(), 0 );
+
+  // A big batch is allowed, the debt delays the next one
+  limiter.consume( 600, 60000, now );
+  BOOST_CHECK_EQUAL( limiter.delay( now ).count(), 500000 );
+  BOOST_CHECK_EQUAL( limiter.delay( now + std::chrono::milliseconds( 300 ) ).count(), 200000 );
+  BOOST_CHECK_EQUAL( limiter.delay( now + std::chrono::milliseconds( 500 ) ).count(), 0 );
+
+  // The bucket doesn't grow over the burst
+  limiter.consume( 101, 0, now + std::chrono::seconds( 10 ) );
+  BOOST_CHECK_EQUAL( limiter.delay( now + std::chrono::seconds( 10 ) ).count(), 1000 );
+
+  // The most indebted bucket gives the delay
+  networking::RateLimiter both( 1000, 10000, 0 );
+  const networking::RateLimiter::time_point both_start = std::chrono::steady_clock::now();
+  both.consume( 100, 2000, both_start );
+  BOOST_CHECK_EQUAL( both.delay( both_start ).count(), 100000 );
+}
+
+BOOST_AUTO_TEST_CASE( rate_limiter_adaptation )
+{
+  networking::RateLimiter limiter( 1000, 0, 100 );
+  BOOST_CHECK_EQUAL( limiter.getFactor(), 1.0 );
+
+  // Slow writes halve the rate, down to the minimum
+  limiter.adapt( std::chrono::milliseconds( 150 ) );
+  BOOST_CHECK_EQUAL( limiter.getFactor(), 0.5 );
+  for( int i = 0; i < 10; i++ )
+    limiter.adapt( std::chrono::milliseconds( 150 ) );
+  BOOST_CHECK_EQUAL( limiter.getFactor(), networking::RATE_LIMITER_MIN_FACTOR );
+
+  // A slower rate means a longer wait for the same debt
+  const networking::RateLimiter::time_point start = std::chrono::steady_clock::now() + std::chrono::seconds( 1 );
+  limiter.delay( start );
+  limiter.consume( 100, 0, start );
+  BOOST_CHECK_EQUAL( limiter.delay( start ).count(), 900000 );
+
+  // Fast writes slowly restore the configured rate
+  for( int i = 0; i < 100; i++ )
+    limiter.adapt( std::chrono::milliseconds( 10 ) );
+  BOOST_CHECK_EQUAL( limiter.getFactor(), 1.0 );
+
+  // Without a maximum latency, the rate never changes
+  networking::RateLimiter fixed( 1000, 0, 0 );
+  fixed.adapt( std::chrono::seconds( 1 ) );
+  BOOST_CHECK_EQUAL( fixed.getFactor(), 1.0 );
+}
@@ -53,23 +53,24 @@ BOOST_AUTO_TEST_CASE( serialize_messages )
   std::vector<std::string> lines;
   readFile( filename_pass_though, lines );
   BOOST_CHECK_EQUAL( lines.size(), 2 );
-  BOOST_CHECK( std::find( lines.begin(), lines.end(), "normal.1 0.000000 0" ) != lines.end() );
-  BOOST_CHECK( std::find( lines.begin(), lines.end(), "normal.2 0.000000 0" ) != lines.end() );
+  BOOST_CHECK( std::find( lines.begin(), lines.end(), "normal.1 0 0" ) != lines.end() );
+  BOOST_CHECK( std::find( lines.begin(), lines.end(), "normal.2 0 0" ) != lines.end() );
 
   // Math messages have been serialized correctly ?
   lines.clear();
   readFile( filename_math, lines );
   BOOST_CHECK_EQUAL( lines.size(), 4 );
-  BOOST_CHECK( std::find( lines.begin(), lines.end(), "test_2.nani 0.000000 1234 sum" ) != lines.end() );
-  BOOST_CHECK( std::find( lines.begin(), lines.end(), "test_2.nani 0.000000 1234 average" ) != lines.end() );
-  BOOST_CHECK( std::find( lines.begin(), lines.end(), "test_2.nani 1.000000 5678 sum" ) != lines.end() );
-  BOOST_CHECK( std::find( lines.begin(), lines.end(), "test_2.nani 1.000000 5678 average" ) != lines.end() );
+  // Only the running statistics are kept, they are saved as messages giving back the same statistics
+  BOOST_CHECK( std::find( lines.begin(), lines.end(), "test_2.nani 0 5678 sum" ) != lines.end() );
+  BOOST_CHECK( std::find( lines.begin(), lines.end(), "test_2.nani 0 5678 average" ) != lines.end() );
+  BOOST_CHECK( std::find( lines.begin(), lines.end(), "test_2.nani 1 5678 sum" ) != lines.end() );
+  BOOST_CHECK( std::find( lines.begin(), lines.end(), "test_2.nani 1 5678 average" ) != lines.end() );
 
   // Load saved messages
   BOOST_REQUIRE_EQUAL( router.load( filename_pass_though, filename_math ), 6 ); // Same amount of messages than for the serizalized
 
   // Check pass through loaded messages
-  std::vector<message_ptr> messages;
+  std::vector<Message> messages;
   buffer->get( messages );
   BOOST_CHECK_EQUAL( messages.size(), 2 );
 
@@ -85,3 +86,69 @@ BOOST_AUTO_TEST_CASE( serialize_messages )
   BOOST_CHECK( !read_file_math );
 }
 
+
+BOOST_AUTO_TEST_CASE( route_raw_content )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  networking::client_ptr client = boost::make_shared<networking::Client>( "localhost", "2003" );
+  global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 10, true, client );
+
+  Router router( buffer, maths::maths_ptr() );
+
+  // Empty lines and bad lines are not routed, the last line doesn't need a line feed
+  const std::string content = "normal.1 0 0\n\nbad_line\nnormal.2 1 2\nnormal.3 2 4";
+  BOOST_CHECK_EQUAL( router.routeMessages( content.data(), content.size() ), 3 );
+
+  std::vector<Message> messages;
+  buffer->get( messages );
+  BOOST_CHECK_EQUAL( messages.size(), 3 );
+}
+
+BOOST_AUTO_TEST_CASE( route_with_cache )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  networking::client_ptr client = boost::make_shared<networking::Client>( "localhost", "2003" );
+  global_buffer_ptr buffer      = boost::make_shared<GlobalBuffer>( 10, true, client );
+  maths::maths_ptr pipeline     = boost::make_shared<maths::MathsPipeline>( "conf/maths_load_1.xml", buffer, 99, 99 );
+
+  Router router( buffer, pipeline, 16 );
+
+  // The first message of a series takes the decision, the next ones use it
+  BOOST_CHECK( router.routeMessage( "maths.load_2 1 1" ) );
+  BOOST_CHECK( router.routeMessage( "maths.load_2 2 2" ) );
+  BOOST_CHECK( router.routeMessage( "maths.load_2 3 3" ) );
+
+  unsigned long hits = 0, misses = 0;
+  router.getCacheStatistics( hits, misses );
+  BOOST_CHECK_EQUAL( hits, 2 );
+  BOOST_CHECK_EQUAL( misses, 1 );
+
+  std::vector<Message> messages;
+  buffer->get( messages );
+  BOOST_CHECK_EQUAL( messages.size(), 3 );
+
+  // The statistics are reset once read
+  router.getCacheStatistics( hits, misses );
+  BOOST_CHECK_EQUAL( hits + misses, 0 );
+
+  // A reload of the maths configurations invalidates the cached decisions
+  BOOST_REQUIRE( pipeline->reloadConfigurations( "conf/maths_load_2.xml" ) );
+  BOOST_CHECK( router.routeMessage( "maths.load_2 4 4" ) );
+  BOOST_CHECK( router.routeMessage( "maths.load_2 5 5" ) );
+
+  router.getCacheStatistics( hits, misses );
+  BOOST_CHECK_EQUAL( hits, 1 );
+  BOOST_CHECK_EQUAL( misses, 1 );
+
+  messages.clear();
+  buffer->get( messages );
+  BOOST_CHECK( messages.empty() );
+
+  // Without cache, each message is matched
+  Router uncached_router( buffer, pipeline, 0 );
+  BOOST_CHECK( uncached_router.routeMessage( "maths.load_2 6 6" ) );
+  uncached_router.getCacheStatistics( hits, misses );
+  BOOST_CHECK_EQUAL( hits + misses, 0 );
+}
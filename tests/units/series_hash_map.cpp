@@ -0,0 +1,51 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphite_proxy/models/buffers/series_hash_map.hpp>
+
+using namespace graphite_proxy;
+
+BOOST_AUTO_TEST_CASE( series_hash_map_behavior )
+{
+  SeriesHashMap<unsigned long> map;
+  BOOST_CHECK( map.empty() );
+  BOOST_CHECK( !map.find( 1 ) );
+
+  // Insert enough series to grow the table several times
+  const series_id nbr_series = 1000;
+  for( series_id series = 1; series <= nbr_series; series++ )
+    map[series] = series * 10;
+  BOOST_CHECK_EQUAL( map.size(), nbr_series );
+
+  // Existing series are not inserted again
+  map[5] += 1;
+  BOOST_CHECK_EQUAL( map.size(), nbr_series );
+  BOOST_REQUIRE( map.find( 5 ) );
+  BOOST_CHECK_EQUAL( *map.find( 5 ), 51 );
+
+  // Remove odd series, the even ones must remain reachable
+  for( series_id series = 1; series <= nbr_series; series += 2 )
+    BOOST_CHECK( map.erase( series ) );
+  BOOST_CHECK( !map.erase( 1 ) );
+  BOOST_CHECK_EQUAL( map.size(), nbr_series / 2 );
+
+  for( series_id series = 1; series <= nbr_series; series++ )
+  {
+    unsigned long* value = map.find( series );
+    if( series % 2 )
+      BOOST_CHECK( !value );
+    else
+    {
+      BOOST_REQUIRE( value );
+      BOOST_CHECK_EQUAL( *value, series * 10 );
+    }
+  }
+
+  // Iterate over remaining entries
+  unsigned long nbr_entries = 0;
+  map.forEach( [&nbr_entries]( series_id series, const unsigned long& value )
+  {
+    BOOST_CHECK_EQUAL( value, series * 10 );
+    nbr_entries++;
+  } );
+  BOOST_CHECK_EQUAL( nbr_entries, nbr_series / 2 );
+}
@@ -0,0 +1,44 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphite_proxy/models/series_table.hpp>
+#include <graphite_proxy/models/message.hpp>
+
+#include <string>
+
+using namespace graphite_proxy;
+
+BOOST_AUTO_TEST_CASE( series_table_interning )
+{
+  SeriesTable& table = SeriesTable::instance();
+
+  // Empty names are never interned
+  BOOST_CHECK_EQUAL( table.intern( "" ), INVALID_SERIES_ID );
+  BOOST_CHECK_EQUAL( table.name( INVALID_SERIES_ID ), "" );
+
+  // Unknown names are not added by find
+  BOOST_CHECK_EQUAL( table.find( "series_table.unknown" ), INVALID_SERIES_ID );
+
+  // A name always gets the same ID
+  const size_t previous_size = table.size();
+  const series_id id_1 = table.intern( "series_table.1" );
+  const series_id id_2 = table.intern( std::string( "series_table.2" ) );
+  BOOST_CHECK( id_1 != INVALID_SERIES_ID );
+  BOOST_CHECK( id_1 != id_2 );
+  BOOST_CHECK_EQUAL( table.intern( "series_table.1" ), id_1 );
+  BOOST_CHECK_EQUAL( table.find( "series_table.2" ), id_2 );
+  BOOST_CHECK_EQUAL( table.size(), previous_size + 2 );
+
+  BOOST_CHECK_EQUAL( table.name( id_1 ), "series_table.1" );
+  BOOST_CHECK_EQUAL( table.name( id_2 ), "series_table.2" );
+}
+
+BOOST_AUTO_TEST_CASE( series_table_messages )
+{
+  // Messages with the same name share the same series
+  Message message_1 = Message::createMessage( "series_table.message 1 2" );
+  Message     message_2( "series_table.message", 3, 4 );
+  BOOST_REQUIRE( message_1.isValid() );
+  BOOST_CHECK_EQUAL( message_1.getSeries(), message_2.getSeries() );
+  BOOST_CHECK_EQUAL( message_1.getSeries(), SeriesTable::instance().find( "series_table.message" ) );
+  BOOST_CHECK_EQUAL( message_2.getType(), "series_table.message" );
+}
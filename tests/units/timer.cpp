@@ -5,11 +5,39 @@
 #include <graphite_proxy/models/buffers/global_buffer.hpp>
 #include <graphite_proxy/models/timer.hpp>
 
+#include <boost/asio.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <atomic>
+#include <string>
+#include <vector>
 
 using namespace graphite_proxy;
 
+/*! Timer counting its iterations */
+class CountingTimer : public Timer
+{
+  public:
+
+    CountingTimer( global_buffer_ptr buffer, networking::client_ptr client, long buffer_flush_time )
+      : Timer( buffer, client, buffer_flush_time )
+      , iterations( 0 )
+    {
+    }
+
+    std::atomic<size_t> iterations;
+
+  protected:
+
+    void iteration()
+    {
+      iterations++;
+      Timer::iteration();
+    }
+};
+
 BOOST_AUTO_TEST_CASE( timer_public_behavior )
 {
   utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
@@ -26,3 +54,132 @@ BOOST_AUTO_TEST_CASE( timer_public_behavior )
   timer->stop();
   BOOST_CHECK_EQUAL( timer->isStarted(), false );
 }
+
+BOOST_AUTO_TEST_CASE( timer_flush_policy )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  // The flushed messages are written to a server which is never read, they are not put back
+  boost::asio::io_service io_service;
+  boost::asio::ip::tcp::acceptor acceptor( io_service, boost::asio::ip::tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+  networking::client_ptr client = boost::make_shared<networking::Client>( "127.0.0.1", std::to_string( acceptor.local_endpoint().port() ) );
+  global_buffer_ptr      buffer = boost::make_shared<GlobalBuffer>( 1000, true, client );
+
+  // The buffer tracks the size of its messages and the age of the oldest one
+  const std::string name = "timer.policy";
+  const size_t message_bytes = name.size() + GLOBAL_BUFFER_MESSAGE_OVERHEAD;
+  BOOST_CHECK_EQUAL( buffer->getBufferedBytes(), 0 );
+  BOOST_CHECK_EQUAL( buffer->getOldestAge().count(), 0 );
+  for( int i = 0; i < 10; i++ )
+    buffer->add( Message( name, i, 10 ) );
+  BOOST_CHECK_EQUAL( buffer->getBufferedBytes(), 10 * message_bytes );
+
+  boost::this_thread::sleep( boost::posix_time::milliseconds( 20 ) );
+  BOOST_CHECK_GE( buffer->getOldestAge().count(), 20 );
+
+  std::vector<Message> messages;
+  buffer->get( messages );
+  BOOST_CHECK_EQUAL( buffer->getBufferedBytes(), 0 );
+  BOOST_CHECK_EQUAL( buffer->getOldestAge().count(), 0 );
+
+  // Messages put back are counted again and keep their age
+  buffer->restore( messages );
+  BOOST_CHECK_EQUAL( buffer->getBufferedBytes(), 10 * message_bytes );
+  BOOST_CHECK_GE( buffer->getOldestAge().count(), 20 );
+  messages.clear();
+  buffer->get( messages );
+
+  // The timer is woken up once, by the message reaching the size
+  timer_ptr timer = boost::make_shared<Timer>( buffer, client, 3600 );
+  size_t triggers = 0;
+  timer->setFlushPolicy( 5 * message_bytes, 0 );
+  buffer->setFlushTrigger( 5 * message_bytes, [&triggers]() { triggers++; } );
+  for( int i = 0; i < 10; i++ )
+    buffer->add( Message( name, i, 10 ) );
+  BOOST_CHECK_EQUAL( triggers, 1 );
+
+  // A flush is due once the size is reached, not before
+  timer->iterate();
+  BOOST_CHECK_EQUAL( buffer->getBufferedBytes(), 0 );
+  buffer->add( Message( name, 1, 10 ) );
+  timer->iterate();
+  BOOST_CHECK_EQUAL( buffer->getBufferedBytes(), message_bytes );
+
+  // Or once the oldest message is old enough
+  timer->setFlushPolicy( 0, 30 );
+  timer->iterate();
+  BOOST_CHECK_EQUAL( buffer->getBufferedBytes(), message_bytes );
+  boost::this_thread::sleep( boost::posix_time::milliseconds( 40 ) );
+  timer->iterate();
+  BOOST_CHECK_EQUAL( buffer->getBufferedBytes(), 0 );
+
+  // The buffer outlives the timer, reaching the size doesn't wake a destroyed timer up
+  timer->setFlushPolicy( message_bytes, 0 );
+  timer.reset();
+  BOOST_CHECK( buffer->add( Message( name, 1, 10 ) ) );
+  BOOST_CHECK_EQUAL( buffer->getBufferedBytes(), message_bytes );
+  client->stop();
+}
+
+BOOST_AUTO_TEST_CASE( timer_oldest_age )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  boost::asio::io_service io_service;
+  boost::asio::ip::tcp::acceptor acceptor( io_service, boost::asio::ip::tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+  networking::client_ptr client = boost::make_shared<networking::Client>( "127.0.0.1", std::to_string( acceptor.local_endpoint().port() ) );
+  global_buffer_ptr      buffer = boost::make_shared<GlobalBuffer>( 3, true, client, 1 );
+
+  // The age is the one of the oldest received message of the shard
+  const ulong now = utils::time::nowMilliseconds();
+  buffer->add( Message( "age.old", 1, 10, now - 10000 ) );
+  buffer->add( Message( "age.old", 2, 10, now - 10000 ) );
+  const Message recent( "age.recent", 3, 10, now - 1000 );
+  buffer->add( recent );
+  BOOST_CHECK_GE( buffer->getOldestAge().count(), 10000 );
+
+  // A full buffer holding the oldest message makes the shard younger
+  buffer->add( Message( "age.old", 4, 10, now ) );
+  BOOST_CHECK_GE( buffer->getOldestAge().count(), 1000 );
+  BOOST_CHECK_LT( buffer->getOldestAge().count(), 10000 );
+
+  std::vector<Message> messages;
+  buffer->get( recent.getSeries(), messages );
+  BOOST_CHECK_EQUAL( buffer->getOldestAge().count(), 0 );
+
+  // Messages put back keep their age
+  buffer->restore( messages );
+  BOOST_CHECK_GE( buffer->getOldestAge().count(), 1000 );
+  client->stop();
+}
+
+BOOST_AUTO_TEST_CASE( timer_flush_outage )
+{
+  utils::logging::Logger::init( "", utils::logging::Logger::LogLevel::QUIET );
+
+  // Nothing listens on the port of the client
+  boost::asio::io_service io_service;
+  std::string port;
+  {
+    boost::asio::ip::tcp::acceptor acceptor( io_service, boost::asio::ip::tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+    port = std::to_string( acceptor.local_endpoint().port() );
+  }
+  networking::client_ptr client = boost::make_shared<networking::Client>( "127.0.0.1", port );
+  global_buffer_ptr      buffer = boost::make_shared<GlobalBuffer>( 1000, true, client );
+
+  // The messages put back are already too old, they don't trigger a flush at each iteration
+  const ulong now = utils::time::nowMilliseconds();
+  for( int i = 0; i < 100; i++ )
+    buffer->add( Message( "timer.outage." + std::to_string( i ), i, 10, now - 10000 ) );
+
+  boost::shared_ptr<CountingTimer> timer = boost::make_shared<CountingTimer>( buffer, client, 1 );
+  timer->setFlushPolicy( 0, 20 );
+  BOOST_REQUIRE( timer->start() );
+  boost::this_thread::sleep( boost::posix_time::milliseconds( 800 ) );
+  timer->stop();
+
+  // Retried after 100, 200 and 400 milliseconds
+  BOOST_CHECK_LE( timer->iterations, 10 );
+  client->stop();
+  BOOST_CHECK_GT( buffer->getBufferedBytes(), 0 );
+}